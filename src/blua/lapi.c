@@ -941,6 +941,10 @@ LUA_API int lua_gc (lua_State *L, int what, int data) {
       g->gcstepmul = data;
       break;
     }
+    case LUA_GCCYCLES: {
+      res = g->gccycles;
+      break;
+    }
     default: res = -1;  /* invalid option */
   }
   lua_unlock(L);
@@ -599,6 +599,7 @@ static l_mem singlestep (lua_State *L) {
       else {
         g->gcstate = GCSpause;  /* end collection */
         g->gcdept = 0;
+        g->gccycles++;
         return 0;
       }
     }
@@ -12,6 +12,7 @@
 
 #include <algorithm>
 #include <condition_variable>
+#include <cstdlib>
 #include <exception>
 #include <mutex>
 #include <string>
@@ -40,7 +41,8 @@ static void do_work(ThreadPool::Task& work)
 	(work.deleter)(work.raw.data());
 	if (work.pseudosema)
 	{
-		work.pseudosema->fetch_sub(1, std::memory_order_relaxed);
+		// Release, so the task's writes are visible after wait_sema
+		work.pseudosema->fetch_sub(1, std::memory_order_release);
 	}
 }
 
@@ -295,6 +297,10 @@ void ThreadPool::shutdown()
 }
 
 std::unique_ptr<ThreadPool> srb2::g_main_threadpool;
+std::unique_ptr<ThreadPool> srb2::g_media_threadpool;
+
+// Encoding a screenshot or GIF frame isn't worth more than this
+static constexpr size_t kMediaThreads = 2;
 
 void I_ThreadPoolInit(void)
 {
@@ -307,13 +313,21 @@ void I_ThreadPoolInit(void)
 		thread_count -= 1;
 	}
 
-	if (M_CheckParm("-singlethreaded"))
+	// Fixed for runs that have to be compared between machines
+	if (M_CheckParm("-threads") && M_IsNextParm())
+	{
+		thread_count = std::clamp(atoi(M_GetNextParm()), 0, 64);
+	}
+
+	if (M_CheckParm("-singlethreaded") || thread_count == 0)
 	{
 		g_main_threadpool = std::make_unique<ThreadPool>();
+		g_media_threadpool = std::make_unique<ThreadPool>();
 	}
 	else
 	{
 		g_main_threadpool = std::make_unique<ThreadPool>(thread_count);
+		g_media_threadpool = std::make_unique<ThreadPool>(std::clamp<size_t>(thread_count, 1, kMediaThreads));
 	}
 }
 
@@ -326,6 +340,10 @@ void I_ThreadPoolShutdown(void)
 
 	g_main_threadpool->shutdown();
 	g_main_threadpool = nullptr;
+
+	// Whatever is still being encoded is finished first
+	g_media_threadpool->shutdown();
+	g_media_threadpool = nullptr;
 }
 
 void I_ThreadPoolSubmit(srb2cthunk_t thunk, void* data)
@@ -344,3 +362,29 @@ void I_ThreadPoolWaitIdle(void)
 
 	g_main_threadpool->wait_idle();
 }
+
+void I_ThreadPoolBeginSema(void)
+{
+	SRB2_ASSERT(g_main_threadpool != nullptr);
+
+	g_main_threadpool->begin_sema();
+}
+
+void I_ThreadPoolWaitSema(void)
+{
+	SRB2_ASSERT(g_main_threadpool != nullptr);
+
+	ThreadPool::Sema sema = g_main_threadpool->end_sema();
+	g_main_threadpool->notify_sema(sema);
+	g_main_threadpool->wait_sema(sema);
+}
+
+void I_MediaThreadPoolSubmit(srb2cthunk_t thunk, void* data)
+{
+	SRB2_ASSERT(g_media_threadpool != nullptr);
+
+	g_media_threadpool->schedule([=]() {
+		(thunk)(data);
+	});
+	g_media_threadpool->notify();
+}
@@ -89,6 +89,9 @@ public:
 };
 
 extern std::unique_ptr<ThreadPool> g_main_threadpool;
+/// Screenshot and GIF encoding. Nothing waits on it from the main
+/// thread, so its jobs never end up running inside a frame.
+extern std::unique_ptr<ThreadPool> g_media_threadpool;
 
 template <typename F>
 void callable_caller(F* f)
@@ -156,6 +159,17 @@ void I_ThreadPoolShutdown(void);
 void I_ThreadPoolSubmit(srb2cthunk_t thunk, void* data);
 void I_ThreadPoolWaitIdle(void);
 
+/// Tasks submitted after I_ThreadPoolBeginSema are counted, and
+/// I_ThreadPoolWaitSema waits until all of them have finished,
+/// including ones a worker already started. I_ThreadPoolWaitIdle
+/// doesn't wait for those.
+void I_ThreadPoolBeginSema(void);
+void I_ThreadPoolWaitSema(void);
+
+/// Runs on g_media_threadpool. Signal completion from the task itself;
+/// there is no way to wait for these from the main thread.
+void I_MediaThreadPoolSubmit(srb2cthunk_t thunk, void* data);
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
@@ -466,6 +466,12 @@ consvar_t cv_splitdevice = Player("splitdevice", "Off").on_off();
 void Splitplayers_OnChange(void);
 consvar_t cv_splitplayers = Player("splitplayers", "One").values({{1, "One"}, {2, "Two"}, {3, "Three"}, {4, "Four"}}).onchange(Splitplayers_OnChange).dont_save();
 
+// generated textures are kept between levels, up to this many megabytes
+consvar_t cv_texturecache = Player("texturecache", "128").min_max(0, 2048);
+
+// also keep them in a file, for the next time the same addons are loaded
+consvar_t cv_texturecachefile = Player("texturecachefile", "Off").on_off();
+
 consvar_t cv_ticrate = Player(cvlist_screen)("showfps", "No").yes_no();
 consvar_t cv_tilting = Player("tilting", "On").on_off();
 
@@ -392,6 +392,8 @@ static bool D_Display(bool world)
 		if (vid.recalc)
 			SCR_Recalc(); // NOTE! setsizeneeded is set by SCR_Recalc()
 
+		R_NewInterpolationFrame();
+
 		if (rendermode == render_soft)
 		{
 			for (i = 0; i <= r_splitscreen; ++i)
@@ -544,6 +546,12 @@ static bool D_Display(bool world)
 				topleft = screens[0] + viewwindowy*vid.width + viewwindowx;
 				objectsdrawn = 0;
 
+#ifdef ROTSPRITE
+				// Start rotating sprites seen last frame, before
+				// the renderer starts handing out its own tasks
+				Patch_UpdateRotationQueue();
+#endif
+
 				ps_rendercalltime = I_GetPreciseTime();
 
 				if (rendermode == render_soft)
@@ -617,6 +625,7 @@ static bool D_Display(bool world)
 							}
 
 							R_RenderPlayerView();
+							G_TimeDemoView();
 
 							if (i > 0)
 								M_Memcpy(ylookup, ylookup1, viewheight*sizeof (ylookup[0]));
@@ -634,6 +643,11 @@ static bool D_Display(bool world)
 
 				ps_rendercalltime = I_GetPreciseTime() - ps_rendercalltime;
 				R_RestoreLevelInterpolators();
+
+				if (demo.timing)
+				{
+					G_TimeDemoFrame();
+				}
 			}
 
 			// rhi: display the software framebuffer to the screen
@@ -2027,7 +2041,13 @@ void D_SRB2Main(void)
 			G_DeferedPlayDemo(tmp);
 		}
 		else
+		{
+			// Same switches as the timedemo command, so unattended runs don't need the console
+			timedemo_hash = (M_CheckParm("-hash") > 0);
+			timedemo_frames = (M_CheckParm("-frames") > 0) || timedemo_hash;
+			timedemo_quit = (M_CheckParm("-quit") > 0);
 			G_TimeDemo(tmp);
+		}
 
 		G_SetGamestate(GS_NULL);
 		wipegamestate = GS_NULL;
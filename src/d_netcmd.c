@@ -46,6 +46,7 @@
 #include "z_zone.h"
 #include "lua_script.h"
 #include "lua_hook.h"
+#include "lua_profile.h" // lua_sample
 #include "m_cond.h"
 #include "m_anigif.h"
 #include "md5.h"
@@ -248,6 +249,8 @@ char timedemo_name[256];
 boolean timedemo_csv;
 char timedemo_csv_id[256];
 boolean timedemo_quit;
+boolean timedemo_frames;
+boolean timedemo_hash;
 
 INT16 gametype = GT_RACE;
 INT16 g_lastgametype = GT_RACE;
@@ -467,6 +470,7 @@ void D_RegisterServerCommands(void)
 #ifdef LUA_ALLOW_BYTECODE
 	COM_AddCommand("dumplua", Command_Dumplua_f);
 #endif
+	COM_AddCommand("lua_sample", Command_LuaSample_f);
 
 #ifdef DEVELOP
 	COM_AddDebugCommand("fastforward", Command_FastForward);
@@ -2118,7 +2122,7 @@ static void Command_Timedemo_f(void)
 
 	if (COM_Argc() < 2)
 	{
-		CONS_Printf(M_GetText("timedemo <demoname> [-csv [<trialid>]] [-quit]: time a demo\n"));
+		CONS_Printf(M_GetText("timedemo <demoname> [-csv [<trialid>]] [-frames] [-hash] [-quit]: time a demo\n"));
 		return;
 	}
 
@@ -2166,6 +2170,11 @@ static void Command_Timedemo_f(void)
 	// exit after the timedemo?
 	timedemo_quit = (COM_CheckParm("-quit") > 0);
 
+	// per-frame renderer timings, and a hash of every rendered frame
+	// (hashes are kept with the timings, so -hash implies -frames)
+	timedemo_hash = (COM_CheckParm("-hash") > 0);
+	timedemo_frames = (COM_CheckParm("-frames") > 0) || timedemo_hash;
+
 	CONS_Printf(M_GetText("Timing demo '%s'.\n"), timedemo_name);
 
 	G_TimeDemo(timedemo_name);
@@ -142,6 +142,8 @@ extern char timedemo_name[256];
 extern boolean timedemo_csv;
 extern char timedemo_csv_id[256];
 extern boolean timedemo_quit;
+extern boolean timedemo_frames;
+extern boolean timedemo_hash;
 
 typedef enum
 {
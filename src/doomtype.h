@@ -265,6 +265,7 @@ enum {false = 0, true = 1};
 	#endif
 
 	#define ATTRUNUSED __attribute__((unused))
+	#define PREFETCH(p) __builtin_prefetch(p)
 #elif defined (_MSC_VER)
 	#define ATTRNORETURN __declspec(noreturn)
 	#define ATTRINLINE __forceinline
@@ -309,6 +310,9 @@ enum {false = 0, true = 1};
 #ifndef ATTRUNUSED
 #define ATTRUNUSED
 #endif
+#ifndef PREFETCH
+#define PREFETCH(p) ((void)(p))
+#endif
 #ifndef ATTRNORETURN
 #define ATTRNORETURN
 #endif
@@ -14,6 +14,8 @@
 
 #include <algorithm>
 #include <cstddef>
+#include <string>
+#include <vector>
 
 #include <tcb/span.hpp>
 #include <nlohmann/json.hpp>
@@ -3930,6 +3932,24 @@ fail:
 //
 static INT32 restorecv_vidwait;
 
+// Per-frame renderer timings, for timedemo -frames
+struct timedemoframe_t
+{
+	tic_t leveltime;
+	precise_t total; // ps_rendercalltime, includes every view
+	precise_t bsp;
+	precise_t spriteclip;
+	precise_t portal;
+	precise_t plane;
+	precise_t masked;
+	precise_t spritesort;
+	INT32 numsprites;
+	UINT64 hash; // FNV-1a of screens[0], with -hash
+};
+
+static std::vector<timedemoframe_t> timedemoframes;
+static timedemoframe_t timedemoview;
+
 void G_TimeDemo(const char *name)
 {
 	nodrawers = M_CheckParm("-nodraw");
@@ -3940,14 +3960,182 @@ void G_TimeDemo(const char *name)
 	demo.timing = true;
 	g_singletics = true;
 	framecount = 0;
+	timedemoframes.clear();
+	timedemoview = {};
 	demostarttime = I_GetTime();
 	G_DeferedPlayDemo(name);
 }
 
+// Adds the phase timings of the view that was just rendered.
+// Splitscreen renders several views per frame, so they are summed.
+void G_TimeDemoView(void)
+{
+	if (!demo.timing || !timedemo_frames)
+		return;
+
+	timedemoview.bsp += ps_bsptime;
+	timedemoview.spriteclip += ps_sw_spritecliptime;
+	timedemoview.portal += ps_sw_portaltime;
+	timedemoview.plane += ps_sw_planetime;
+	timedemoview.masked += ps_sw_maskedtime;
+	timedemoview.spritesort += ps_sw_spritesorttime;
+	timedemoview.numsprites += ps_numsprites;
+}
+
+// Records the world rendering of this frame, before the HUD is drawn over it.
+void G_TimeDemoFrame(void)
+{
+	timedemoframe_t frame = timedemoview;
+
+	timedemoview = {};
+
+	if (!demo.timing || !timedemo_frames)
+		return;
+
+	frame.leveltime = leveltime;
+	frame.total = ps_rendercalltime;
+
+	if (timedemo_hash && rendermode == render_soft)
+	{
+		const UINT8 *p = screens[0];
+		const UINT8 *end = p + (size_t)vid.width * vid.height * vid.bpp;
+		UINT64 hash = 14695981039346656037ULL;
+
+		while (p < end)
+		{
+			hash ^= *p++;
+			hash *= 1099511628211ULL;
+		}
+
+		frame.hash = hash;
+	}
+
+	timedemoframes.push_back(frame);
+}
+
+// Writes timedemo_frames.csv, with one row per rendered frame,
+// and timedemo.json, with percentiles of every phase.
+static void G_WriteTimeDemoFrames(double seconds)
+{
+	using json = nlohmann::json;
+
+	const double tomicros = 1000000.0 / I_GetPrecisePrecision();
+	const char *csvpath = va("%s" PATHSEP "%s", srb2home, "timedemo_frames.csv");
+	const char *jsonpath;
+	FILE *f;
+	size_t i;
+
+	f = fopen(csvpath, "w");
+
+	if (!f)
+	{
+		CONS_Alert(CONS_ERROR, "Couldn't write timedemo frames to '%s'\n", csvpath);
+		return;
+	}
+
+	fputs("frame,leveltime,render,bsp,spriteclip,portal,plane,masked,spritesort,numsprites,hash\n", f);
+
+	for (i = 0; i < timedemoframes.size(); i++)
+	{
+		const timedemoframe_t &fr = timedemoframes[i];
+
+		fprintf(f, "%s,%u,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%d,%016llx\n",
+			sizeu1(i), fr.leveltime,
+			fr.total * tomicros, fr.bsp * tomicros, fr.spriteclip * tomicros, fr.portal * tomicros,
+			fr.plane * tomicros, fr.masked * tomicros, fr.spritesort * tomicros,
+			fr.numsprites, (unsigned long long)fr.hash);
+	}
+
+	fclose(f);
+	CONS_Printf("Timedemo frames saved to '%s'\n", csvpath);
+
+	json summary = {
+		{"id", timedemo_csv_id},
+		{"demo", timedemo_name},
+		{"seconds", seconds},
+		{"frames", timedemoframes.size()},
+		{"rendermode", rendermode},
+		{"width", vid.width},
+		{"height", vid.height},
+	};
+
+	auto phase = [&](const char *name, precise_t timedemoframe_t::*field)
+	{
+		std::vector<precise_t> v;
+
+		if (timedemoframes.empty())
+			return;
+
+		v.reserve(timedemoframes.size());
+		for (const timedemoframe_t &fr : timedemoframes)
+			v.push_back(fr.*field);
+		std::sort(v.begin(), v.end());
+
+		// Nearest-rank percentiles, in microseconds: the ceil(p/100 * n)th
+		// smallest, in integers so that e.g. p90 of 10 frames isn't rounded up
+		auto pct = [&](size_t p)
+		{
+			const size_t rank = (p * v.size() + 99) / 100;
+			return v[std::clamp<size_t>(rank, 1, v.size()) - 1] * tomicros;
+		};
+		double sum = 0.0;
+
+		for (precise_t t : v)
+			sum += t;
+
+		summary["phases"][name] = {
+			{"mean", sum / v.size() * tomicros},
+			{"p50", pct(50)},
+			{"p90", pct(90)},
+			{"p99", pct(99)},
+			{"max", v.back() * tomicros},
+		};
+	};
+
+	phase("render", &timedemoframe_t::total);
+	phase("bsp", &timedemoframe_t::bsp);
+	phase("spriteclip", &timedemoframe_t::spriteclip);
+	phase("portal", &timedemoframe_t::portal);
+	phase("plane", &timedemoframe_t::plane);
+	phase("masked", &timedemoframe_t::masked);
+	phase("spritesort", &timedemoframe_t::spritesort);
+
+	if (timedemo_hash)
+	{
+		// One hash for the whole run, so that two runs can be compared at a glance
+		UINT64 hash = 14695981039346656037ULL;
+		char hex[17];
+
+		for (const timedemoframe_t &fr : timedemoframes)
+		{
+			hash ^= fr.hash;
+			hash *= 1099511628211ULL;
+		}
+
+		snprintf(hex, sizeof hex, "%016llx", (unsigned long long)hash);
+		summary["hash"] = hex;
+	}
+
+	jsonpath = va("%s" PATHSEP "%s", srb2home, "timedemo.json");
+	f = fopen(jsonpath, "w");
+
+	if (!f)
+	{
+		CONS_Alert(CONS_ERROR, "Couldn't write timedemo summary to '%s'\n", jsonpath);
+		return;
+	}
+
+	fputs(summary.dump(1, '\t').c_str(), f);
+	fputc('\n', f);
+	fclose(f);
+	CONS_Printf("Timedemo summary saved to '%s'\n", jsonpath);
+}
+
 void G_DoneLevelLoad(void)
 {
 	CONS_Printf(M_GetText("Loaded level in %f sec\n"), (double)(I_GetTime() - demostarttime) / TICRATE);
 	framecount = 0;
+	timedemoframes.clear();
 	demostarttime = I_GetTime();
 }
 
@@ -4028,6 +4216,13 @@ static void G_StopTimingDemo(void)
 		}
 	}
 
+	if (timedemo_frames)
+	{
+		G_WriteTimeDemoFrames(f1/TICRATE);
+		timedemoframes.clear();
+		timedemoframes.shrink_to_fit();
+	}
+
 	if (restorecv_vidwait != cv_vidwait.value)
 		CV_SetValue(&cv_vidwait, restorecv_vidwait);
 
@@ -228,6 +228,8 @@ void G_DeferedPlayDemo(const char *demo);
 void G_DoPlayDemoEx(const char *defdemoname, lumpnum_t deflumpnum);
 #define G_DoPlayDemo(defdemoname) G_DoPlayDemoEx(defdemoname, LUMPERROR)
 void G_TimeDemo(const char *name);
+void G_TimeDemoView(void);
+void G_TimeDemoFrame(void);
 void G_AddGhost(savebuffer_t *buffer, const char *defdemoname);
 staffbrief_t *G_GetStaffGhostBrief(UINT8 *buffer);
 void G_FreeGhosts(void);
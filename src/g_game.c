@@ -4967,6 +4967,9 @@ void G_DirtyGameData(void)
 	if (gamedata)
 		gamedata->evercrashed = true;
 
+	// Before patching, so a save renamed over this file afterwards is patched too
+	G_MarkGameDataCrashed();
+
 	//if (FIL_WriteFileOK(name))
 		handle = fopen(va(pandf, srb2home, gamedatafilename), "r+b");
 
@@ -11,15 +11,19 @@
 #include "g_gamedata.h"
 
 #include <algorithm>
+#include <atomic>
+#include <cstdio>
 #include <cstdint>
 #include <cstddef>
 #include <exception>
 #include <filesystem>
+#include <memory>
 
 #include <fmt/format.h>
 
 #include "io/streams.hpp"
 #include "d_main.h"
+#include "g_savewriter.h"
 #include "m_argv.h"
 #include "m_cond.h"
 #include "g_game.h"
@@ -32,6 +36,31 @@ using json = nlohmann::json;
 #define GD_VERSION_MAJOR (0xBA5ED321)
 #define GD_VERSION_MINOR (1)
 
+// Set by G_MarkGameDataCrashed, possibly while a save is on the writer thread
+static std::atomic<bool> g_gamedata_crashed {false};
+
+void G_MarkGameDataCrashed(void)
+{
+	g_gamedata_crashed.store(true);
+}
+
+// The crash may have patched the old file just before the writer renamed a clean one over it
+static void rewrite_crash_flag(const std::string& path)
+{
+	if (!g_gamedata_crashed.load())
+		return;
+
+	FILE* handle = std::fopen(path.c_str(), "r+b");
+	if (!handle)
+		return;
+
+	const uint8_t dirty = true;
+	if (std::fseek(handle, 5, SEEK_SET) == 0)
+		std::fwrite(&dirty, 1, 1, handle);
+
+	std::fclose(handle);
+}
+
 void srb2::save_ng_gamedata()
 {
 	if (gamedata == NULL || !gamedata->loaded)
@@ -286,47 +315,33 @@ void srb2::save_ng_gamedata()
 	}
 
 	std::string gamedataname_s {gamedatafilename};
-	fs::path savepath {fmt::format("{}/{}", srb2home, gamedataname_s)};
-	fs::path baksavepath {fmt::format("{}/{}.bak", srb2home, gamedataname_s)};
+	std::string savepath = fmt::format("{}/{}", srb2home, gamedataname_s);
 
-	json ngdata_json = ng;
+	// Everything above reads live game state; the rest happens on the writer thread.
+	auto snapshot = std::make_shared<GamedataJson>(std::move(ng));
+	uint8_t dirty = gamedata->evercrashed;
 
+	std::string writtenpath = savepath;
 
-	if (fs::exists(savepath))
-	{
-		try
+	srb2::queue_save(
+		std::move(savepath),
+		[snapshot, dirty]()
 		{
-			fs::rename(savepath, baksavepath);
-		}
-		catch (const fs::filesystem_error& ex)
-		{
-			CONS_Alert(CONS_ERROR, "Failed to record backup save. Not attempting to save. %s\n", ex.what());
-			return;
-		}
-	}
+			srb2::io::VecStream file;
 
-	try
-	{
-		std::string savepathstring = savepath.string();
-		srb2::io::FileStream file {savepathstring, srb2::io::FileStreamMode::kWrite};
+			// The header is necessary to validate during loading.
+			srb2::io::write(static_cast<uint32_t>(GD_VERSION_MAJOR), file); // major
+			srb2::io::write(static_cast<uint8_t>(GD_VERSION_MINOR), file); // minor/flags
+			srb2::io::write(static_cast<uint8_t>(dirty || g_gamedata_crashed.load()), file); // dirty (crash recovery)
 
-		// The header is necessary to validate during loading.
-		srb2::io::write(static_cast<uint32_t>(GD_VERSION_MAJOR), file); // major
-		srb2::io::write(static_cast<uint8_t>(GD_VERSION_MINOR), file); // minor/flags
-		srb2::io::write(static_cast<uint8_t>(gamedata->evercrashed), file); // dirty (crash recovery)
+			std::vector<uint8_t> ubjson = json::to_ubjson(*snapshot);
+			srb2::io::write_exact(file, tcb::as_bytes(tcb::make_span(ubjson)));
 
-		std::vector<uint8_t> ubjson = json::to_ubjson(ng);
-		srb2::io::write_exact(file, tcb::as_bytes(tcb::make_span(ubjson)));
-		file.close();
-	}
-	catch (const std::exception& ex)
-	{
-		CONS_Alert(CONS_ERROR, "NG Gamedata save failed. Check directory for a ringdata.dat.bak. %s\n", ex.what());
-	}
-	catch (...)
-	{
-		CONS_Alert(CONS_ERROR, "NG Gamedata save failed. Check directory for a ringdata.dat.bak.\n");
-	}
+			return std::move(file.vector());
+		},
+		"NG Gamedata",
+		[writtenpath]() { rewrite_crash_flag(writtenpath); }
+	);
 }
 
 // G_SaveGameData
@@ -888,6 +903,9 @@ void srb2::load_ng_gamedata()
 // Loads the main data file, which stores information such as emblems found, etc.
 void G_LoadGameData(void)
 {
+	// Don't read a file that's still being written
+	G_FlushSaves();
+
 	try
 	{
 		srb2::load_ng_gamedata();
@@ -337,6 +337,9 @@ extern "C"
 void G_SaveGameData(void);
 void G_LoadGameData(void);
 
+// Make saves queued or being written keep the crash flag
+void G_MarkGameDataCrashed(void);
+
 #ifdef __cplusplus
 } // extern "C"
 #endif // __cplusplus
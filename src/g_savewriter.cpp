@@ -0,0 +1,222 @@
+// DR. ROBOTNIK'S RING RACERS
+//-----------------------------------------------------------------------------
+// Copyright (C) 2024 by Kart Krew
+//
+// This program is free software distributed under the
+// terms of the GNU General Public License, version 2.
+// See the 'LICENSE' file for more details.
+//-----------------------------------------------------------------------------
+/// \file  g_savewriter.cpp
+/// \brief Background writer for save files
+
+#include "g_savewriter.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#include <tcb/span.hpp>
+
+#include "io/streams.hpp"
+#include "console.h"
+#include "i_system.h"
+
+namespace fs = std::filesystem;
+
+namespace
+{
+
+// Saves queued this close together are written once
+constexpr auto kCoalesceWindow = std::chrono::milliseconds(250);
+
+struct SaveJob
+{
+	std::string path;
+	std::function<std::vector<std::byte>()> serialize;
+	std::string what;
+	std::function<void()> written;
+};
+
+std::mutex g_save_mutex;
+std::condition_variable g_save_queued;
+std::condition_variable g_save_idle;
+
+std::vector<SaveJob> g_pending;
+bool g_writing = false;
+bool g_flushing = false;
+bool g_stopping = false;
+
+// Never destroyed; it's joined by the exit function instead
+std::thread* g_save_thread = nullptr;
+
+void write_save(const SaveJob& job)
+{
+	std::vector<std::byte> data = job.serialize();
+
+	fs::path path {job.path};
+	fs::path temppath {job.path + ".tmp"};
+	fs::path bakpath {job.path + ".bak"};
+
+	{
+		srb2::io::FileStream file {temppath.string(), srb2::io::FileStreamMode::kWrite};
+		srb2::io::write_exact(file, tcb::as_bytes(tcb::make_span(data)));
+		file.close();
+	}
+
+	if (fs::exists(path))
+	{
+		try
+		{
+			fs::copy_file(path, bakpath, fs::copy_options::overwrite_existing);
+		}
+		catch (const fs::filesystem_error& ex)
+		{
+			fs::remove(temppath);
+			CONS_Alert(CONS_ERROR, "Failed to record %s backup. Not attempting to save. %s\n", job.what.c_str(), ex.what());
+			return;
+		}
+	}
+
+	// Replaces the old file in one step, so a crash leaves either one or the other
+	fs::rename(temppath, path);
+
+	if (job.written)
+	{
+		job.written();
+	}
+}
+
+void save_thread_main()
+{
+	std::unique_lock<std::mutex> lock {g_save_mutex};
+
+	for (;;)
+	{
+		g_save_queued.wait(lock, [] { return !g_pending.empty() || g_stopping; });
+
+		if (g_pending.empty())
+		{
+			break;
+		}
+
+		// Give the game a moment to queue anything else before writing
+		if (!g_flushing && !g_stopping)
+		{
+			g_save_queued.wait_for(lock, kCoalesceWindow, [] { return g_flushing || g_stopping; });
+		}
+
+		std::vector<SaveJob> jobs = std::move(g_pending);
+		g_pending.clear();
+		g_writing = true;
+
+		lock.unlock();
+
+		for (const SaveJob& job : jobs)
+		{
+			try
+			{
+				write_save(job);
+			}
+			catch (const std::exception& ex)
+			{
+				CONS_Alert(CONS_ERROR, "%s save failed. Check directory for a %s.bak. %s\n", job.what.c_str(), fs::path(job.path).filename().string().c_str(), ex.what());
+			}
+			catch (...)
+			{
+				CONS_Alert(CONS_ERROR, "%s save failed. Check directory for a %s.bak.\n", job.what.c_str(), fs::path(job.path).filename().string().c_str());
+			}
+		}
+
+		lock.lock();
+		g_writing = false;
+
+		if (g_pending.empty())
+		{
+			g_save_idle.notify_all();
+		}
+	}
+
+	g_writing = false;
+	g_save_idle.notify_all();
+}
+
+void stop_save_thread()
+{
+	{
+		std::lock_guard<std::mutex> lock {g_save_mutex};
+		g_stopping = true;
+	}
+	g_save_queued.notify_all();
+
+	// Whatever is still queued gets written before the thread returns
+	if (g_save_thread->joinable())
+	{
+		g_save_thread->join();
+	}
+}
+
+}; // namespace
+
+void srb2::queue_save(
+	std::string path,
+	std::function<std::vector<std::byte>()> serialize,
+	std::string what,
+	std::function<void()> written
+)
+{
+	std::lock_guard<std::mutex> lock {g_save_mutex};
+
+	if (g_stopping)
+	{
+		// Quitting, the thread is gone
+		try
+		{
+			write_save({std::move(path), std::move(serialize), std::move(what), std::move(written)});
+		}
+		catch (...)
+		{
+		}
+		return;
+	}
+
+	if (g_save_thread == nullptr)
+	{
+		g_save_thread = new std::thread(save_thread_main);
+		I_AddExitFunc(stop_save_thread);
+	}
+
+	auto it = std::find_if(g_pending.begin(), g_pending.end(), [&path](const SaveJob& job) { return job.path == path; });
+
+	if (it != g_pending.end())
+	{
+		it->serialize = std::move(serialize);
+		it->what = std::move(what);
+		it->written = std::move(written);
+	}
+	else
+	{
+		g_pending.push_back({std::move(path), std::move(serialize), std::move(what), std::move(written)});
+	}
+
+	g_save_queued.notify_all();
+}
+
+void G_FlushSaves(void)
+{
+	std::unique_lock<std::mutex> lock {g_save_mutex};
+
+	if (g_save_thread == nullptr || g_stopping)
+	{
+		return;
+	}
+
+	g_flushing = true;
+	g_save_queued.notify_all();
+	g_save_idle.wait(lock, [] { return g_pending.empty() && !g_writing; });
+	g_flushing = false;
+}
@@ -0,0 +1,53 @@
+// DR. ROBOTNIK'S RING RACERS
+//-----------------------------------------------------------------------------
+// Copyright (C) 2024 by Kart Krew
+//
+// This program is free software distributed under the
+// terms of the GNU General Public License, version 2.
+// See the 'LICENSE' file for more details.
+//-----------------------------------------------------------------------------
+/// \file  g_savewriter.h
+/// \brief Background writer for save files
+
+#ifndef SRB2_G_SAVEWRITER_H
+#define SRB2_G_SAVEWRITER_H
+
+#ifdef __cplusplus
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace srb2
+{
+
+// Serializes and writes a save file on the writer thread. The new file is
+// written next to the old one and renamed over it, after the old one is
+// copied to path.bak. Saves of the same path that haven't been written yet
+// are replaced, so only the latest snapshot reaches the disk.
+//
+// serialize runs on the writer thread: it must only touch data it owns.
+// what names the file in error messages. written, if given, runs on the
+// writer thread once the new file is in place.
+void queue_save(
+	std::string path,
+	std::function<std::vector<std::byte>()> serialize,
+	std::string what,
+	std::function<void()> written = {}
+);
+
+} // namespace srb2
+
+extern "C"
+{
+#endif // __cplusplus
+
+// Block until every queued save is on disk
+void G_FlushSaves(void);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif // __cplusplus
+
+#endif // SRB2_G_SAVEWRITER_H
@@ -12,6 +12,7 @@
 
 #include <stb_rect_pack.h>
 
+#include "../m_perfstats.h"
 #include "../r_patch.h"
 
 using namespace srb2;
@@ -124,21 +125,30 @@ void srb2::hwr2::convert_patch_to_trimmed_rg8_pixels(const patch_t* patch, std::
 	}
 }
 
-PatchAtlas::PatchAtlas(Handle<Texture> texture, uint32_t size) : tex_(texture), size_(size)
+PatchAtlas::PatchAtlas(Handle<Texture> texture, uint32_t width, uint32_t height)
+	: tex_(texture)
+	, width_(width)
+	, height_(height)
 {
 	rp_ctx = std::make_unique<stbrp_context>();
-	rp_nodes = std::make_unique<stbrp_node[]>(size * 2);
-	const size_t double_size = size * 2;
-	for (size_t i = 0; i < double_size; i++)
-	{
-		rp_nodes[i] = {};
-	}
-	stbrp_init_target(rp_ctx.get(), size, size, rp_nodes.get(), double_size);
+	rp_nodes = std::make_unique<stbrp_node[]>(width * 2);
+	clear();
 }
 
 PatchAtlas::PatchAtlas(PatchAtlas&&) = default;
 PatchAtlas& PatchAtlas::operator=(PatchAtlas&&) = default;
 
+void PatchAtlas::clear()
+{
+	const size_t double_width = width_ * 2;
+	for (size_t i = 0; i < double_width; i++)
+	{
+		rp_nodes[i] = {};
+	}
+	stbrp_init_target(rp_ctx.get(), width_, height_, rp_nodes.get(), double_width);
+	entries_.clear();
+}
+
 void PatchAtlas::pack_rects(tcb::span<stbrp_rect> rects)
 {
 	stbrp_pack_rects(rp_ctx.get(), rects.data(), rects.size());
@@ -165,13 +175,41 @@ PatchAtlasCache::PatchAtlasCache(PatchAtlasCache&&) = default;
 PatchAtlasCache& PatchAtlasCache::operator=(PatchAtlasCache&&) = default;
 PatchAtlasCache::~PatchAtlasCache() = default;
 
-bool PatchAtlasCache::need_to_reset() const
+size_t PatchAtlasCache::packed_atlas_count() const noexcept
 {
-	if (atlases_.size() > max_textures_)
+	size_t count = 0;
+	for (auto& atlas : atlases_)
 	{
-		return true;
+		if (!atlas.large_)
+		{
+			count++;
+		}
 	}
-	if (Patch_WasFreedThisFrame())
+	return count;
+}
+
+void PatchAtlasCache::evict_freed_patches()
+{
+	size_t count = 0;
+	const patch_t* const* freed = Patch_GetFreedThisFrame(&count);
+
+	for (size_t i = 0; i < count; i++)
+	{
+		auto itr = patch_lookup_.find(freed[i]);
+		if (itr == patch_lookup_.end())
+		{
+			continue;
+		}
+
+		atlases_[itr->second].entries_.erase(freed[i]);
+		patch_lookup_.erase(itr);
+	}
+}
+
+bool PatchAtlasCache::need_to_reset() const
+{
+	// make_room only goes over the limit when every atlas was drawn from in the same frame
+	if (packed_atlas_count() > max_textures_)
 	{
 		return true;
 	}
@@ -182,11 +220,16 @@ void PatchAtlasCache::reset(Rhi& rhi)
 {
 	for (auto& atlas : atlases_)
 	{
-		rhi.destroy_texture(atlas.texture());
+		if (atlas.tex_ != kNullHandle)
+		{
+			rhi.destroy_texture(atlas.texture());
+		}
 	}
 
 	atlases_.clear();
 	patch_lookup_.clear();
+
+	ps_atlas_repacks++;
 }
 
 bool PatchAtlasCache::ready_for_lookup() const
@@ -199,30 +242,152 @@ bool PatchAtlasCache::ready_for_lookup() const
 	return true;
 }
 
-static PatchAtlas create_atlas(Rhi& rhi, uint32_t size)
+static Handle<Texture> create_atlas_texture(Rhi& rhi, uint32_t width, uint32_t height)
 {
-	Handle<Texture> texture = rhi.create_texture(
+	return rhi.create_texture(
 		{
 			TextureFormat::kLuminanceAlpha,
-			size,
-			size,
+			width,
+			height,
 			TextureWrapMode::kClamp,
 			TextureWrapMode::kClamp
 		}
 	);
+}
+
+void PatchAtlasCache::evict_atlas(Rhi& rhi, size_t atlas_index)
+{
+	PatchAtlas& atlas = atlases_[atlas_index];
 
-	PatchAtlas new_atlas(texture, size);
+	for (auto& entry : atlas.entries_)
+	{
+		patch_lookup_.erase(entry.first);
+	}
+	atlas.clear();
 
-	return new_atlas;
+	if (atlas.large_)
+	{
+		// Large textures are sized to their patch, so this slot is free for any new atlas
+		rhi.destroy_texture(atlas.tex_);
+		atlas.tex_ = kNullHandle;
+	}
+	else
+	{
+		ps_atlas_repacks++;
+	}
 }
 
+size_t PatchAtlasCache::make_room(Rhi& rhi)
+{
+	if (packed_atlas_count() < max_textures_)
+	{
+		PatchAtlas new_atlas(create_atlas_texture(rhi, tex_size_, tex_size_), tex_size_, tex_size_);
+
+		for (size_t i = 0; i < atlases_.size(); i++)
+		{
+			if (atlases_[i].tex_ == kNullHandle)
+			{
+				atlases_[i] = std::move(new_atlas);
+				return i;
+			}
+		}
+
+		atlases_.push_back(std::move(new_atlas));
+		return atlases_.size() - 1;
+	}
+
+	// All of the atlases are full, so empty the one used least recently.
+	// Anything still in use was drawn this frame and can't be evicted.
+	std::optional<size_t> lru;
+	for (size_t i = 0; i < atlases_.size(); i++)
+	{
+		const PatchAtlas& atlas = atlases_[i];
+		if (atlas.large_ || atlas.last_used_ >= frame_)
+		{
+			continue;
+		}
+		if (!lru || atlas.last_used_ < atlases_[*lru].last_used_)
+		{
+			lru = i;
+		}
+	}
+
+	if (lru)
+	{
+		evict_atlas(rhi, *lru);
+		return *lru;
+	}
+
+	// This frame needs more than max_textures_ atlases; need_to_reset will catch it afterward.
+	atlases_.push_back(PatchAtlas(create_atlas_texture(rhi, tex_size_, tex_size_), tex_size_, tex_size_));
+	return atlases_.size() - 1;
+}
+
+void PatchAtlasCache::pack_large_patch(Rhi& rhi, const patch_t* patch)
+{
+	Rect trimmed_rect = trimmed_patch_dimensions(patch);
+	const uint32_t w = std::max<uint32_t>(trimmed_rect.w, 1);
+	const uint32_t h = std::max<uint32_t>(trimmed_rect.h, 1);
+
+	PatchAtlas new_atlas(create_atlas_texture(rhi, w, h), w, h);
+	new_atlas.large_ = true;
+	new_atlas.last_used_ = frame_;
+
+	PatchAtlas::Entry entry;
+	entry.x = 0;
+	entry.y = 0;
+	entry.w = trimmed_rect.w;
+	entry.h = trimmed_rect.h;
+	entry.trim_x = static_cast<uint32_t>(trimmed_rect.x);
+	entry.trim_y = static_cast<uint32_t>(trimmed_rect.y);
+	entry.orig_w = static_cast<uint32_t>(patch->width);
+	entry.orig_h = static_cast<uint32_t>(patch->height);
+	new_atlas.entries_.insert_or_assign(patch, std::move(entry));
+
+	size_t atlas_index = atlases_.size();
+	for (size_t i = 0; i < atlases_.size(); i++)
+	{
+		if (atlases_[i].tex_ == kNullHandle)
+		{
+			atlas_index = i;
+			break;
+		}
+	}
+
+	if (atlas_index == atlases_.size())
+	{
+		atlases_.push_back(std::move(new_atlas));
+	}
+	else
+	{
+		atlases_[atlas_index] = std::move(new_atlas);
+	}
+
+	patch_lookup_.insert_or_assign(patch, atlas_index);
+	patches_to_upload_.insert(patch);
+}
+
+// Large patches that haven't been drawn for this many frames give up their texture
+static constexpr uint64_t kLargePatchFrames = 120;
+
 void PatchAtlasCache::pack(Rhi& rhi, Handle<GraphicsContext> ctx)
 {
+	ps_atlas_uploads = 0;
+	ps_atlas_uploadkb = 0;
+	ps_atlas_repacks = 0;
+
+	for (size_t i = 0; i < atlases_.size(); i++)
+	{
+		PatchAtlas& atlas = atlases_[i];
+		if (atlas.large_ && atlas.tex_ != kNullHandle && atlas.last_used_ + kLargePatchFrames < frame_)
+		{
+			evict_atlas(rhi, i);
+		}
+	}
+
 	// Prepare stbrp rects for patches to be loaded.
 	std::vector<stbrp_rect> rects;
 
-	std::vector<const patch_t*> large_patches;
-
 	std::vector<const patch_t*> patches;
 	for (auto patch : patches_to_pack_)
 	{
@@ -236,7 +401,7 @@ void PatchAtlasCache::pack(Rhi& rhi, Handle<GraphicsContext> ctx)
 
 		if (rect_is_large(trimmed_rect.w, trimmed_rect.h))
 		{
-			large_patches.push_back(patch);
+			pack_large_patch(rhi, patch);
 			continue;
 		}
 
@@ -248,58 +413,55 @@ void PatchAtlasCache::pack(Rhi& rhi, Handle<GraphicsContext> ctx)
 		rects.push_back(std::move(rect));
 	}
 
-	while (rects.size() > 0)
+	// Fill the free space of each atlas in turn, then make room for what's left.
+	for (size_t atlas_index = 0; rects.size() > 0; atlas_index++)
 	{
-		if (atlases_.size() == 0)
+		if (atlas_index >= atlases_.size())
 		{
-			atlases_.push_back(create_atlas(rhi, tex_size_));
+			atlas_index = make_room(rhi);
 		}
 
-		for (size_t atlas_index = 0; atlas_index < atlases_.size(); atlas_index++)
+		auto& atlas = atlases_[atlas_index];
+		if (atlas.large_ || atlas.tex_ == kNullHandle)
 		{
-			auto& atlas = atlases_[atlas_index];
-			atlas.pack_rects(rects);
-			for (auto itr = rects.begin(); itr != rects.end();)
-			{
-				auto& rect = *itr;
-				if (rect.was_packed)
-				{
-					PatchAtlas::Entry entry;
-					const patch_t* patch = patches[rect.id];
-					Rect trimmed_rect = trimmed_patch_dimensions(patch);
-					entry.x = static_cast<uint32_t>(rect.x);
-					entry.y = static_cast<uint32_t>(rect.y);
-					entry.w = static_cast<uint32_t>(rect.w);
-					entry.h = static_cast<uint32_t>(rect.h);
-					entry.trim_x = static_cast<uint32_t>(trimmed_rect.x);
-					entry.trim_y = static_cast<uint32_t>(trimmed_rect.y);
-					entry.orig_w = static_cast<uint32_t>(patch->width);
-					entry.orig_h = static_cast<uint32_t>(patch->height);
-					atlas.entries_.insert_or_assign(patch, std::move(entry));
-					patch_lookup_.insert_or_assign(patch, atlas_index);
-					patches_to_upload_.insert(patch);
-					rects.erase(itr);
-					continue;
-				}
-				++itr;
-			}
+			continue;
+		}
 
-			// If we still have rects to pack, and we're at the last atlas, create another atlas.
-			if (atlas_index == atlases_.size() - 1 && rects.size() > 0)
+		atlas.pack_rects(rects);
+		for (auto itr = rects.begin(); itr != rects.end();)
+		{
+			auto& rect = *itr;
+			if (rect.was_packed)
 			{
-				atlases_.push_back(create_atlas(rhi, tex_size_));
+				PatchAtlas::Entry entry;
+				const patch_t* patch = patches[rect.id];
+				Rect trimmed_rect = trimmed_patch_dimensions(patch);
+				entry.x = static_cast<uint32_t>(rect.x);
+				entry.y = static_cast<uint32_t>(rect.y);
+				entry.w = static_cast<uint32_t>(rect.w);
+				entry.h = static_cast<uint32_t>(rect.h);
+				entry.trim_x = static_cast<uint32_t>(trimmed_rect.x);
+				entry.trim_y = static_cast<uint32_t>(trimmed_rect.y);
+				entry.orig_w = static_cast<uint32_t>(patch->width);
+				entry.orig_h = static_cast<uint32_t>(patch->height);
+				atlas.entries_.insert_or_assign(patch, std::move(entry));
+				atlas.last_used_ = frame_;
+				patch_lookup_.insert_or_assign(patch, atlas_index);
+				patches_to_upload_.insert(patch);
+				itr = rects.erase(itr);
+				continue;
 			}
+			++itr;
 		}
 	}
 
 	patches_to_pack_.clear();
 
-	// TODO Create large patch "atlases"
-
 	SRB2_ASSERT(ready_for_lookup());
 
 	// Upload atlased patches
 	std::vector<uint8_t> patch_data;
+	size_t upload_bytes = 0;
 	for (const patch_t* patch_to_upload : patches_to_upload_)
 	{
 		srb2::NotNull<PatchAtlas*> atlas = find_patch(patch_to_upload);
@@ -317,9 +479,16 @@ void PatchAtlasCache::pack(Rhi& rhi, Handle<GraphicsContext> ctx)
 			tcb::as_bytes(tcb::span(patch_data))
 		);
 
+		ps_atlas_uploads++;
+		upload_bytes += patch_data.size();
+
 		patch_data.clear();
 	}
 	patches_to_upload_.clear();
+
+	ps_atlas_uploadkb = static_cast<int>(upload_bytes / 1024);
+
+	frame_++;
 }
 
 PatchAtlas* PatchAtlasCache::find_patch(srb2::NotNull<const patch_t*> patch)
@@ -358,8 +527,10 @@ const PatchAtlas* PatchAtlasCache::find_patch(srb2::NotNull<const patch_t*> patc
 
 void PatchAtlasCache::queue_patch(srb2::NotNull<const patch_t*> patch)
 {
-	if (patch_lookup_.find(patch) != patch_lookup_.end())
+	auto itr = patch_lookup_.find(patch);
+	if (itr != patch_lookup_.end())
 	{
+		atlases_[itr->second].last_used_ = frame_;
 		return;
 	}
 
@@ -53,7 +53,14 @@ public:
 
 private:
 	rhi::Handle<rhi::Texture> tex_;
-	uint32_t size_;
+	uint32_t width_;
+	uint32_t height_;
+
+	/// @brief If true, this texture holds a single Large patch and is never packed into.
+	bool large_ = false;
+
+	/// @brief The PatchAtlasCache frame this atlas was last drawn from.
+	uint64_t last_used_ = 0;
 
 	std::unordered_map<const patch_t*, Entry> entries_;
 
@@ -62,8 +69,11 @@ private:
 
 	friend class PatchAtlasCache;
 
+	/// @brief Forget every entry and start packing from an empty texture.
+	void clear();
+
 public:
-	PatchAtlas(rhi::Handle<rhi::Texture> tex, uint32_t size);
+	PatchAtlas(rhi::Handle<rhi::Texture> tex, uint32_t width, uint32_t height);
 	PatchAtlas(const PatchAtlas&) = delete;
 	PatchAtlas& operator=(const PatchAtlas&) = delete;
 	PatchAtlas(PatchAtlas&&);
@@ -72,7 +82,8 @@ public:
 	/// @brief Get the Luminance-Alpha RHI texture handle for this atlas texture
 	rhi::Handle<rhi::Texture> texture() const noexcept { return tex_; }
 
-	uint32_t texture_size() const noexcept { return size_; }
+	uint32_t texture_width() const noexcept { return width_; }
+	uint32_t texture_height() const noexcept { return height_; }
 
 	std::optional<Entry> find_patch(srb2::NotNull<const patch_t*> patch) const;
 
@@ -82,6 +93,11 @@ public:
 /// @brief A resource-managing pass which creates and manages a set of Atlas Textures with
 /// optimally packed Patches, allowing drawing passes to reuse the same texture binds for
 /// drawing things like sprites and 2D elements.
+///
+/// New patches are packed into the free space of the existing atlases. When all max_textures_
+/// atlases are full, the one drawn from least recently is emptied and packed again, so only
+/// the patches that are still in use get uploaded again. Large patches get a texture each,
+/// which is destroyed once they go unused for a while.
 class PatchAtlasCache
 {
 	std::vector<PatchAtlas> atlases_;
@@ -93,11 +109,24 @@ class PatchAtlasCache
 	uint32_t tex_size_ = 2048;
 	size_t max_textures_ = 2;
 
+	/// @brief Counts calls to pack, which happen once per frame.
+	uint64_t frame_ = 1;
+
 	bool ready_for_lookup() const;
 
 	/// @brief Decide if a rect's dimensions are Large, that is, the rect should not be packed and instead its patch
 	/// should be uploaded in isolation.
-	bool rect_is_large(uint32_t w, uint32_t h) const noexcept { return false; }
+	bool rect_is_large(uint32_t w, uint32_t h) const noexcept { return w > tex_size_ / 2 || h > tex_size_ / 2; }
+
+	size_t packed_atlas_count() const noexcept;
+
+	/// @brief Remove an atlas' patches from the lookup and empty it. Large atlases also lose their texture.
+	void evict_atlas(rhi::Rhi& rhi, size_t atlas_index);
+
+	/// @brief Get an empty atlas to pack into, by creating one or evicting the least recently used one.
+	size_t make_room(rhi::Rhi& rhi);
+
+	void pack_large_patch(rhi::Rhi& rhi, const patch_t* patch);
 
 public:
 	PatchAtlasCache(uint32_t tex_size, size_t max_textures);
@@ -121,6 +150,9 @@ public:
 	const PatchAtlas* find_patch(srb2::NotNull<const patch_t*> patch) const;
 	PatchAtlas* find_patch(srb2::NotNull<const patch_t*> patch);
 
+	/// @brief Forget the patches that were freed this frame. Their space is reclaimed when their atlas is evicted.
+	void evict_freed_patches();
+
 	bool need_to_reset() const;
 
 	/// @brief Clear the atlases and reset for lookup.
@@ -133,10 +133,10 @@ void TwodeeRenderer::rewrite_patch_quad_vertices(Draw2dList& list, const Draw2dP
 
 	// Rewrite the vertex data completely.
 	// The UVs of the trimmed patch in atlas UV space.
-	const float atlas_umin = static_cast<float>(entry.x) / atlas->texture_size();
-	const float atlas_umax = static_cast<float>(entry.x + entry.w) / atlas->texture_size();
-	const float atlas_vmin = static_cast<float>(entry.y) / atlas->texture_size();
-	const float atlas_vmax = static_cast<float>(entry.y + entry.h) / atlas->texture_size();
+	const float atlas_umin = static_cast<float>(entry.x) / atlas->texture_width();
+	const float atlas_umax = static_cast<float>(entry.x + entry.w) / atlas->texture_width();
+	const float atlas_vmin = static_cast<float>(entry.y) / atlas->texture_height();
+	const float atlas_vmax = static_cast<float>(entry.y + entry.h) / atlas->texture_height();
 
 	// The UVs of the trimmed patch in untrimmed UV space.
 	// The command's UVs are in untrimmed UV space.
@@ -588,6 +588,7 @@ void TwodeeRenderer::flush(Rhi& rhi, Handle<GraphicsContext> ctx, Twodee& twodee
 	twodee = Twodee();
 
 	// Reset the patch atlas if needed
+	patch_atlas_cache_->evict_freed_patches();
 	if (patch_atlas_cache_->need_to_reset())
 	{
 		patch_atlas_cache_->reset(rhi);
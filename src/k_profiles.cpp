@@ -13,10 +13,12 @@
 
 #include <algorithm>
 #include <exception>
+#include <memory>
 
 #include <fmt/format.h>
 
 #include "io/streams.hpp"
+#include "g_savewriter.h"
 #include "doomtype.h"
 #include "d_main.h" // pandf
 #include "byteptr.h" // READ/WRITE macros
@@ -250,7 +252,6 @@ void PR_InitNewProfile(void)
 
 void PR_SaveProfiles(void)
 {
-	namespace fs = std::filesystem;
 	using json = nlohmann::json;
 	using namespace srb2;
 	namespace io = srb2::io;
@@ -316,45 +317,31 @@ void PR_SaveProfiles(void)
 		ng.profiles.emplace_back(std::move(jsonprof));
 	}
 
-	std::vector<uint8_t> ubjson = json::to_ubjson(ng);
-
 	std::string realpath = fmt::format("{}/{}", srb2home, PROFILESFILE);
-	std::string bakpath = fmt::format("{}.bak", realpath);
 
-	if (fs::exists(realpath))
-	{
-		try
-		{
-			fs::rename(realpath, bakpath);
-		}
-		catch (const fs::filesystem_error& ex)
+	// Serialized and written on the writer thread
+	auto snapshot = std::make_shared<ProfilesJson>(std::move(ng));
+
+	srb2::queue_save(
+		std::move(realpath),
+		[snapshot]()
 		{
-			CONS_Alert(CONS_ERROR, "Failed to record profiles backup. Not attempting to save profiles. %s\n", ex.what());
-			return;
-		}
-	}
+			io::VecStream file;
 
-	try
-	{
-		io::FileStream file {realpath, io::FileStreamMode::kWrite};
-
-		io::write(static_cast<uint32_t>(0x52494E47), file, io::Endian::kBE); // "RING"
-		io::write(static_cast<uint32_t>(0x5052464C), file, io::Endian::kBE); // "PRFL"
-		io::write(static_cast<uint8_t>(0), file); // reserved1
-		io::write(static_cast<uint8_t>(0), file); // reserved2
-		io::write(static_cast<uint8_t>(0), file); // reserved3
-		io::write(static_cast<uint8_t>(0), file); // reserved4
-		io::write_exact(file, tcb::as_bytes(tcb::make_span(ubjson)));
-		file.close();
-	}
-	catch (const std::exception& ex)
-	{
-		I_Error("Couldn't save profiles. Are you out of Disk space / playing in a protected folder? Check directory for a ringprofiles.prf.bak if the profiles file is corrupt.\n\nException: %s", ex.what());
-	}
-	catch (...)
-	{
-		I_Error("Couldn't save profiles. Are you out of Disk space / playing in a protected folder? Check directory for a ringprofiles.prf.bak if the profiles file is corrupt.");
-	}
+			io::write(static_cast<uint32_t>(0x52494E47), file, io::Endian::kBE); // "RING"
+			io::write(static_cast<uint32_t>(0x5052464C), file, io::Endian::kBE); // "PRFL"
+			io::write(static_cast<uint8_t>(0), file); // reserved1
+			io::write(static_cast<uint8_t>(0), file); // reserved2
+			io::write(static_cast<uint8_t>(0), file); // reserved3
+			io::write(static_cast<uint8_t>(0), file); // reserved4
+
+			std::vector<uint8_t> ubjson = json::to_ubjson(*snapshot);
+			io::write_exact(file, tcb::as_bytes(tcb::make_span(ubjson)));
+
+			return std::move(file.vector());
+		},
+		"Profiles"
+	);
 }
 
 void PR_LoadProfiles(void)
@@ -364,6 +351,9 @@ void PR_LoadProfiles(void)
 	namespace io = srb2::io;
 	using json = nlohmann::json;
 
+	// Don't read a file that's still being written
+	G_FlushSaves();
+
 	profile_t *dprofile = PR_MakeProfile(
 		PROFILEDEFAULTNAME,
 		PROFILEDEFAULTPNAME,
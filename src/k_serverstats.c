@@ -20,73 +20,476 @@
 #include "k_serverstats.h"
 #include "z_zone.h"
 #include "time.h"
+#include "i_system.h"
 
-static serverplayer_t *trackedList;
+#ifdef HAVE_THREADS
+#include "i_threads.h"
+#endif
+
+// Records live in fixed blocks, so pointers handed out stay valid as more keys are tracked
+#define STATSBLOCKSHIFT 8
+#define STATSBLOCKSIZE (1 << STATSBLOCKSHIFT)
+
+#define STATSRECORDSIZE (PUBKEYLENGTH + sizeof(UINT32) + (PWRLV_NUMTYPES * sizeof(UINT16)) + sizeof(UINT32))
+#define JOURNALRECORDSIZE (STATSRECORDSIZE + sizeof(UINT32)) // record + checksum
+
+// Don't bother compacting a journal smaller than this
+#define MINJOURNALRECORDS 1024
+
+static serverplayer_t **statsblocks;
+static size_t numstatsblocks = 0;
 static size_t numtracked = 0;
-static size_t numallocated = 0;
 static boolean initialized = false;
 
+// Open addressed, record index + 1 (0 is empty)
+static UINT32 *statsindex;
+static size_t statsindexsize = 0; // power of two
+
+// Bumped by every full save; the journal only applies to the file of the same generation
+static UINT32 statsgeneration = 0;
+static size_t journalrecords = 0;
+static boolean compactpending = false;
+
+static char statspath[sizeof srb2home + 32];
+static char journalpath[sizeof srb2home + 32];
+
 UINT16 guestpwr[PWRLV_NUMTYPES]; // All-zero power level to reference for guests
 
+#define SV_StatsAt(i) (&statsblocks[(i) >> STATSBLOCKSHIFT][(i) & (STATSBLOCKSIZE - 1)])
+
+// FNV-1a, over the whole key (quickncasehash stops at the first zero byte)
+static UINT32 SV_KeyHash(const uint8_t *key)
+{
+	UINT32 hash = 2166136261u;
+	size_t i;
+
+	for (i = 0; i < PUBKEYLENGTH; i++)
+	{
+		hash ^= key[i];
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+static UINT32 SV_Checksum(const UINT8 *p, size_t length)
+{
+	UINT32 sum = 2166136261u;
+
+	while (length--)
+	{
+		sum ^= *p++;
+		sum *= 16777619u;
+	}
+
+	return sum;
+}
+
 static void SV_InitializeStats(void)
 {
 	if (!initialized)
 	{
-		numallocated = 8;
-		trackedList = Z_Calloc(
-			sizeof(serverplayer_t) * numallocated,
+		snprintf(statspath, sizeof statspath, pandf, srb2home, SERVERSTATSFILE);
+		snprintf(journalpath, sizeof journalpath, pandf, srb2home, SERVERSTATSJOURNAL);
+
+		initialized = true;
+	}
+}
+
+static void SV_InsertIndex(size_t i)
+{
+	const size_t mask = statsindexsize - 1;
+	size_t slot = SV_StatsAt(i)->hash & mask;
+
+	while (statsindex[slot])
+		slot = (slot + 1) & mask;
+
+	statsindex[slot] = (UINT32)(i + 1);
+}
+
+static void SV_ExpandStats(size_t needed)
+{
+	size_t i;
+
+	while (numstatsblocks * STATSBLOCKSIZE < needed)
+	{
+		statsblocks = Z_Realloc(
+			statsblocks,
+			sizeof(*statsblocks) * (numstatsblocks + 1),
+			PU_STATIC,
+			&statsblocks
+		);
+
+		statsblocks[numstatsblocks] = Z_Calloc(
+			sizeof(serverplayer_t) * STATSBLOCKSIZE,
 			PU_STATIC,
-			&trackedList
+			NULL
 		);
 
-		if (trackedList == NULL)
+		if (statsblocks == NULL || statsblocks[numstatsblocks] == NULL)
 		{
 			I_Error("Not enough memory for server stats\n");
 		}
 
-		initialized = true;
+		numstatsblocks++;
+	}
+
+	// Keep the index at most half full
+	if (needed * 2 > statsindexsize)
+	{
+		if (statsindex)
+			Z_Free(statsindex);
+
+		if (statsindexsize == 0)
+			statsindexsize = 64;
+
+		while (needed * 2 > statsindexsize)
+			statsindexsize *= 2;
+
+		statsindex = Z_Calloc(sizeof(*statsindex) * statsindexsize, PU_STATIC, NULL);
+
+		for (i = 0; i < numtracked; i++)
+			SV_InsertIndex(i);
 	}
 }
 
-static void SV_ExpandStats(size_t needed)
+static serverplayer_t *SV_FindStats(const uint8_t *key, UINT32 hash)
 {
-	I_Assert(trackedList != NULL);
+	const size_t mask = statsindexsize - 1;
+	size_t slot;
 
-	while (numallocated < needed)
+	if (statsindexsize == 0)
+		return NULL;
+
+	for (slot = hash & mask; statsindex[slot]; slot = (slot + 1) & mask)
 	{
-		numallocated *= 2;
-		trackedList = Z_Realloc(
-			trackedList,
-			sizeof(serverplayer_t) * numallocated,
-			PU_STATIC,
-			&trackedList
-		);
+		serverplayer_t *stat = SV_StatsAt(statsindex[slot] - 1);
+
+		if (hash != stat->hash) // Not crypto magic, just an early out with a faster comparison
+			continue;
+		if (memcmp(stat->public_key, key, PUBKEYLENGTH) == 0)
+			return stat;
+	}
+
+	return NULL;
+}
+
+static serverplayer_t *SV_AddStats(const uint8_t *key, UINT32 hash)
+{
+	serverplayer_t *stat;
+
+	SV_ExpandStats(numtracked + 1);
+
+	stat = SV_StatsAt(numtracked);
+	memset(stat, 0, sizeof *stat);
+	memcpy(stat->public_key, key, PUBKEYLENGTH);
+	stat->hash = hash;
+
+	SV_InsertIndex(numtracked);
+	numtracked++;
+
+	return stat;
+}
+
+static void SV_WriteRecord(UINT8 **p, const serverplayer_t *stat)
+{
+	UINT8 *save_p = *p;
+	unsigned int j;
+
+	WRITEMEM(save_p, stat->public_key, PUBKEYLENGTH);
+	WRITEMEM(save_p, &stat->lastseen, sizeof(stat->lastseen));
+	for(j = 0; j < PWRLV_NUMTYPES; j++)
+	{
+		WRITEUINT16(save_p, stat->powerlevels[j]);
+	}
+	WRITEUINT32(save_p, stat->finishedrounds);
+
+	*p = save_p;
+}
+
+static void SV_ReadRecord(UINT8 **p, serverplayer_t *stat, UINT8 version)
+{
+	UINT8 *save_p = *p;
+	unsigned int j;
 
-		if (trackedList == NULL)
+	READMEM(save_p, &stat->lastseen, sizeof(stat->lastseen));
+	for(j = 0; j < PWRLV_NUMTYPES; j++)
+	{
+		stat->powerlevels[j] = READUINT16(save_p);
+	}
+
+	// Migration 1 -> 2: Add finishedrounds
+	if (version < 2)
+		stat->finishedrounds = 0;
+	else
+		stat->finishedrounds = READUINT32(save_p);
+
+	*p = save_p;
+}
+
+// =====================================================================
+//                          BACKGROUND WRITES
+// =====================================================================
+
+typedef struct
+{
+	UINT8 *buffer;
+	size_t length;
+	boolean compact; // buffer is the whole file, else records to append to the journal
+	UINT32 generation;
+	boolean failed;
+} statsjob_t;
+
+static statsjob_t *statsjob; // in flight
+#ifdef HAVE_THREADS
+static I_mutex statsjob_mutex;
+static I_cond statsjob_cond;
+static boolean statsjobdone;
+#endif
+
+// Write to a temporary file first, so a crash leaves either the old file or the new one
+static boolean SV_ReplaceFile(const char *path, const UINT8 *buffer, size_t length)
+{
+	char temppath[sizeof statspath + 8];
+	FILE *f;
+	boolean ok;
+
+	snprintf(temppath, sizeof temppath, "%s.tmp", path);
+
+	f = fopen(temppath, "wb");
+	if (f == NULL)
+		return false;
+
+	ok = (fwrite(buffer, 1, length, f) == length);
+	ok = (fflush(f) == 0) && ok;
+	ok = (fclose(f) == 0) && ok;
+
+	if (!ok)
+	{
+		remove(temppath);
+		return false;
+	}
+
+	if (rename(temppath, path) != 0)
+	{
+		// Windows won't rename over an existing file
+		remove(path);
+		if (rename(temppath, path) != 0)
 		{
-			I_Error("Not enough memory for server stats\n");
+			remove(temppath);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static size_t SV_JournalHeader(UINT8 *header, UINT32 generation)
+{
+	const size_t headerlen = strlen(SERVERSTATSJOURNALHEADER);
+	UINT8 *p = header;
+
+	WRITESTRINGN(p, SERVERSTATSJOURNALHEADER, headerlen);
+	WRITEUINT32(p, generation);
+
+	return p - header;
+}
+
+static void SV_RunStatsJob(void *userdata)
+{
+	statsjob_t *job = userdata;
+	UINT8 header[sizeof SERVERSTATSJOURNALHEADER + sizeof(UINT32)];
+
+	if (job->compact)
+	{
+		// The new file already has everything the old journal did.
+		// If we die between these, the old journal's generation won't match, so it's ignored.
+		job->failed = !SV_ReplaceFile(statspath, job->buffer, job->length)
+			|| !SV_ReplaceFile(journalpath, header, SV_JournalHeader(header, job->generation));
+	}
+	else
+	{
+		FILE *f = fopen(journalpath, "ab");
+
+		if (f == NULL)
+			job->failed = true;
+		else
+		{
+			// Someone deleted it
+			if (fseek(f, 0, SEEK_END) == 0 && ftell(f) == 0)
+			{
+				size_t headerlen = SV_JournalHeader(header, job->generation);
+				job->failed = (fwrite(header, 1, headerlen, f) != headerlen);
+			}
+
+			job->failed = (fwrite(job->buffer, 1, job->length, f) != job->length) || job->failed;
+			job->failed = (fclose(f) != 0) || job->failed;
 		}
 	}
 
+#ifdef HAVE_THREADS
+	I_lock_mutex(&statsjob_mutex);
+	statsjobdone = true;
+	I_wake_all_cond(&statsjob_cond);
+	I_unlock_mutex(statsjob_mutex);
+#endif
 }
 
-// Read stats file to trackedList for ingame use
+// Collect the job in flight, optionally waiting for it
+static boolean SV_FinishStatsJob(boolean wait)
+{
+	if (statsjob == NULL)
+		return true;
+
+#ifdef HAVE_THREADS
+	{
+		boolean done;
+
+		I_lock_mutex(&statsjob_mutex);
+		done = statsjobdone;
+		I_unlock_mutex(statsjob_mutex);
+
+		if (!done)
+		{
+			if (!wait)
+				return false;
+
+			I_lock_mutex(&statsjob_mutex);
+			while (!statsjobdone)
+				I_hold_cond(&statsjob_cond, statsjob_mutex);
+			I_unlock_mutex(statsjob_mutex);
+		}
+
+		statsjobdone = false;
+	}
+#else
+	(void)wait;
+#endif
+
+	if (statsjob->failed)
+	{
+		CONS_Alert(CONS_ERROR, "Couldn't save server stats. Are you out of disk space / playing in a protected folder?\n");
+
+		// Whatever didn't make it will go in the next full save
+		compactpending = true;
+	}
+
+	free(statsjob->buffer);
+	free(statsjob);
+	statsjob = NULL;
+
+	return true;
+}
+
+static void SV_StartStatsJob(UINT8 *buffer, size_t length, boolean compact)
+{
+	statsjob_t *job = malloc(sizeof *job);
+
+	if (job == NULL)
+	{
+		free(buffer);
+		compactpending = true;
+		return;
+	}
+
+	job->buffer = buffer;
+	job->length = length;
+	job->compact = compact;
+	job->generation = statsgeneration;
+	job->failed = false;
+
+	statsjob = job;
+
+#ifdef HAVE_THREADS
+	// Its own thread, not the pool, since the main thread runs pool jobs
+	// while it waits on them and this one can block on the disk
+	if (!I_thread_is_stopped())
+	{
+		I_spawn_thread("save-stats", SV_RunStatsJob, job);
+		return;
+	}
+#endif
+
+	SV_RunStatsJob(job);
+	SV_FinishStatsJob(true);
+}
+
+// Replay the journal on top of what SV_LoadStats read
+static void SV_LoadJournal(void)
+{
+	const size_t headerlen = strlen(SERVERSTATSJOURNALHEADER);
+	savebuffer_t save = {0};
+	size_t replayed = 0;
+
+	if (P_SaveBufferFromFile(&save, journalpath) == false)
+	{
+		return;
+	}
+
+	if (save.size < headerlen + sizeof(UINT32)
+		|| strncmp(SERVERSTATSJOURNALHEADER, (const char *)save.buffer, headerlen))
+	{
+		CONS_Alert(CONS_WARNING, "Ignoring invalid %s\n", SERVERSTATSJOURNAL);
+		P_SaveBufferFree(&save);
+		return;
+	}
+
+	save.p += headerlen;
+
+	// Left behind from before the last full save; those records are already in it
+	if (READUINT32(save.p) != statsgeneration)
+	{
+		P_SaveBufferFree(&save);
+		return;
+	}
+
+	while (P_SaveBufferRemaining(&save) >= JOURNALRECORDSIZE)
+	{
+		UINT8 *record = save.p;
+		UINT8 *sum_p = record + STATSRECORDSIZE;
+		uint8_t key[PUBKEYLENGTH];
+		serverplayer_t *stat;
+		UINT32 hash;
+
+		// A torn write at the end, from a crash in the middle of an append
+		if (READUINT32(sum_p) != SV_Checksum(record, STATSRECORDSIZE))
+			break;
+
+		READMEM(save.p, key, PUBKEYLENGTH);
+		hash = SV_KeyHash(key);
+
+		stat = SV_FindStats(key, hash);
+		if (stat == NULL)
+			stat = SV_AddStats(key, hash);
+
+		SV_ReadRecord(&save.p, stat, SERVERSTATSVER);
+		save.p += sizeof(UINT32); // checksum
+
+		replayed++;
+	}
+
+	journalrecords = replayed;
+
+	P_SaveBufferFree(&save);
+}
+
+// Read stats file for ingame use
 void SV_LoadStats(void)
 {
 	const size_t headerlen = strlen(SERVERSTATSHEADER);
 	savebuffer_t save = {0};
-	unsigned int i, j;
+	unsigned int i;
 
 	if (!server)
 		return;
 
-	if (P_SaveBufferFromFile(&save, va(pandf, srb2home, SERVERSTATSFILE)) == false)
+	SV_InitializeStats();
+
+	if (P_SaveBufferFromFile(&save, statspath) == false)
 	{
 		return;
 	}
 
-	SV_InitializeStats();
-
 	if (strncmp(SERVERSTATSHEADER, (const char *)save.buffer, headerlen))
 	{
 		const char *gdfolder = "the Ring Racers folder";
@@ -110,112 +513,161 @@ void SV_LoadStats(void)
 		FIL_WriteFile(va("%s" PATHSEP "%s.bak", srb2home, SERVERSTATSFILE), save.buffer, save.size);
 	}
 
-	numtracked = READUINT32(save.p);
+	// Migration 2 -> 3: Add generation
+	if (version < 3)
+		statsgeneration = 0;
+	else
+		statsgeneration = READUINT32(save.p);
 
-	SV_ExpandStats(numtracked);
+	size_t count = READUINT32(save.p);
 
-	for(i = 0; i < numtracked; i++)
-	{
-		READMEM(save.p, trackedList[i].public_key, PUBKEYLENGTH);
-		READMEM(save.p, &trackedList[i].lastseen, sizeof(trackedList[i].lastseen));
-		for(j = 0; j < PWRLV_NUMTYPES; j++)
-		{
-			trackedList[i].powerlevels[j] = READUINT16(save.p);
-		}
+	SV_ExpandStats(count);
 
-		// Migration 1 -> 2: Add finishedrounds
-		if (version < 2)
-			trackedList[i].finishedrounds = 0;
-		else
-			trackedList[i].finishedrounds = READUINT32(save.p);
+	for(i = 0; i < count; i++)
+	{
+		uint8_t key[PUBKEYLENGTH];
+		serverplayer_t *stat;
 
-		trackedList[i].hash = quickncasehash((char*)trackedList[i].public_key, PUBKEYLENGTH);
+		READMEM(save.p, key, PUBKEYLENGTH);
+		stat = SV_AddStats(key, SV_KeyHash(key));
+		SV_ReadRecord(&save.p, stat, version);
 	}
+
+	P_SaveBufferFree(&save);
+
+	// No journal before version 3
+	if (version >= 3)
+		SV_LoadJournal();
 }
 
-// Save trackedList to disc
+// Write every record to disc, and start a new journal
 void SV_SaveStats(void)
 {
-	size_t length = 0;
 	const size_t headerlen = strlen(SERVERSTATSHEADER);
-	savebuffer_t save = {0};
-	unsigned int i, j;
+	UINT8 *buffer, *p;
+	size_t i;
 
 	if (!server)
 		return;
 
-	// header + version + numtracked + payload
-	if (P_SaveBufferAlloc(&save, headerlen + sizeof(UINT32) + sizeof(UINT8) + (numtracked * sizeof(serverplayer_t))) == false)
+	SV_InitializeStats();
+
+	// Files are only ever written by one job at a time
+	SV_FinishStatsJob(true);
+
+	// header + version + generation + numtracked + payload
+	buffer = malloc(headerlen + sizeof(UINT8) + sizeof(UINT32) + sizeof(UINT32) + (numtracked * STATSRECORDSIZE));
+	if (buffer == NULL)
 	{
 		I_Error("No more free memory for saving server stats\n");
 		return;
 	}
 
+	p = buffer;
+
 	// Add header.
-	WRITESTRINGN(save.p, SERVERSTATSHEADER, headerlen);
+	WRITESTRINGN(p, SERVERSTATSHEADER, headerlen);
 
-	WRITEUINT8(save.p, SERVERSTATSVER);
+	WRITEUINT8(p, SERVERSTATSVER);
 
-	WRITEUINT32(save.p, numtracked);
+	WRITEUINT32(p, ++statsgeneration);
+
+	WRITEUINT32(p, numtracked);
 
 	for(i = 0; i < numtracked; i++)
 	{
-		WRITEMEM(save.p, trackedList[i].public_key, PUBKEYLENGTH);
-		WRITEMEM(save.p, &trackedList[i].lastseen, sizeof(trackedList[i].lastseen));
-		for(j = 0; j < PWRLV_NUMTYPES; j++)
-		{
-			WRITEUINT16(save.p, trackedList[i].powerlevels[j]);
-		}
-		WRITEUINT32(save.p, trackedList[i].finishedrounds);
+		serverplayer_t *stat = SV_StatsAt(i);
+
+		SV_WriteRecord(&p, stat);
+		stat->dirty = false;
 	}
 
-	length = save.p - save.buffer;
+	journalrecords = 0;
+	compactpending = false;
+
+	SV_StartStatsJob(buffer, p - buffer, true);
+}
+
+// Append changed records to the journal, or write everything if it's grown as big as the file
+static void SV_FlushStats(void)
+{
+	UINT8 *buffer, *p;
+	size_t i, count = 0;
+
+	SV_FinishStatsJob(true);
 
-	if (!FIL_WriteFile(va(pandf, srb2home, SERVERSTATSFILE), save.buffer, length))
+	for(i = 0; i < numtracked; i++)
 	{
-		P_SaveBufferFree(&save);
-		I_Error("Couldn't save server stats. Are you out of disk space / playing in a protected folder?");
+		if (SV_StatsAt(i)->dirty)
+			count++;
 	}
-	P_SaveBufferFree(&save);
+
+	if (compactpending || journalrecords + count > max(numtracked, MINJOURNALRECORDS))
+	{
+		SV_SaveStats();
+		return;
+	}
+
+	if (count == 0)
+		return;
+
+	buffer = malloc(count * JOURNALRECORDSIZE);
+	if (buffer == NULL)
+	{
+		SV_SaveStats();
+		return;
+	}
+
+	p = buffer;
+
+	for(i = 0; i < numtracked; i++)
+	{
+		serverplayer_t *stat = SV_StatsAt(i);
+		UINT8 *record = p;
+
+		if (!stat->dirty)
+			continue;
+
+		SV_WriteRecord(&p, stat);
+		WRITEUINT32(p, SV_Checksum(record, STATSRECORDSIZE));
+		stat->dirty = false;
+	}
+
+	journalrecords += count;
+
+	SV_StartStatsJob(buffer, p - buffer, false);
 }
 
-// New player, grab their stats from trackedList or initialize new ones if they're new
+// New player, grab their stats or initialize new ones if they're new
 serverplayer_t *SV_GetStatsByKey(uint8_t *key)
 {
-	UINT32 j, hash;
+	const UINT32 hash = SV_KeyHash(key);
+	serverplayer_t *stat;
+	UINT32 j;
 
 	SV_InitializeStats();
 
-	hash = quickncasehash((char*)key, PUBKEYLENGTH);
-
 	// Existing record?
-	for(j = 0; j < numtracked; j++)
-	{
-		if (hash != trackedList[j].hash) // Not crypto magic, just an early out with a faster comparison
-			continue;
-		if (memcmp(trackedList[j].public_key, key, PUBKEYLENGTH) == 0)
-			return &trackedList[j];
-	}
+	stat = SV_FindStats(key, hash);
+	if (stat != NULL)
+		return stat;
 
 	// Untracked below this point, make a new record
-	SV_ExpandStats(numtracked+1);
+	stat = SV_AddStats(key, hash);
 
 	// Default stats
 	// (NB: This will make a GUEST record if someone tries to retrieve GUEST stats, because
 	// at the very least we should try to provide other codepaths the right  _data type_,
 	// but it will not be written back.)
-	trackedList[numtracked].lastseen = time(NULL);
-	memcpy(&trackedList[numtracked].public_key, key, PUBKEYLENGTH);
+	stat->lastseen = time(NULL);
 	for(j = 0; j < PWRLV_NUMTYPES; j++)
 	{
-		trackedList[numtracked].powerlevels[j] = PR_IsKeyGuest(key) ? 0 : PWRLVRECORD_START;
+		stat->powerlevels[j] = PR_IsKeyGuest(key) ? 0 : PWRLVRECORD_START;
 	}
-	trackedList[numtracked].finishedrounds = 0;
-	trackedList[numtracked].hash = quickncasehash((char*)key, PUBKEYLENGTH);
-
-	numtracked++;
+	stat->finishedrounds = 0;
+	stat->dirty = !PR_IsKeyGuest(key);
 
-	return &trackedList[numtracked - 1];
+	return stat;
 }
 
 serverplayer_t *SV_GetStatsByPlayerIndex(UINT8 p)
@@ -228,11 +680,12 @@ serverplayer_t *SV_GetStats(player_t *player)
 	return SV_GetStatsByKey(player->public_key);
 }
 
-// Write clientpowerlevels and timestamps back to matching trackedList entries, then save trackedList to disk
-// (NB: Stats changes can be made directly to trackedList through other paths, but will only write to disk here)
+// Write clientpowerlevels and timestamps back to matching records, then journal the changes to disk
+// (NB: Stats changes can be made directly to records through other paths, but will only write to disk
+// here, and only if the record is marked dirty)
 void SV_UpdateStats(void)
-{	
-	UINT32 i, j, hash;
+{
+	UINT32 i;
 
 	if (!server)
 		return;
@@ -241,31 +694,27 @@ void SV_UpdateStats(void)
 
 	for(i = 0; i < MAXPLAYERS; i++)
 	{
+		serverplayer_t *stat;
+
 		if (!playeringame[i])
 			continue;
 
 		if (PR_IsKeyGuest(players[i].public_key))
 			continue;
 
-		hash = quickncasehash((char*)players[i].public_key, PUBKEYLENGTH);
-
-		for(j = 0; j < numtracked; j++)
-		{	
-			if (hash != trackedList[j].hash) // Not crypto magic, just an early out with a faster comparison
-				continue;
-			if (memcmp(&trackedList[j].public_key, players[i].public_key, PUBKEYLENGTH) == 0)
-			{
-				trackedList[j].lastseen = time(NULL);
-				memcpy(&trackedList[j].powerlevels, clientpowerlevels[i], sizeof(trackedList[j].powerlevels));
-				break;
-			}
-		}
+		stat = SV_FindStats(players[i].public_key, SV_KeyHash(players[i].public_key));
 
 		// SV_RetrievePWR should always be called for a key before SV_UpdateStats runs,
 		// so this shouldn't be reachable.
+		if (stat == NULL)
+			continue;
+
+		stat->lastseen = time(NULL);
+		memcpy(&stat->powerlevels, clientpowerlevels[i], sizeof(stat->powerlevels));
+		stat->dirty = true;
 	}
 
-	SV_SaveStats();
+	SV_FlushStats();
 }
 
 void SV_BumpMatchStats(void)
@@ -301,6 +750,9 @@ void SV_BumpMatchStats(void)
 		}
 
 		if (participated)
+		{
 			stat->finishedrounds++;
+			stat->dirty = true;
+		}
 	}
 }
\ No newline at end of file
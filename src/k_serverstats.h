@@ -24,7 +24,11 @@ extern "C" {
 
 #define SERVERSTATSFILE "srvstats.dat"
 #define SERVERSTATSHEADER "Doctor Robotnik's Ring Racers Server Stats"
-#define SERVERSTATSVER 2
+#define SERVERSTATSVER 3
+
+// Records changed since SERVERSTATSFILE was last written, appended in order
+#define SERVERSTATSJOURNAL "srvstats.jnl"
+#define SERVERSTATSJOURNALHEADER "Doctor Robotnik's Ring Racers Server Stats Journal"
 
 struct serverplayer_t
 {
@@ -34,12 +38,15 @@ struct serverplayer_t
 	UINT32 finishedrounds;
 
 	UINT32 hash; // Not persisted! Used for early outs during key comparisons
+	boolean dirty; // Not persisted! Needs to go in the journal
 };
 
+// Writes every record to SERVERSTATSFILE in the background
 void SV_SaveStats(void);
 
 void SV_LoadStats(void);
 
+// Records never move, so these pointers stay valid as more keys are tracked
 serverplayer_t *SV_GetStatsByKey(uint8_t *key);
 serverplayer_t *SV_GetStatsByPlayerIndex(UINT8 p);
 serverplayer_t *SV_GetStats(player_t *player);
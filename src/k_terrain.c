@@ -23,6 +23,7 @@
 #include "m_random.h"
 #include "p_local.h"
 #include "p_mobj.h"
+#include "r_particle.h"
 #include "r_textures.h"
 #include "s_sound.h"
 #include "w_wad.h"
@@ -48,6 +49,88 @@ static size_t numTerrainFloorDefs = 0;
 static size_t defaultTerrain = SIZE_MAX;
 static size_t defaultOffroadFootstep = SIZE_MAX;
 
+// Name lookups are chained by the definitions' existing
+// name hashes, so that they don't scan every definition.
+// Chains store (index + 1), so that 0 means empty and the
+// tables can start zeroed.
+#define TERRAIN_HASH_CHAINS (128)
+
+typedef struct
+{
+	size_t chains[TERRAIN_HASH_CHAINS];
+	size_t *next;
+	size_t numNext;
+} t_hashtable_t;
+
+static t_hashtable_t splashHash;
+static t_hashtable_t footstepHash;
+static t_hashtable_t overlayHash;
+static t_hashtable_t terrainHash;
+static t_hashtable_t floorHash;
+
+/*--------------------------------------------------
+	static void K_HashTableInsert(t_hashtable_t *table, UINT32 hash, size_t id)
+
+		Adds a definition to a name lookup table.
+
+	Input Arguments:-
+		table - Lookup table to add to.
+		hash - The definition's name hash.
+		id - The definition's heap index.
+
+	Return:-
+		None
+--------------------------------------------------*/
+static void K_HashTableInsert(t_hashtable_t *table, UINT32 hash, size_t id)
+{
+	const size_t chain = hash % TERRAIN_HASH_CHAINS;
+
+	if (id >= table->numNext)
+	{
+		table->numNext = max(id + 1, table->numNext * 2);
+		table->next = (size_t *)Z_Realloc(table->next, sizeof(size_t) * table->numNext, PU_STATIC, NULL);
+	}
+
+	table->next[id] = table->chains[chain];
+	table->chains[chain] = id + 1;
+}
+
+/*--------------------------------------------------
+	static size_t K_HashTableFirst(const t_hashtable_t *table, UINT32 hash)
+
+		Returns the first definition index that could
+		match this name hash.
+
+	Input Arguments:-
+		table - Lookup table to search.
+		hash - Name hash to search for.
+
+	Return:-
+		Definition heap index, or SIZE_MAX if there are none.
+--------------------------------------------------*/
+static size_t K_HashTableFirst(const t_hashtable_t *table, UINT32 hash)
+{
+	return table->chains[hash % TERRAIN_HASH_CHAINS] - 1;
+}
+
+/*--------------------------------------------------
+	static size_t K_HashTableNext(const t_hashtable_t *table, size_t id)
+
+		Returns the next definition index in the
+		same chain as this one.
+
+	Input Arguments:-
+		table - Lookup table to search.
+		id - Definition index returned from a previous search.
+
+	Return:-
+		Definition heap index, or SIZE_MAX if there are none.
+--------------------------------------------------*/
+static size_t K_HashTableNext(const t_hashtable_t *table, size_t id)
+{
+	return table->next[id] - 1;
+}
+
 /*--------------------------------------------------
 	size_t K_GetSplashHeapIndex(t_splash_t *splash)
 
@@ -103,7 +186,7 @@ t_splash_t *K_GetSplashByName(const char *checkName)
 		return NULL;
 	}
 
-	for (i = 0; i < numSplashDefs; i++)
+	for (i = K_HashTableFirst(&splashHash, checkHash); i != SIZE_MAX; i = K_HashTableNext(&splashHash, i))
 	{
 		t_splash_t *s = &splashDefs[i];
 
@@ -172,7 +255,7 @@ t_footstep_t *K_GetFootstepByName(const char *checkName)
 		return NULL;
 	}
 
-	for (i = 0; i < numFootstepDefs; i++)
+	for (i = K_HashTableFirst(&footstepHash, checkHash); i != SIZE_MAX; i = K_HashTableNext(&footstepHash, i))
 	{
 		t_footstep_t *fs = &footstepDefs[i];
 
@@ -241,7 +324,7 @@ t_overlay_t *K_GetOverlayByName(const char *checkName)
 		return NULL;
 	}
 
-	for (i = 0; i < numOverlayDefs; i++)
+	for (i = K_HashTableFirst(&overlayHash, checkHash); i != SIZE_MAX; i = K_HashTableNext(&overlayHash, i))
 	{
 		t_overlay_t *o = &overlayDefs[i];
 
@@ -307,7 +390,7 @@ terrain_t *K_GetTerrainByName(const char *checkName)
 
 	if (numTerrainDefs > 0)
 	{
-		for (i = 0; i < numTerrainDefs; i++)
+		for (i = K_HashTableFirst(&terrainHash, checkHash); i != SIZE_MAX; i = K_HashTableNext(&terrainHash, i))
 		{
 			terrain_t *t = &terrainDefs[i];
 
@@ -344,7 +427,7 @@ terrain_t *K_GetTerrainForTextureName(const char *checkName)
 
 	if (numTerrainFloorDefs > 0)
 	{
-		for (i = 0; i < numTerrainFloorDefs; i++)
+		for (i = K_HashTableFirst(&floorHash, checkHash); i != SIZE_MAX; i = K_HashTableNext(&floorHash, i))
 		{
 			t_floor_t *f = &terrainFloorDefs[i];
 
@@ -709,6 +792,47 @@ void K_SetDefaultFriction(mobj_t *mo)
 	}
 }
 
+/*--------------------------------------------------
+	static void K_SpawnTerrainParticle(mobj_t *mo, mobjtype_t type, fixed_t xOff, fixed_t yOff, fixed_t momx, fixed_t momy, fixed_t momz, fixed_t scale, UINT16 color)
+
+		Spawns a visual-only particle in place of a
+		splash or footstep object. Mirrors the placement
+		of P_SpawnMobjFromMobj.
+
+	Input Arguments:-
+		mo - The object to spawn the particle from.
+		type - Object type to take the states from.
+		xOff - Unscaled X offset from the object.
+		yOff - Unscaled Y offset from the object.
+		momx - X momentum of the particle.
+		momy - Y momentum of the particle.
+		momz - Z momentum of the particle.
+		scale - Scale multiplier, relative to the object.
+		color - Colorize effect, or SKINCOLOR_NONE.
+
+	Return:-
+		N/A
+--------------------------------------------------*/
+static void K_SpawnTerrainParticle(mobj_t *mo, mobjtype_t type, fixed_t xOff, fixed_t yOff, fixed_t momx, fixed_t momy, fixed_t momz, fixed_t scale, UINT16 color)
+{
+	particledef_t def;
+
+	def.type = type;
+	def.x = mo->x + FixedMul(xOff, mo->scale);
+	def.y = mo->y + FixedMul(yOff, mo->scale);
+	def.z = P_GetMobjFeet(mo);
+	def.momx = momx;
+	def.momy = momy;
+	def.momz = momz;
+	def.scale = FixedMul(mo->scale, scale);
+	def.floorz = mo->floorz;
+	def.ceilingz = mo->ceilingz;
+	def.color = color;
+	def.flip = P_IsObjectFlipped(mo);
+
+	R_SpawnParticle(&def);
+}
+
 /*--------------------------------------------------
 	static void K_SpawnSplashParticles(mobj_t *mo, t_splash_t *s, fixed_t impact)
 
@@ -761,10 +885,31 @@ static void K_SpawnSplashParticles(mobj_t *mo, t_splash_t *s, fixed_t impact)
 			pushAngle += P_RandomRange(PR_TERRAIN, -s->cone / ANG1, s->cone / ANG1) * ANG1;
 		}
 
+		xOff += (12 * FINECOSINE(pushAngle >> ANGLETOFINESHIFT));
+		yOff += (12 * FINESINE(pushAngle >> ANGLETOFINESHIFT));
+
+		if (s->particle == true)
+		{
+			K_SpawnTerrainParticle(
+				mo, s->mobjType, xOff, yOff,
+				(mo->momx / 2) + FixedMul(momH, FINECOSINE(pushAngle >> ANGLETOFINESHIFT)),
+				(mo->momy / 2) + FixedMul(momH, FINESINE(pushAngle >> ANGLETOFINESHIFT)),
+				(momV / 16) * P_MobjFlip(mo),
+				s->scale, s->color
+			);
+
+			if (s->sfx != sfx_None)
+			{
+				S_StartSound(mo, s->sfx);
+			}
+
+			continue;
+		}
+
 		dust = P_SpawnMobjFromMobj(
 			mo,
-			xOff + (12 * FINECOSINE(pushAngle >> ANGLETOFINESHIFT)),
-			yOff + (12 * FINESINE(pushAngle >> ANGLETOFINESHIFT)),
+			xOff,
+			yOff,
 			0, //P_RandomRange(PR_TERRAIN, 0, s->spread / FRACUNIT) * FRACUNIT,
 			s->mobjType
 		);
@@ -918,33 +1063,44 @@ static void K_SpawnFootstepParticle(mobj_t *mo, t_footstep_t *fs, tic_t timer)
 		yOff = P_RandomRange(PR_TERRAIN, -fs->spread / FRACUNIT, fs->spread / FRACUNIT) * FRACUNIT;
 	}
 
-	dust = P_SpawnMobjFromMobj(
-		mo,
-		xOff + (24 * FINECOSINE(tireAngle >> ANGLETOFINESHIFT)),
-		yOff + (24 * FINESINE(tireAngle >> ANGLETOFINESHIFT)),
-		0, fs->mobjType
-	);
+	xOff += (24 * FINECOSINE(tireAngle >> ANGLETOFINESHIFT));
+	yOff += (24 * FINESINE(tireAngle >> ANGLETOFINESHIFT));
+
+	momH = FixedMul(momentum, fs->pushH);
+	momV = FixedMul(momentum, fs->pushV);
 
-	P_SetTarget(&dust->target, mo);
-	dust->angle = K_MomentumAngle(mo);
+	if (fs->particle == true)
+	{
+		K_SpawnTerrainParticle(
+			mo, fs->mobjType, xOff, yOff,
+			mo->momx + FixedMul(momH, FINECOSINE(pushAngle >> ANGLETOFINESHIFT)),
+			mo->momy + FixedMul(momH, FINESINE(pushAngle >> ANGLETOFINESHIFT)),
+			P_GetMobjZMovement(mo) + (momV / 16) * P_MobjFlip(mo),
+			fs->scale, fs->color
+		);
+	}
+	else
+	{
+		dust = P_SpawnMobjFromMobj(mo, xOff, yOff, 0, fs->mobjType);
 
-	dust->destscale = FixedMul(mo->scale, fs->scale);
-	P_SetScale(dust, dust->destscale);
+		P_SetTarget(&dust->target, mo);
+		dust->angle = K_MomentumAngle(mo);
 
-	dust->momx = mo->momx;
-	dust->momy = mo->momy;
-	dust->momz = P_GetMobjZMovement(mo);
+		dust->destscale = FixedMul(mo->scale, fs->scale);
+		P_SetScale(dust, dust->destscale);
 
-	momH = FixedMul(momentum, fs->pushH);
-	momV = FixedMul(momentum, fs->pushV);
+		dust->momx = mo->momx;
+		dust->momy = mo->momy;
+		dust->momz = P_GetMobjZMovement(mo);
 
-	dust->momx += FixedMul(momH, FINECOSINE(pushAngle >> ANGLETOFINESHIFT));
-	dust->momy += FixedMul(momH, FINESINE(pushAngle >> ANGLETOFINESHIFT));
-	dust->momz += (momV / 16) * P_MobjFlip(mo);
+		dust->momx += FixedMul(momH, FINECOSINE(pushAngle >> ANGLETOFINESHIFT));
+		dust->momy += FixedMul(momH, FINESINE(pushAngle >> ANGLETOFINESHIFT));
+		dust->momz += (momV / 16) * P_MobjFlip(mo);
 
-	if (fs->color != SKINCOLOR_NONE)
-	{
-		dust->color = fs->color;
+		if (fs->color != SKINCOLOR_NONE)
+		{
+			dust->color = fs->color;
+		}
 	}
 
 	if ((fs->sfx != sfx_None) && (fs->sfxFreq > 0) && (timer % fs->sfxFreq == 0))
@@ -1274,6 +1430,7 @@ static void K_SplashDefaults(t_splash_t *splash)
 	splash->cone = ANGLE_11hh;
 
 	splash->numParticles = 8;
+	splash->particle = false;
 }
 
 /*--------------------------------------------------
@@ -1348,6 +1505,10 @@ static void K_ParseSplashParameter(size_t i, char *param, char *val)
 	{
 		splash->numParticles = (UINT8)atoi(val);
 	}
+	else if (stricmp(param, "particle") == 0)
+	{
+		splash->particle = (stricmp(val, "true") == 0);
+	}
 }
 
 /*--------------------------------------------------
@@ -1376,6 +1537,7 @@ static void K_FootstepDefaults(t_footstep_t *footstep)
 	footstep->sfxFreq = 6;
 	footstep->frequency = 1;
 	footstep->requiredSpeed = 0;
+	footstep->particle = false;
 }
 
 /*--------------------------------------------------
@@ -1458,6 +1620,10 @@ static void K_ParseFootstepParameter(size_t i, char *param, char *val)
 	{
 		footstep->requiredSpeed = FLOAT_TO_FIXED(atof(val));
 	}
+	else if (stricmp(param, "particle") == 0)
+	{
+		footstep->particle = (stricmp(val, "true") == 0);
+	}
 }
 
 /*--------------------------------------------------
@@ -1825,27 +1991,20 @@ static boolean K_TERRAINLumpParser(char *data, size_t size)
 
 			if (tkn && pos < size)
 			{
-				t_splash_t *s = NULL;
+				t_splash_t *s = K_GetSplashByName(tkn);
 
 				tknHash = quickncasehash(tkn, TERRAIN_NAME_LEN);
+				i = K_GetSplashHeapIndex(s);
 
-				for (i = 0; i < numSplashDefs; i++)
-				{
-					s = &splashDefs[i];
-
-					if (tknHash == s->hash && !strncmp(tkn, s->name, TERRAIN_NAME_LEN))
-					{
-						break;
-					}
-				}
-
-				if (i == numSplashDefs)
+				if (s == NULL)
 				{
+					i = numSplashDefs;
 					K_NewSplashDefs();
 					s = &splashDefs[i];
 
 					strncpy(s->name, tkn, TERRAIN_NAME_LEN);
 					s->hash = tknHash;
+					K_HashTableInsert(&splashHash, tknHash, i);
 
 					CONS_Printf("Created new Splash type '%s'\n", s->name);
 				}
@@ -1866,27 +2025,20 @@ static boolean K_TERRAINLumpParser(char *data, size_t size)
 
 			if (tkn && pos < size)
 			{
-				t_footstep_t *fs = NULL;
+				t_footstep_t *fs = K_GetFootstepByName(tkn);
 
 				tknHash = quickncasehash(tkn, TERRAIN_NAME_LEN);
+				i = K_GetFootstepHeapIndex(fs);
 
-				for (i = 0; i < numFootstepDefs; i++)
-				{
-					fs = &footstepDefs[i];
-
-					if (tknHash == fs->hash && !strncmp(tkn, fs->name, TERRAIN_NAME_LEN))
-					{
-						break;
-					}
-				}
-
-				if (i == numFootstepDefs)
+				if (fs == NULL)
 				{
+					i = numFootstepDefs;
 					K_NewFootstepDefs();
 					fs = &footstepDefs[i];
 
 					strncpy(fs->name, tkn, TERRAIN_NAME_LEN);
 					fs->hash = tknHash;
+					K_HashTableInsert(&footstepHash, tknHash, i);
 
 					CONS_Printf("Created new Footstep type '%s'\n", fs->name);
 				}
@@ -1907,27 +2059,20 @@ static boolean K_TERRAINLumpParser(char *data, size_t size)
 
 			if (tkn && pos < size)
 			{
-				t_overlay_t *o = NULL;
+				t_overlay_t *o = K_GetOverlayByName(tkn);
 
 				tknHash = quickncasehash(tkn, TERRAIN_NAME_LEN);
+				i = K_GetOverlayHeapIndex(o);
 
-				for (i = 0; i < numOverlayDefs; i++)
-				{
-					o = &overlayDefs[i];
-
-					if (tknHash == o->hash && !strncmp(tkn, o->name, TERRAIN_NAME_LEN))
-					{
-						break;
-					}
-				}
-
-				if (i == numOverlayDefs)
+				if (o == NULL)
 				{
+					i = numOverlayDefs;
 					K_NewOverlayDefs();
 					o = &overlayDefs[i];
 
 					strncpy(o->name, tkn, TERRAIN_NAME_LEN);
 					o->hash = tknHash;
+					K_HashTableInsert(&overlayHash, tknHash, i);
 
 					CONS_Printf("Created new Overlay type '%s'\n", o->name);
 				}
@@ -1948,27 +2093,20 @@ static boolean K_TERRAINLumpParser(char *data, size_t size)
 
 			if (tkn && pos < size)
 			{
-				terrain_t *t = NULL;
+				terrain_t *t = K_GetTerrainByName(tkn);
 
 				tknHash = quickncasehash(tkn, TERRAIN_NAME_LEN);
+				i = K_GetTerrainHeapIndex(t);
 
-				for (i = 0; i < numTerrainDefs; i++)
-				{
-					t = &terrainDefs[i];
-
-					if (tknHash == t->hash && !strncmp(tkn, t->name, TERRAIN_NAME_LEN))
-					{
-						break;
-					}
-				}
-
-				if (i == numTerrainDefs)
+				if (t == NULL)
 				{
+					i = numTerrainDefs;
 					K_NewTerrainDefs();
 					t = &terrainDefs[i];
 
 					strncpy(t->name, tkn, TERRAIN_NAME_LEN);
 					t->hash = tknHash;
+					K_HashTableInsert(&terrainHash, tknHash, i);
 
 					CONS_Printf("Created new Terrain type '%s'\n", t->name);
 				}
@@ -2004,7 +2142,7 @@ static boolean K_TERRAINLumpParser(char *data, size_t size)
 
 					tknHash = quickncasehash(tkn, 8);
 
-					for (i = 0; i < numTerrainFloorDefs; i++)
+					for (i = K_HashTableFirst(&floorHash, tknHash); i != SIZE_MAX; i = K_HashTableNext(&floorHash, i))
 					{
 						f = &terrainFloorDefs[i];
 
@@ -2014,13 +2152,15 @@ static boolean K_TERRAINLumpParser(char *data, size_t size)
 						}
 					}
 
-					if (i == numTerrainFloorDefs)
+					if (i == SIZE_MAX)
 					{
+						i = numTerrainFloorDefs;
 						K_NewTerrainFloorDefs();
 						f = &terrainFloorDefs[i];
 
 						strncpy(f->textureName, tkn, 8);
 						f->textureHash = tknHash;
+						K_HashTableInsert(&floorHash, tknHash, i);
 					}
 
 					Z_Free(tkn);
@@ -2074,21 +2214,11 @@ static boolean K_TERRAINLumpParser(char *data, size_t size)
 
 			if (tkn && pos < size)
 			{
-				terrain_t *t = NULL;
+				terrain_t *t = K_GetTerrainByName(tkn);
 
-				tknHash = quickncasehash(tkn, TERRAIN_NAME_LEN);
+				i = K_GetTerrainHeapIndex(t);
 
-				for (i = 0; i < numTerrainDefs; i++)
-				{
-					t = &terrainDefs[i];
-
-					if (tknHash == t->hash && !strncmp(tkn, t->name, TERRAIN_NAME_LEN))
-					{
-						break;
-					}
-				}
-
-				if (i == numTerrainDefs)
+				if (t == NULL)
 				{
 					CONS_Alert(CONS_ERROR, "Invalid DefaultTerrain type.\n");
 					valid = false;
@@ -2113,21 +2243,11 @@ static boolean K_TERRAINLumpParser(char *data, size_t size)
 
 			if (tkn && pos < size)
 			{
-				t_footstep_t *fs = NULL;
+				t_footstep_t *fs = K_GetFootstepByName(tkn);
 
-				tknHash = quickncasehash(tkn, TERRAIN_NAME_LEN);
-
-				for (i = 0; i < numFootstepDefs; i++)
-				{
-					fs = &footstepDefs[i];
-
-					if (tknHash == fs->hash && !strncmp(tkn, fs->name, TERRAIN_NAME_LEN))
-					{
-						break;
-					}
-				}
+				i = K_GetFootstepHeapIndex(fs);
 
-				if (i == numFootstepDefs)
+				if (fs == NULL)
 				{
 					CONS_Alert(CONS_ERROR, "Invalid DefaultOffroadFootstep type.\n");
 					valid = false;
@@ -45,6 +45,7 @@ struct t_splash_t
 	angle_t cone;			// Randomized angle of the push-out.
 
 	UINT8 numParticles;		// Number of particles to spawn.
+	boolean particle;		// Spawn visual-only particles instead of objects.
 };
 
 struct t_footstep_t
@@ -68,6 +69,7 @@ struct t_footstep_t
 	tic_t sfxFreq;			// How frequently to play the sound.
 	tic_t frequency;		// How frequently to spawn the particles.
 	fixed_t requiredSpeed;	// Speed percentage you need to be at to trigger the particles.
+	boolean particle;		// Spawn visual-only particles instead of objects.
 };
 
 typedef enum
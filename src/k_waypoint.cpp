@@ -2918,9 +2918,9 @@ static boolean K_AnchorWaypointRadius(
 {
 	if (anchor->spawnpoint->angle == waypointmobj->spawnpoint->angle)
 	{
-		waypointmobj->radius = R_PointToDist2(
+		P_SetThingRadius(waypointmobj, R_PointToDist2(
 				waypointmobj->x, waypointmobj->y,
-				anchor->x, anchor->y);
+				anchor->x, anchor->y));
 
 		// Keep changes for -writetextmap
 		waypointmobj->spawnpoint->thing_args[1] = waypointmobj->radius >> FRACBITS;
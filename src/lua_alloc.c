@@ -0,0 +1,227 @@
+// DR. ROBOTNIK'S RING RACERS
+//-----------------------------------------------------------------------------
+// Copyright (C) 2024 by Kart Krew.
+//
+// This program is free software distributed under the
+// terms of the GNU General Public License, version 2.
+// See the 'LICENSE' file for more details.
+//-----------------------------------------------------------------------------
+/// \file  lua_alloc.c
+/// \brief Pooled allocator for the Lua state
+///
+///        Most of what Lua allocates is tiny: strings, tables, closures,
+///        upvalues. Those come from free lists of fixed size classes, carved
+///        out of large slabs, instead of the zone. Lua passes the old size
+///        back on every free and realloc, so blocks don't need a header.
+
+#include "doomdef.h"
+#include "i_system.h"
+#include "lua_alloc.h"
+
+#define LUAPOOL_SLABSIZE (64*1024)
+// Objects are only 8-byte aligned (16 for classes that are multiples of 16),
+// which is all LUAI_USER_ALIGNMENT_T asks for
+#define LUAPOOL_SLABHEADER 16
+#define LUAPOOL_MAXSIZE 256 // anything bigger is a plain malloc
+
+#define LUAPOOL_LARGE 0xFF
+
+static const UINT16 luapool_classsizes[] = {
+	8, 16, 24, 32, 40, 48, 56, 64,
+	80, 96, 112, 128, 160, 192, 224, 256
+};
+
+#define NUMLUAPOOLCLASSES (sizeof luapool_classsizes / sizeof *luapool_classsizes)
+
+typedef struct luapoolfree_s
+{
+	struct luapoolfree_s *next;
+} luapoolfree_t;
+
+typedef struct luapoolslab_s
+{
+	struct luapoolslab_s *next;
+} luapoolslab_t;
+
+// Size class for each multiple of 8 bytes
+static UINT8 luapool_classforsize[LUAPOOL_MAXSIZE/8 + 1];
+static boolean luapool_ready = false;
+
+static luapoolfree_t *luapool_free[NUMLUAPOOLCLASSES];
+static luapoolslab_t *luapool_slabs;
+
+static luaallocstats_t luapool_stats;
+
+static void LUA_PoolInit(void)
+{
+	size_t i, c = 0;
+
+	for (i = 0; i <= LUAPOOL_MAXSIZE/8; i++)
+	{
+		while (luapool_classsizes[c] < i * 8)
+			c++;
+		luapool_classforsize[i] = (UINT8)c;
+	}
+
+	luapool_ready = true;
+}
+
+static inline UINT8 LUA_PoolClass(size_t size)
+{
+	if (size > LUAPOOL_MAXSIZE)
+		return LUAPOOL_LARGE;
+	return luapool_classforsize[(size + 7) / 8];
+}
+
+static void LUA_PoolRefill(UINT8 c)
+{
+	const size_t size = luapool_classsizes[c];
+	luapoolslab_t *slab = malloc(LUAPOOL_SLABSIZE);
+	UINT8 *p;
+	size_t n;
+
+	if (slab == NULL)
+		I_Error("LUA_PoolRefill: Out of memory");
+
+	slab->next = luapool_slabs;
+	luapool_slabs = slab;
+	luapool_stats.pooled += LUAPOOL_SLABSIZE;
+
+	// Push back to front, so the slab is handed out in address order
+	n = (LUAPOOL_SLABSIZE - LUAPOOL_SLABHEADER) / size;
+	p = (UINT8 *)slab + LUAPOOL_SLABHEADER + (n - 1) * size;
+
+	while (n--)
+	{
+		luapoolfree_t *block = (luapoolfree_t *)p;
+		block->next = luapool_free[c];
+		luapool_free[c] = block;
+		p -= size;
+	}
+}
+
+static void *LUA_PoolGet(UINT8 c, size_t size)
+{
+	luapoolfree_t *block;
+
+	if (c == LUAPOOL_LARGE)
+	{
+		void *p = malloc(size);
+		if (p)
+			luapool_stats.large += size;
+		return p;
+	}
+
+	if (luapool_free[c] == NULL)
+		LUA_PoolRefill(c);
+
+	block = luapool_free[c];
+	luapool_free[c] = block->next;
+	return block;
+}
+
+static void LUA_PoolPut(UINT8 c, void *ptr, size_t size)
+{
+	luapoolfree_t *block = ptr;
+
+	if (c == LUAPOOL_LARGE)
+	{
+		free(ptr);
+		luapool_stats.large -= size;
+		return;
+	}
+
+	block->next = luapool_free[c];
+	luapool_free[c] = block;
+}
+
+void *LUA_PoolAlloc(void *ud, void *ptr, size_t osize, size_t nsize)
+{
+	UINT8 oc, nc;
+	void *p;
+
+	(void)ud;
+
+	if (!luapool_ready)
+		LUA_PoolInit();
+
+	if (ptr == NULL)
+		osize = 0;
+
+	if (nsize == 0)
+	{
+		if (ptr != NULL)
+		{
+			LUA_PoolPut(LUA_PoolClass(osize), ptr, osize);
+			luapool_stats.live -= osize;
+		}
+		return NULL;
+	}
+
+	nc = LUA_PoolClass(nsize);
+
+	if (ptr != NULL)
+	{
+		oc = LUA_PoolClass(osize);
+
+		if (oc == nc && nc != LUAPOOL_LARGE)
+		{
+			// Still fits in the same block
+			luapool_stats.live += nsize - osize;
+			return ptr;
+		}
+
+		if (oc == LUAPOOL_LARGE && nc == LUAPOOL_LARGE)
+		{
+			p = realloc(ptr, nsize);
+			if (p == NULL)
+				return NULL; // Lua raises a memory error and keeps the old block
+
+			luapool_stats.large += nsize - osize;
+			luapool_stats.live += nsize - osize;
+			return p;
+		}
+	}
+
+	p = LUA_PoolGet(nc, nsize);
+	if (p == NULL)
+		return NULL;
+
+	luapool_stats.allocations++;
+	luapool_stats.live += nsize;
+
+	if (ptr != NULL)
+	{
+		M_Memcpy(p, ptr, min(osize, nsize));
+		LUA_PoolPut(LUA_PoolClass(osize), ptr, osize);
+		luapool_stats.live -= osize;
+	}
+
+	return p;
+}
+
+void LUA_PoolRelease(void)
+{
+	size_t c;
+
+	// Something of the old state is still around, so keep everything
+	if (luapool_stats.live != 0)
+		return;
+
+	while (luapool_slabs)
+	{
+		luapoolslab_t *next = luapool_slabs->next;
+		free(luapool_slabs);
+		luapool_slabs = next;
+	}
+
+	for (c = 0; c < NUMLUAPOOLCLASSES; c++)
+		luapool_free[c] = NULL;
+
+	luapool_stats.pooled = 0;
+}
+
+void LUA_GetAllocStats(luaallocstats_t *stats)
+{
+	*stats = luapool_stats;
+}
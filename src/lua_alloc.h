@@ -0,0 +1,42 @@
+// DR. ROBOTNIK'S RING RACERS
+//-----------------------------------------------------------------------------
+// Copyright (C) 2024 by Kart Krew.
+//
+// This program is free software distributed under the
+// terms of the GNU General Public License, version 2.
+// See the 'LICENSE' file for more details.
+//-----------------------------------------------------------------------------
+/// \file  lua_alloc.h
+/// \brief Pooled allocator for the Lua state
+
+#ifndef __LUA_ALLOC__
+#define __LUA_ALLOC__
+
+#include "doomtype.h"
+#include "typedef.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct luaallocstats_t
+{
+	size_t live; // bytes Lua has allocated
+	size_t pooled; // bytes of pool slabs, used or not
+	size_t large; // bytes allocated outside of the pools
+	UINT32 allocations; // since startup
+};
+
+// lua_Alloc for lua_newstate
+void *LUA_PoolAlloc(void *ud, void *ptr, size_t osize, size_t nsize);
+
+// Give the pool slabs back, once the Lua state is closed
+void LUA_PoolRelease(void);
+
+void LUA_GetAllocStats(luaallocstats_t *stats);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif
@@ -50,6 +50,7 @@ automatically.
 	X (MobjMoveBlocked),/* P_XYMovement (when movement is blocked) */\
 	X (MapThingSpawn),/* P_SpawnMapThing */\
 	X (FollowMobj),/* P_PlayerAfterThink Smiles mobj-following */\
+	X (MobjThinkFrame),/* once per tic, with every mobj of the type that thought */\
 
 #define HOOK_LIST(X) \
 	X (NetVars),/* add to archive table (netsave) */\
@@ -112,6 +113,16 @@ ENUM (STRING_HOOK);
 
 #undef ENUM
 
+/*
+Bit MOBJ_HOOK(name) of mobjhookmask[type] is set when that hook has anything to
+call for the type, generic hooks included. The mobj hooks below are wrapped in
+macros that check it first, so types nobody hooked never touch the Lua stack,
+and nothing is set at all when no Lua is loaded.
+*/
+extern UINT32 mobjhookmask[NUMMOBJTYPES];
+
+#define LUA_MobjHooked(type, hook) (mobjhookmask[type] & (1U << (hook)))
+
 /* dead simple, LUA_HOOK(GameQuit) */
 #define LUA_HOOK(type) LUA_HookVoid(HOOK(type))
 //#define LUA_HUDHOOK(type) LUA_HookHUD(HUD_HOOK(type))
@@ -123,6 +134,7 @@ void LUA_HookHUD(huddrawlist_h, int hook);
 
 int  LUA_HookMobj(mobj_t *, int hook);
 int  LUA_Hook2Mobj(mobj_t *, mobj_t *, int hook);
+void LUA_QueueMobjThinkFrame(mobj_t *); // MobjThinkFrame is called with the queue in LUA_HookThinkFrame
 void LUA_HookInt(INT32 integer, int hook);
 void LUA_HookBool(boolean value, int hook);
 int  LUA_HookPlayer(player_t *, int hook);
@@ -147,6 +159,29 @@ int  LUA_HookTeamSwitch(player_t *, int newteam, boolean fromspectators, boolean
 int  LUA_HookViewpointSwitch(player_t *player, player_t *newdisplayplayer, boolean forced);
 int  LUA_HookSeenPlayer(player_t *player, player_t *seenfriend);
 
+#define LUA_HookMobj(mobj, hook) \
+	(LUA_MobjHooked((mobj)->type, hook) ? (LUA_HookMobj)(mobj, hook) : 0)
+#define LUA_Hook2Mobj(t1, t2, hook) \
+	(LUA_MobjHooked((t1)->type, hook) ? (LUA_Hook2Mobj)(t1, t2, hook) : 0)
+#define LUA_QueueMobjThinkFrame(mobj) \
+	(LUA_MobjHooked((mobj)->type, MOBJ_HOOK(MobjThinkFrame)) ? (LUA_QueueMobjThinkFrame)(mobj) : (void)0)
+#define LUA_HookMobjLineCollide(mobj, line) \
+	(LUA_MobjHooked((mobj)->type, MOBJ_HOOK(MobjLineCollide)) ? (LUA_HookMobjLineCollide)(mobj, line) : 0)
+#define LUA_HookTouchSpecial(special, toucher) \
+	(LUA_MobjHooked((special)->type, MOBJ_HOOK(TouchSpecial)) ? (LUA_HookTouchSpecial)(special, toucher) : 0)
+#define LUA_HookShouldDamage(target, inflictor, source, damage, damagetype) \
+	(LUA_MobjHooked((target)->type, MOBJ_HOOK(ShouldDamage)) ? (LUA_HookShouldDamage)(target, inflictor, source, damage, damagetype) : 0)
+#define LUA_HookMobjDamage(target, inflictor, source, damage, damagetype) \
+	(LUA_MobjHooked((target)->type, MOBJ_HOOK(MobjDamage)) ? (LUA_HookMobjDamage)(target, inflictor, source, damage, damagetype) : 0)
+#define LUA_HookMobjDeath(target, inflictor, source, damagetype) \
+	(LUA_MobjHooked((target)->type, MOBJ_HOOK(MobjDeath)) ? (LUA_HookMobjDeath)(target, inflictor, source, damagetype) : 0)
+#define LUA_HookMobjMoveBlocked(t1, t2, line) \
+	(LUA_MobjHooked((t1)->type, MOBJ_HOOK(MobjMoveBlocked)) ? (LUA_HookMobjMoveBlocked)(t1, t2, line) : 0)
+#define LUA_HookMapThingSpawn(mobj, mthing) \
+	(LUA_MobjHooked((mobj)->type, MOBJ_HOOK(MapThingSpawn)) ? (LUA_HookMapThingSpawn)(mobj, mthing) : 0)
+#define LUA_HookFollowMobj(player, mobj) \
+	(LUA_MobjHooked((mobj)->type, MOBJ_HOOK(FollowMobj)) ? (LUA_HookFollowMobj)(player, mobj) : 0)
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
@@ -60,6 +60,8 @@ static hook_t hookIds[HOOK(MAX)];
 static hook_t hudHookIds[HUD_HOOK(MAX)];
 static hook_t mobjHookIds[NUMMOBJTYPES][MOBJ_HOOK(MAX)];
 
+UINT32 mobjhookmask[NUMMOBJTYPES];
+
 // Lua tables are used to lookup string hook ids.
 static stringhook_t stringHooks[STRING_HOOK(MAX)];
 
@@ -74,11 +76,7 @@ static int errorRef;
 
 static boolean mobj_hook_available(int hook_type, mobjtype_t mobj_type)
 {
-	return
-		(
-				mobjHookIds [MT_NULL] [hook_type].numHooks > 0 ||
-				mobjHookIds[mobj_type][hook_type].numHooks > 0
-		);
+	return LUA_MobjHooked(mobj_type, hook_type) != 0;
 }
 
 static int hook_in_list
@@ -167,6 +165,16 @@ static void add_mobj_hook(lua_State *L, int hook_type)
 	luaL_argcheck(L, mobj_type < NUMMOBJTYPES, 3, "invalid mobjtype_t");
 
 	add_hook(&mobjHookIds[mobj_type][hook_type]);
+
+	if (mobj_type == MT_NULL)
+	{
+		/* generic hooks run for every type */
+		mobjtype_t i;
+		for (i = 0; i < NUMMOBJTYPES; ++i)
+			mobjhookmask[i] |= 1U << hook_type;
+	}
+	else
+		mobjhookmask[mobj_type] |= 1U << hook_type;
 }
 
 static void add_hud_hook(lua_State *L, int idx)
@@ -557,6 +565,7 @@ static int call_hooks
 		calls += call_mobj_type_hooks(hook, hook->mobj_type);
 
 		ps_lua_mobjhooks += calls;
+		ps_lua_mobjhooks_bytype[hook->mobj_type] += calls;
 	}
 	else
 		calls += call_mapped(hook, &hookIds[hook->hook_type]);
@@ -599,7 +608,7 @@ static void res_force(Hook_State *hook)
                                GENERALISED HOOKS
    ========================================================================= */
 
-int LUA_HookMobj(mobj_t *mobj, int hook_type)
+int (LUA_HookMobj)(mobj_t *mobj, int hook_type)
 {
 	Hook_State hook;
 	if (prepare_mobj_hook(&hook, false, hook_type, mobj->type))
@@ -610,7 +619,112 @@ int LUA_HookMobj(mobj_t *mobj, int hook_type)
 	return hook.status;
 }
 
-int LUA_Hook2Mobj(mobj_t *t1, mobj_t *t2, int hook_type)
+/* mobjs waiting for MobjThinkFrame, chained per type in thinker order */
+typedef struct {
+	mobj_t *mobj;
+	INT32   next;/* index + 1, 0 ends the chain */
+} thinkframe_entry_t;
+
+static thinkframe_entry_t * thinkframeQueue;
+static INT32 thinkframeQueueLength;
+static INT32 thinkframeQueueCapacity;
+
+static INT32 thinkframeHead[NUMMOBJTYPES];/* index + 1 */
+static INT32 thinkframeTail[NUMMOBJTYPES];
+static mobjtype_t thinkframeTypes[NUMMOBJTYPES];/* in order of first think */
+static INT32 numThinkframeTypes;
+
+static tic_t thinkframeTic;
+
+static void clear_thinkframe_queue(void)
+{
+	INT32 i;
+
+	for (i = 0; i < numThinkframeTypes; ++i)
+		thinkframeHead[thinkframeTypes[i]] = 0;
+
+	numThinkframeTypes = 0;
+	thinkframeQueueLength = 0;
+}
+
+void (LUA_QueueMobjThinkFrame)(mobj_t *mobj)
+{
+	const mobjtype_t type = mobj->type;
+	INT32 n;
+
+	if (thinkframeTic != leveltime)
+	{
+		/* left over from a tic that never reached ThinkFrame */
+		clear_thinkframe_queue();
+		thinkframeTic = leveltime;
+	}
+
+	if (thinkframeQueueLength == thinkframeQueueCapacity)
+	{
+		thinkframeQueueCapacity = thinkframeQueueCapacity ? thinkframeQueueCapacity * 2 : 256;
+		Z_Realloc(thinkframeQueue, thinkframeQueueCapacity * sizeof *thinkframeQueue,
+				PU_STATIC, &thinkframeQueue);
+	}
+
+	n = thinkframeQueueLength++;
+	thinkframeQueue[n].mobj = mobj;
+	thinkframeQueue[n].next = 0;
+
+	if (thinkframeHead[type] == 0)
+	{
+		thinkframeHead[type] = n + 1;
+		thinkframeTypes[numThinkframeTypes++] = type;
+	}
+	else
+		thinkframeQueue[thinkframeTail[type] - 1].next = n + 1;
+
+	thinkframeTail[type] = n + 1;
+}
+
+/* one call per type, with a table of every mobj of that type that thought */
+static void call_mobj_thinkframe_hooks(void)
+{
+	INT32 i, k;
+
+	if (thinkframeTic != leveltime)
+	{
+		clear_thinkframe_queue();
+		return;
+	}
+
+	for (i = 0; i < numThinkframeTypes; ++i)
+	{
+		const mobjtype_t type = thinkframeTypes[i];
+		Hook_State hook;
+		int n = 0;
+
+		if (!prepare_mobj_hook(&hook, 0, MOBJ_HOOK(MobjThinkFrame), type))
+			continue;
+
+		lua_newtable(gL);
+
+		for (k = thinkframeHead[type]; k; k = thinkframeQueue[k - 1].next)
+		{
+			mobj_t *mobj = thinkframeQueue[k - 1].mobj;
+
+			/* removed mobjs aren't freed before the next tic */
+			if (P_MobjWasRemoved(mobj))
+				continue;
+
+			LUA_PushUserdata(gL, mobj, META_MOBJ);
+			lua_rawseti(gL, -2, ++n);
+		}
+
+		if (n > 0)
+			call_hooks(&hook, 0, res_none);
+		else
+			lua_settop(gL, 0);
+	}
+
+	clear_thinkframe_queue();
+}
+
+int (LUA_Hook2Mobj)(mobj_t *t1, mobj_t *t2, int hook_type)
 {
 	Hook_State hook;
 	if (prepare_mobj_hook(&hook, 0, hook_type, t1->type))
@@ -715,6 +829,8 @@ void LUA_HookThinkFrame(void)
 	const hook_t * map = &hookIds[type];
 	int k;
 
+	call_mobj_thinkframe_hooks();
+
 	if (prepare_hook(&hook, 0, type))
 	{
 		init_hook_call(&hook, 0, res_none);
@@ -745,7 +861,7 @@ void LUA_HookThinkFrame(void)
 	}
 }
 
-int LUA_HookMobjLineCollide(mobj_t *mobj, line_t *line)
+int (LUA_HookMobjLineCollide)(mobj_t *mobj, line_t *line)
 {
 	Hook_State hook;
 	if (prepare_mobj_hook(&hook, 0, MOBJ_HOOK(MobjLineCollide), mobj->type))
@@ -757,7 +873,7 @@ int LUA_HookMobjLineCollide(mobj_t *mobj, line_t *line)
 	return hook.status;
 }
 
-int LUA_HookTouchSpecial(mobj_t *special, mobj_t *toucher)
+int (LUA_HookTouchSpecial)(mobj_t *special, mobj_t *toucher)
 {
 	Hook_State hook;
 	if (prepare_mobj_hook(&hook, false, MOBJ_HOOK(TouchSpecial), special->type))
@@ -793,25 +909,25 @@ static int damage_hook
 	return hook.status;
 }
 
-int LUA_HookShouldDamage(mobj_t *target, mobj_t *inflictor, mobj_t *source, INT32 damage, UINT8 damagetype)
+int (LUA_HookShouldDamage)(mobj_t *target, mobj_t *inflictor, mobj_t *source, INT32 damage, UINT8 damagetype)
 {
 	return damage_hook(target, inflictor, source, damage, damagetype,
 			MOBJ_HOOK(ShouldDamage), res_force);
 }
 
-int LUA_HookMobjDamage(mobj_t *target, mobj_t *inflictor, mobj_t *source, INT32 damage, UINT8 damagetype)
+int (LUA_HookMobjDamage)(mobj_t *target, mobj_t *inflictor, mobj_t *source, INT32 damage, UINT8 damagetype)
 {
 	return damage_hook(target, inflictor, source, damage, damagetype,
 			MOBJ_HOOK(MobjDamage), res_true);
 }
 
-int LUA_HookMobjDeath(mobj_t *target, mobj_t *inflictor, mobj_t *source, UINT8 damagetype)
+int (LUA_HookMobjDeath)(mobj_t *target, mobj_t *inflictor, mobj_t *source, UINT8 damagetype)
 {
 	return damage_hook(target, inflictor, source, 0, damagetype,
 			MOBJ_HOOK(MobjDeath), res_true);
 }
 
-int LUA_HookMobjMoveBlocked(mobj_t *t1, mobj_t *t2, line_t *line)
+int (LUA_HookMobjMoveBlocked)(mobj_t *t1, mobj_t *t2, line_t *line)
 {
 	Hook_State hook;
 	if (prepare_mobj_hook(&hook, 0, MOBJ_HOOK(MobjMoveBlocked), t1->type))
@@ -914,7 +1030,7 @@ void LUA_HookNetArchive(lua_CFunction archFunc, savebuffer_t *save)
 	}
 }
 
-int LUA_HookMapThingSpawn(mobj_t *mobj, mapthing_t *mthing)
+int (LUA_HookMapThingSpawn)(mobj_t *mobj, mapthing_t *mthing)
 {
 	Hook_State hook;
 	if (prepare_mobj_hook(&hook, false, MOBJ_HOOK(MapThingSpawn), mobj->type))
@@ -926,7 +1042,7 @@ int LUA_HookMapThingSpawn(mobj_t *mobj, mapthing_t *mthing)
 	return hook.status;
 }
 
-int LUA_HookFollowMobj(player_t *player, mobj_t *mobj)
+int (LUA_HookFollowMobj)(player_t *player, mobj_t *mobj)
 {
 	Hook_State hook;
 	if (prepare_mobj_hook(&hook, false, MOBJ_HOOK(FollowMobj), mobj->type))
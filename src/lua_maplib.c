@@ -780,6 +780,8 @@ static int sector_set(lua_State *L)
 	if (hook_cmd_running)
 		return luaL_error(L, "Do not alter sector_t in CMD building code!");
 
+	P_InvalidateSectorSight(sector);
+
 	switch(field)
 	{
 	case sector_valid: // valid
@@ -2189,6 +2191,8 @@ static int ffloor_set(lua_State *L)
 	if (hook_cmd_running)
 		return luaL_error(L, "Do not alter ffloor_t in CMD building code!");
 
+	P_InvalidateSectorSight(ffloor->target);
+
 	switch(field)
 	{
 	case ffloor_valid: // valid
@@ -2328,6 +2332,8 @@ static int slope_set(lua_State *L)
 	if (hook_cmd_running)
 		return luaL_error(L, "Do not alter pslope_t in CMD building code!");
 
+	P_InvalidateSightCache();
+
 	switch(field) // todo: reorganize this shit
 	{
 	case slope_valid: // valid
@@ -638,9 +638,10 @@ static int mobj_set(lua_State *L)
 	case mobj_radius:
 	{
 		tm_t ptm = g_tm;
-		mo->radius = luaL_checkfixed(L, 3);
-		if (mo->radius < 0)
-			mo->radius = 0;
+		fixed_t radius = luaL_checkfixed(L, 3);
+		if (radius < 0)
+			radius = 0;
+		P_SetThingRadius(mo, radius);
 		P_CheckPosition(mo, mo->x, mo->y, NULL);
 		mo->floorz = g_tm.floorz;
 		mo->ceilingz = g_tm.ceilingz;
@@ -10,6 +10,8 @@
 
 #include <algorithm>
 #include <cstddef>
+#include <cstdio>
+#include <cstdlib>
 #include <unordered_map>
 #include <string>
 #include <string_view>
@@ -24,9 +26,14 @@ extern "C" {
 #include "v_draw.hpp"
 
 #include "command.h"
+#include "console.h"
+#include "d_main.h"
 #include "doomtype.h"
 #include "i_system.h"
+#include "lua_alloc.h"
+#include "lua_libs.h" // gL
 #include "lua_profile.h"
+#include "lua_script.h"
 #include "m_perfstats.h"
 
 extern "C" consvar_t cv_lua_profile;
@@ -34,12 +41,51 @@ extern "C" consvar_t cv_lua_profile;
 namespace
 {
 
+std::string_view source_label(const char* source)
+{
+	using sv = std::string_view;
+	sv view{source};
+
+	if (view.empty())
+	{
+		return view;
+	}
+
+	switch (view.front())
+	{
+	case '@': // file
+		if (std::size_t p = view.rfind('/'); p != sv::npos) // lump or base
+		{
+			return view.substr(p + 1);
+		}
+		break;
+
+	case '=': // ??
+		view.remove_prefix(1);
+		break;
+	}
+
+	return view;
+}
+
+}; // namespace
+
+namespace
+{
+
 precise_t g_time_reference;
 int g_tics_counted;
 
 double g_running_tic_time;
 double g_avg_tic_time;
 
+// Allocator totals at the start of the window
+UINT32 g_window_allocations;
+int g_window_gc_cycles;
+
+double g_avg_allocations;
+double g_avg_gc_cycles;
+
 bool g_invalid;
 
 }; // namespace
@@ -69,29 +115,7 @@ lua_timer_t* LUA_BeginFunctionTimer(lua_State* L, int fn_idx, const char* name)
 	lua_pushvalue(L, fn_idx);
 	lua_getinfo(L, ">S", &ar);
 
-	auto label = [&]
-	{
-		using sv = std::string_view;
-		sv view{ar.source};
-
-		switch (view.front())
-		{
-		case '@': // file
-			if (std::size_t p = view.rfind('/'); p != sv::npos) // lump or base
-			{
-				return view.substr(p + 1);
-			}
-			break;
-
-		case '=': // ??
-			view.remove_prefix(1);
-			break;
-		}
-
-		return view;
-	};
-
-	auto [it, ins] = g_tic_timers.try_emplace(fmt::format("{}:{} ({})", label(), ar.linedefined, name));
+	auto [it, ins] = g_tic_timers.try_emplace(fmt::format("{}:{} ({})", source_label(ar.source), ar.linedefined, name));
 	auto& [key, timer] = *it;
 
 	g_time_reference = I_GetPreciseTime();
@@ -135,6 +159,23 @@ void LUA_ResetTicTimers(void)
 		g_avg_tic_time = g_running_tic_time / counted;
 		g_running_tic_time = 0.0;
 
+		luaallocstats_t stats;
+		LUA_GetAllocStats(&stats);
+
+		int gc_cycles = gL ? lua_gc(gL, LUA_GCCYCLES, 0) : 0;
+
+		// Closing the state restarts the cycle count
+		if (gc_cycles < g_window_gc_cycles)
+		{
+			g_window_gc_cycles = 0;
+		}
+
+		g_avg_allocations = (stats.allocations - g_window_allocations) / counted;
+		g_avg_gc_cycles = (gc_cycles - g_window_gc_cycles) / counted;
+
+		g_window_allocations = stats.allocations;
+		g_window_gc_cycles = gc_cycles;
+
 		g_tics_counted = 1;
 
 		g_invalid = false;
@@ -201,7 +242,19 @@ void LUA_RenderTimers(void)
 			g_avg_tic_time * TICRATE
 		);
 
-		row = row.y(kRowHeight * 4);
+		luaallocstats_t stats;
+		LUA_GetAllocStats(&stats);
+
+		row.flags(V_GRAYMAP).y(kRowHeight * 3).text(
+			"{:8.1f} KB live ({:.1f} KB pooled, {:.1f} KB large), {:.1f} allocations, {:.3f} GC cycles",
+			stats.live / 1024.0,
+			stats.pooled / 1024.0,
+			stats.large / 1024.0,
+			g_avg_allocations,
+			g_avg_gc_cycles
+		);
+
+		row = row.y(kRowHeight * 5);
 	}
 
 	std::sort(
@@ -241,3 +294,202 @@ extern "C" void lua_profile_OnChange(void)
 		g_tic_timers = {};
 	}
 }
+
+// Sampling profiler. A count hook takes the whole Lua call stack every N
+// instructions. Frames are interned by the contents of the strings
+// lua_getinfo gives back, not their addresses, since those can be
+// collected and reused by another string. The lookup key is reused
+// between samples, so only a new frame allocates.
+
+namespace
+{
+
+struct SampleFrame
+{
+	std::string source;
+	std::string name;
+	int line;
+
+	bool operator==(const SampleFrame& b) const noexcept
+	{
+		return source == b.source && name == b.name && line == b.line;
+	}
+};
+
+struct SampleFrameHash
+{
+	std::size_t operator()(const SampleFrame& f) const noexcept
+	{
+		std::size_t h = std::hash<std::string>{}(f.source);
+		h ^= std::hash<std::string>{}(f.name) + 0x9E3779B9 + (h << 6) + (h >> 2);
+		h ^= std::hash<int>{}(f.line) + 0x9E3779B9 + (h << 6) + (h >> 2);
+		return h;
+	}
+};
+
+struct SampleStackHash
+{
+	std::size_t operator()(const std::vector<uint32_t>& stack) const noexcept
+	{
+		std::size_t h = 14695981039346656037ULL; // FNV-1a
+		for (uint32_t id : stack)
+		{
+			h = (h ^ id) * 1099511628211ULL;
+		}
+		return h;
+	}
+};
+
+constexpr int kMaxSampleDepth = 64;
+constexpr int kDefaultSamplePeriod = 1000;
+constexpr int kMinSamplePeriod = 100;
+
+int g_sample_period; // instructions between samples, 0 when stopped
+std::uint64_t g_samples_taken;
+
+std::unordered_map<SampleFrame, uint32_t, SampleFrameHash> g_sample_frame_ids;
+std::vector<std::string> g_sample_frame_labels;
+std::unordered_map<std::vector<uint32_t>, std::uint64_t, SampleStackHash> g_sample_stacks;
+std::vector<uint32_t> g_sample_scratch;
+SampleFrame g_sample_key;
+
+std::string sample_frame_label(const lua_Debug& ar)
+{
+	if (ar.what && ar.what[0] == 'C')
+	{
+		return fmt::format("[C] {}", ar.name ? ar.name : "?");
+	}
+
+	// ';' separates frames in the collapsed format
+	std::string label = fmt::format("{} {}:{}", ar.name ? ar.name : "?", source_label(ar.source), ar.currentline);
+	std::replace(label.begin(), label.end(), ';', ':');
+	return label;
+}
+
+void sample_hook(lua_State* L, lua_Debug*)
+{
+	lua_Debug ar;
+
+	g_sample_scratch.clear();
+
+	for (int level = 0; level < kMaxSampleDepth && lua_getstack(L, level, &ar); level++)
+	{
+		lua_getinfo(L, "Sln", &ar);
+
+		g_sample_key.source.assign(ar.source ? ar.source : "");
+		g_sample_key.name.assign(ar.name ? ar.name : "?");
+		g_sample_key.line = ar.currentline;
+
+		auto it = g_sample_frame_ids.find(g_sample_key);
+
+		if (it == g_sample_frame_ids.end())
+		{
+			it = g_sample_frame_ids.emplace(g_sample_key, static_cast<uint32_t>(g_sample_frame_labels.size())).first;
+			g_sample_frame_labels.push_back(sample_frame_label(ar));
+		}
+
+		g_sample_scratch.push_back(it->second);
+	}
+
+	// Outermost caller first
+	std::reverse(g_sample_scratch.begin(), g_sample_scratch.end());
+
+	g_sample_stacks[g_sample_scratch]++;
+	g_samples_taken++;
+}
+
+void apply_sample_hook(lua_State* L)
+{
+	if (L == nullptr)
+	{
+		return;
+	}
+
+	if (g_sample_period > 0)
+	{
+		lua_sethook(L, sample_hook, LUA_MASKCOUNT, g_sample_period);
+	}
+	else
+	{
+		lua_sethook(L, nullptr, 0, 0);
+	}
+}
+
+void dump_samples(const char* filename)
+{
+	std::string path = va(pandf, srb2home, filename);
+	FILE* f = fopen(path.c_str(), "w");
+
+	if (f == nullptr)
+	{
+		CONS_Alert(CONS_ERROR, "Couldn't open %s for writing\n", path.c_str());
+		return;
+	}
+
+	std::string line;
+	for (auto& [stack, count] : g_sample_stacks)
+	{
+		line.clear();
+		for (uint32_t id : stack)
+		{
+			if (!line.empty())
+			{
+				line += ';';
+			}
+			line += g_sample_frame_labels[id];
+		}
+		fmt::print(f, "{} {}\n", line, count);
+	}
+
+	fclose(f);
+
+	CONS_Printf("Wrote %s unique stacks from %s samples to %s\n",
+		sizeu1(g_sample_stacks.size()), sizeu2(g_samples_taken), path.c_str());
+}
+
+}; // namespace
+
+void LUA_SampleNewState(lua_State* L)
+{
+	apply_sample_hook(L);
+}
+
+void Command_LuaSample_f(void)
+{
+	const char* action = COM_Argc() > 1 ? COM_Argv(1) : "";
+
+	if (!stricmp(action, "start"))
+	{
+		g_sample_period = COM_Argc() > 2 ? std::max(atoi(COM_Argv(2)), kMinSamplePeriod) : kDefaultSamplePeriod;
+		apply_sample_hook(gL);
+		CONS_Printf("Sampling Lua every %d instructions\n", g_sample_period);
+	}
+	else if (!stricmp(action, "stop"))
+	{
+		g_sample_period = 0;
+		apply_sample_hook(gL);
+		CONS_Printf("Stopped sampling Lua, %s samples taken\n", sizeu1(g_samples_taken));
+	}
+	else if (!stricmp(action, "dump"))
+	{
+		dump_samples(COM_Argc() > 2 ? COM_Argv(2) : "luasamples.txt");
+	}
+	else if (!stricmp(action, "clear"))
+	{
+		g_sample_stacks.clear();
+		g_sample_frame_ids.clear();
+		g_sample_frame_labels.clear();
+		g_samples_taken = 0;
+	}
+	else
+	{
+		CONS_Printf(
+			"lua_sample start [instructions]: sample Lua call stacks (default every %d instructions)\n"
+			"lua_sample stop: stop sampling\n"
+			"lua_sample dump [file]: write collapsed stacks for flamegraph tools\n"
+			"lua_sample clear: forget all samples\n",
+			kDefaultSamplePeriod
+		);
+		CONS_Printf("%s, %s samples\n", g_sample_period > 0 ? "Sampling" : "Not sampling", sizeu1(g_samples_taken));
+	}
+}
@@ -28,6 +28,10 @@ void LUA_EndFunctionTimer(lua_timer_t *timer);
 
 void LUA_RenderTimers(void);
 
+// Sampling profiler, see the lua_sample command
+void LUA_SampleNewState(lua_State *L);
+void Command_LuaSample_f(void);
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
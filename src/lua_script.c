@@ -35,6 +35,8 @@
 #include "lua_script.h"
 #include "lua_libs.h"
 #include "lua_hook.h"
+#include "lua_profile.h"
+#include "lua_alloc.h"
 
 #include "doomstat.h"
 #include "g_state.h"
@@ -42,6 +44,98 @@
 
 lua_State *gL = NULL;
 
+// Userdata made for C pointers, so pushing the same pointer again gives
+// the same userdata. The userdata themselves are anchored in the registry
+// with luaL_ref; this maps each pointer to its reference.
+typedef struct
+{
+	void *data;
+	int ref;
+} luauserdataslot_t;
+
+static luauserdataslot_t *userdataslots;
+static size_t userdatacapacity; // power of two
+static size_t userdatacount;
+static UINT8 userdatabits;
+
+static inline size_t LUA_UserdataHome(void *data)
+{
+	// Fibonacci hashing, the low bits of a pointer are mostly alignment
+	return (size_t)(((UINT64)(uintptr_t)data * UINT64_C(0x9E3779B97F4A7C15)) >> (64 - userdatabits));
+}
+
+// Returns the slot holding data, or the empty slot where it would go
+static inline size_t LUA_FindUserdataSlot(void *data)
+{
+	const size_t mask = userdatacapacity - 1;
+	size_t i = LUA_UserdataHome(data);
+
+	while (userdataslots[i].data != NULL && userdataslots[i].data != data)
+		i = (i + 1) & mask;
+
+	return i;
+}
+
+static void LUA_GrowUserdataSlots(void)
+{
+	luauserdataslot_t *old = userdataslots;
+	size_t oldcapacity = userdatacapacity;
+	size_t i;
+
+	userdatabits = userdatabits ? userdatabits + 1 : 10;
+	userdatacapacity = (size_t)1 << userdatabits;
+	userdataslots = calloc(userdatacapacity, sizeof *userdataslots);
+
+	if (userdataslots == NULL)
+		I_Error("LUA_GrowUserdataSlots: Out of memory");
+
+	for (i = 0; i < oldcapacity; i++)
+	{
+		if (old[i].data != NULL)
+			userdataslots[LUA_FindUserdataSlot(old[i].data)] = old[i];
+	}
+
+	free(old);
+}
+
+static void LUA_RemoveUserdataSlot(size_t i)
+{
+	const size_t mask = userdatacapacity - 1;
+	size_t j = i;
+
+	userdataslots[i].data = NULL;
+	userdatacount--;
+
+	// Shift the rest of the run back, so lookups never need tombstones
+	for (;;)
+	{
+		size_t k;
+
+		j = (j + 1) & mask;
+
+		if (userdataslots[j].data == NULL)
+			break;
+
+		k = LUA_UserdataHome(userdataslots[j].data);
+
+		// Still reachable from its home slot?
+		if ((i <= j) ? (i < k && k <= j) : (i < k || k <= j))
+			continue;
+
+		userdataslots[i] = userdataslots[j];
+		userdataslots[j].data = NULL;
+		i = j;
+	}
+}
+
+static void LUA_ClearUserdataSlots(void)
+{
+	free(userdataslots);
+	userdataslots = NULL;
+	userdatacapacity = userdatacount = 0;
+	userdatabits = 0;
+}
+
 // List of internal libraries to load from SRB2
 static lua_CFunction liblist[] = {
 	LUA_EnumLib, // global metatable for enums
@@ -63,18 +157,6 @@ static lua_CFunction liblist[] = {
 	NULL
 };
 
-// Lua asks for memory using this.
-static void *LUA_Alloc(void *ud, void *ptr, size_t osize, size_t nsize)
-{
-	(void)ud;
-	if (nsize == 0) {
-		if (osize != 0)
-			Z_Free(ptr);
-		return NULL;
-	} else
-		return Z_Realloc(ptr, nsize, PU_LUA, NULL);
-}
-
 // Panic function Lua calls when there's an unprotected error.
 // This function cannot return. Lua would kill the application anyway if it did.
 FUNCNORETURN static int LUA_Panic(lua_State *L)
@@ -492,23 +574,24 @@ void LUA_ClearState(void)
 
 	// close previous state
 	if (gL)
+	{
 		lua_close(gL);
+		LUA_PoolRelease();
+	}
 	gL = NULL;
 
+	LUA_ClearUserdataSlots();
+
 	CONS_Printf(M_GetText("Pardon me while I initialize the Lua scripting interface...\n"));
 
 	// allocate state
-	L = lua_newstate(LUA_Alloc, NULL);
+	L = lua_newstate(LUA_PoolAlloc, NULL);
 	lua_atpanic(L, LUA_Panic);
 
 	// open base libraries
 	luaL_openlibs(L);
 	lua_settop(L, 0);
 
-	// make LREG_VALID table for all pushed userdata cache.
-	lua_newtable(L);
-	lua_setfield(L, LUA_REGISTRYINDEX, LREG_VALID);
-
 	// make LREG_METATABLES table for all registered metatables
 	lua_newtable(L);
 	lua_setfield(L, LUA_REGISTRYINDEX, LREG_METATABLES);
@@ -529,6 +612,8 @@ void LUA_ClearState(void)
 
 	// lua state is ready!
 	gL = L;
+
+	LUA_SampleNewState(L);
 }
 
 #ifdef _DEBUG
@@ -695,7 +780,7 @@ fixed_t LUA_EvalMath(const char *word)
 
 	// make a new state so SOC can't interefere with scripts
 	// allocate state
-	L = lua_newstate(LUA_Alloc, NULL);
+	L = lua_newstate(LUA_PoolAlloc, NULL);
 	lua_atpanic(L, LUA_Panic);
 
 	// open only enum lib
@@ -753,38 +838,36 @@ lpushed_t LUA_RawPushUserdata(lua_State *L, void *data)
 	lpushed_t status = LPUSHED_NIL;
 
 	void **userdata;
+	size_t i;
 
 	if (!data) { // push a NULL
 		lua_pushnil(L);
 		return status;
 	}
 
-	lua_getfield(L, LUA_REGISTRYINDEX, LREG_VALID);
-	I_Assert(lua_istable(L, -1));
+	if (userdatacount >= userdatacapacity / 2)
+		LUA_GrowUserdataSlots();
 
-	lua_pushlightuserdata(L, data);
-	lua_rawget(L, -2);
-
-	if (lua_isnil(L, -1)) { // no userdata? deary me, we'll have to make one.
-		lua_pop(L, 1); // pop the nil
+	i = LUA_FindUserdataSlot(data);
 
+	if (userdataslots[i].data == NULL) { // no userdata? deary me, we'll have to make one.
 		// create the userdata
 		userdata = lua_newuserdata(L, sizeof(void *));
 		*userdata = data;
 
-		// Set it in the registry so we can find it again
-		lua_pushlightuserdata(L, data); // k (store the userdata via the data's pointer)
-		lua_pushvalue(L, -2); // v (copy of the userdata)
-		lua_rawset(L, -4);
-
-		// stack is left with the userdata on top, as if getting it had originally succeeded.
+		// Keep it in the registry so we can find it again
+		lua_pushvalue(L, -1);
+		userdataslots[i].ref = luaL_ref(L, LUA_REGISTRYINDEX);
+		userdataslots[i].data = data;
+		userdatacount++;
 
 		status = LPUSHED_NEW;
 	}
 	else
+	{
+		lua_rawgeti(L, LUA_REGISTRYINDEX, userdataslots[i].ref);
 		status = LPUSHED_EXISTING;
-
-	lua_remove(L, -2); // remove LREG_VALID
+	}
 
 	return status;
 }
@@ -801,37 +884,35 @@ int LUA_PushServerPlayer(lua_State *L)
 void LUA_InvalidateUserdata(void *data)
 {
 	void **userdata;
-	if (!gL)
-		return;
+	size_t i;
+	int ref;
 
-	// fetch the userdata
-	lua_getfield(gL, LUA_REGISTRYINDEX, LREG_VALID);
-	I_Assert(lua_istable(gL, -1));
-		lua_pushlightuserdata(gL, data);
-		lua_rawget(gL, -2);
-			if (lua_isnil(gL, -1)) { // not found, not in lua
-				lua_pop(gL, 2); // pop nil and LREG_VALID
-				return;
-			}
+	if (!gL || !userdatacount)
+		return;
 
-			// nullify any additional data
-			lua_getfield(gL, LUA_REGISTRYINDEX, LREG_EXTVARS);
-			I_Assert(lua_istable(gL, -1));
-				lua_pushlightuserdata(gL, data);
-				lua_pushnil(gL);
-				lua_rawset(gL, -3);
-			lua_pop(gL, 1);
+	i = LUA_FindUserdataSlot(data);
+	if (userdataslots[i].data == NULL) // not found, not in lua
+		return;
 
-			// invalidate the userdata
-			userdata = lua_touserdata(gL, -1);
-			*userdata = NULL;
-		lua_pop(gL, 1);
+	ref = userdataslots[i].ref;
+	LUA_RemoveUserdataSlot(i);
 
-		// remove it from the registry
+	// nullify any additional data
+	lua_getfield(gL, LUA_REGISTRYINDEX, LREG_EXTVARS);
+	I_Assert(lua_istable(gL, -1));
 		lua_pushlightuserdata(gL, data);
 		lua_pushnil(gL);
 		lua_rawset(gL, -3);
-	lua_pop(gL, 1); // pop LREG_VALID
+	lua_pop(gL, 1);
+
+	// invalidate the userdata
+	lua_rawgeti(gL, LUA_REGISTRYINDEX, ref);
+		userdata = lua_touserdata(gL, -1);
+		*userdata = NULL;
+	lua_pop(gL, 1);
+
+	// remove it from the registry
+	luaL_unref(gL, LUA_REGISTRYINDEX, ref);
 }
 
 // Invalidate level data arrays
@@ -840,7 +921,7 @@ void LUA_InvalidateLevel(void)
 	thinker_t *th;
 	size_t i;
 	ffloor_t *rover = NULL;
-	if (!gL)
+	if (!gL || !userdatacount) // nothing was ever pushed
 		return;
 	for (i = 0; i < NUM_THINKERLISTS; i++)
 		for (th = thlist[i].next; th && th != &thlist[i]; th = th->next)
@@ -30,6 +30,11 @@
 // GIFs are always little-endian
 #include "byteptr.h"
 
+#ifdef HAVE_THREADS
+#include "i_threads.h"
+#include "core/thread_pool.h"
+#endif
+
 #ifdef HAVE_ANIGIF
 static boolean gif_optimize = false; // So nobody can do something dumb
 static boolean gif_downscale = false; // like changing cvars mid output
@@ -43,9 +48,17 @@ static RGBA_t *gif_framepalette = NULL;
 
 static FILE *gif_out = NULL;
 static INT32 gif_frames = 0;
+static INT32 gif_dropped = 0;
 static precise_t gif_prevframetime = 0;
 static UINT32 gif_delayus = 0; // "us" is microseconds
-static UINT8 gif_writeover = 0;
+static UINT16 gif_delaycarry = 0; // delay of dropped frames, added to the next one
+
+// Fixed when the GIF is opened, since frames are encoded in the background
+static INT32 gif_width = 0;
+static INT32 gif_height = 0;
+static INT16 gif_downscaleamt = 1;
+
+#define GIF_BPP 3 // frames are diffed as RGB24
 
 
 
@@ -62,13 +75,14 @@ static UINT8 gif_writeover = 0;
 static UINT8 GIF_optimizecmprow(const UINT8 *dst, const UINT8 *src, INT32 row,
 	INT32 *last, INT32 *left, INT32 *right)
 {
-	const UINT8 *dp = dst + (vid.width * row);
-	const UINT8 *sp = src + (vid.width * row);
+	const INT32 pitch = gif_width * GIF_BPP;
+	const UINT8 *dp = dst + (pitch * row);
+	const UINT8 *sp = src + (pitch * row);
 	const UINT8 *dtmp, *stmp;
 	UINT8 doleft = 1, doright = 1;
 	INT32 i = 0;
 
-	if (!memcmp(sp, dp, vid.width))
+	if (!memcmp(sp, dp, pitch))
 		return 0; // unchanged.
 
 	*last = row;
@@ -79,7 +93,7 @@ static UINT8 GIF_optimizecmprow(const UINT8 *dst, const UINT8 *src, INT32 row,
 		doleft = 0;
 	else if (*left > 0) // left set, nonzero
 	{
-		if (!memcmp(sp, dp, *left))
+		if (!memcmp(sp, dp, *left * GIF_BPP))
 			doleft = 0; // left side not changed
 	}
 	while (doleft)
@@ -89,20 +103,20 @@ static UINT8 GIF_optimizecmprow(const UINT8 *dst, const UINT8 *src, INT32 row,
 		if (*dtmp != *stmp)
 		{
 			doleft = 0;
-			*left = i;
+			*left = i / GIF_BPP;
 		}
 		++i;
 	}
 
 	// right side
-	i = vid.width - 1;
-	if (*right == vid.width - 1) // edge reached
+	i = pitch - 1;
+	if (*right == gif_width - 1) // edge reached
 		doright = 0;
 	else if (*right >= 0) // right set, non-end-of-width
 	{
-		dtmp = dp + *right + 1;
-		stmp = sp + *right + 1;
-		if (!memcmp(stmp, dtmp, vid.width - (*right + 1)))
+		dtmp = dp + (*right + 1) * GIF_BPP;
+		stmp = sp + (*right + 1) * GIF_BPP;
+		if (!memcmp(stmp, dtmp, (gif_width - (*right + 1)) * GIF_BPP))
 			doright = 0; // right side not changed
 	}
 	while (doright)
@@ -112,7 +126,7 @@ static UINT8 GIF_optimizecmprow(const UINT8 *dst, const UINT8 *src, INT32 row,
 		if (*dtmp != *stmp)
 		{
 			doright = 0;
-			*right = i;
+			*right = i / GIF_BPP;
 		}
 		--i;
 	}
@@ -132,7 +146,7 @@ static UINT8 GIF_optimizecmprow(const UINT8 *dst, const UINT8 *src, INT32 row,
 static void GIF_optimizeregion(const UINT8 *dst, const UINT8 *src,
 	INT32 *x, INT32 *y, INT32 *w, INT32 *h)
 {
-	INT32 st = 0, sb = vid.height - 1; // work from both directions
+	INT32 st = 0, sb = gif_height - 1; // work from both directions
 	INT32 firstchg_t = -1, firstchg_b = -1; // store first changed row.
 	INT32 lastchg_t = -1, lastchg_b = -1; // Store last row... just in case
 	INT32 lmpix = -1, rmpix = -1; // store left and rightmost change
@@ -143,7 +157,7 @@ static void GIF_optimizeregion(const UINT8 *dst, const UINT8 *src,
 		if (!stopt)
 		{
 			if (GIF_optimizecmprow(dst, src, st++, &lastchg_t, &lmpix, &rmpix)
-			 && lmpix == 0 && rmpix == vid.width - 1)
+			 && lmpix == 0 && rmpix == gif_width - 1)
 				stopt = 1;
 			if (firstchg_t < 0 && lastchg_t >= 0)
 				firstchg_t = lastchg_t;
@@ -151,7 +165,7 @@ static void GIF_optimizeregion(const UINT8 *dst, const UINT8 *src,
 		if (!stopb)
 		{
 			if (GIF_optimizecmprow(dst, src, sb--, &lastchg_b, &lmpix, &rmpix)
-			 && lmpix == 0 && rmpix == vid.width - 1)
+			 && lmpix == 0 && rmpix == gif_width - 1)
 				stopb = 1;
 			if (firstchg_b < 0 && lastchg_b >= 0)
 				firstchg_b = lastchg_b;
@@ -179,28 +193,52 @@ static void GIF_optimizeregion(const UINT8 *dst, const UINT8 *src,
 
 
 
-// GIF Bit WRiter
+// GIF ENCODER
 // ---
-static UINT8 *gifbwr_buf = NULL;
-static UINT8 *gifbwr_cur;
-static UINT8 gifbwr_bufsize = 0;
+// Everything one frame needs to be compressed, so frames can be
+// compressed on separate threads at the same time.
+typedef struct
+{
+	// GIF Bit WRiter
+	UINT8 bwr_buf[256];
+	UINT8 *bwr_cur;
+	UINT8 bwr_bufsize;
+
+	UINT32 bwr_bits_buf;
+	INT32 bwr_bits_num;
+	UINT8 bwr_bits_min;
+
+	// SCReen BUFfer (obviously)
+	const UINT8 *scrbuf_pos;
+	const UINT8 *scrbuf_linebegin;
+	const UINT8 *scrbuf_lineend;
+	const UINT8 *scrbuf_writeend;
 
-static UINT32 gifbwr_bits_buf = 0;
-static INT32 gifbwr_bits_num = 0;
-static UINT8 gifbwr_bits_min = 9;
+	// LZW
+	UINT16 lzw_workingCode;
+	UINT16 lzw_nextCodeToAssign;
+	UINT32 lzw_hashTable[16384];
+
+	boolean writeover;
+} gifencoder_t;
+
+
+
+// GIF Bit WRiter
+// ---
 
 //
 // GIF_bwr_flush
 // flushes any bits remaining in the buffer.
 //
-static void GIF_bwrflush(void)
+static void GIF_bwrflush(gifencoder_t *e)
 {
-	if (gifbwr_bits_num > 0) // will be between 1 and 7
+	if (e->bwr_bits_num > 0) // will be between 1 and 7
 	{
-		WRITEUINT8(gifbwr_cur, (UINT8)(gifbwr_bits_buf&0xFF));
-		++gifbwr_bufsize;
+		WRITEUINT8(e->bwr_cur, (UINT8)(e->bwr_bits_buf&0xFF));
+		++e->bwr_bufsize;
 	}
-	gifbwr_bits_buf = gifbwr_bits_num = 0;
+	e->bwr_bits_buf = e->bwr_bits_num = 0;
 }
 
 //
@@ -208,31 +246,21 @@ static void GIF_bwrflush(void)
 // writes bits into bit buffer,
 // writes into buffer when whole bytes obtained
 //
-static void GIF_bwrwrite(UINT32 idata)
+static void GIF_bwrwrite(gifencoder_t *e, UINT32 idata)
 {
-	gifbwr_bits_buf |= (idata << gifbwr_bits_num);
-	gifbwr_bits_num += gifbwr_bits_min;
-	while (gifbwr_bits_num >= 8)
+	e->bwr_bits_buf |= (idata << e->bwr_bits_num);
+	e->bwr_bits_num += e->bwr_bits_min;
+	while (e->bwr_bits_num >= 8)
 	{
-		WRITEUINT8(gifbwr_cur, (UINT8)(gifbwr_bits_buf&0xFF));
-		gifbwr_bits_buf >>= 8;
-		gifbwr_bits_num -= 8;
-		++gifbwr_bufsize;
+		WRITEUINT8(e->bwr_cur, (UINT8)(e->bwr_bits_buf&0xFF));
+		e->bwr_bits_buf >>= 8;
+		e->bwr_bits_num -= 8;
+		++e->bwr_bufsize;
 	}
 }
 
 
 
-// SCReen BUFfer (obviously)
-// ---
-static UINT8 *scrbuf_pos;
-static UINT8 *scrbuf_linebegin;
-static UINT8 *scrbuf_lineend;
-static UINT8 *scrbuf_writeend;
-static INT16 scrbuf_downscaleamt = 1;
-
-
-
 // GIF LZW algorithm
 // ---
 #define GIFLZW_TABLECLR  0x100
@@ -240,35 +268,29 @@ static INT16 scrbuf_downscaleamt = 1;
 #define GIFLZW_DICTSTART 0x102
 #define GIFLZW_MAXCODE 4096
 
-static UINT16 giflzw_workingCode;
-static UINT16 giflzw_nextCodeToAssign;
-static UINT32 *giflzw_hashTable = NULL; // 16384 required
-
 //
 // GIF_prepareLZW
 // prepatres the LZW hash table for use
 //
-static void GIF_prepareLZW(void)
+static void GIF_prepareLZW(gifencoder_t *e)
 {
-	gifbwr_bits_min = 9;
-	giflzw_nextCodeToAssign = GIFLZW_DICTSTART;
+	e->bwr_bits_min = 9;
+	e->lzw_nextCodeToAssign = GIFLZW_DICTSTART;
 
-	if (!giflzw_hashTable)
-		giflzw_hashTable = Z_Malloc(16384*sizeof(UINT32), PU_STATIC, NULL);
-	memset(giflzw_hashTable, 0, 16384*sizeof(UINT32));
+	memset(e->lzw_hashTable, 0, sizeof(e->lzw_hashTable));
 }
 
 //
 // GIF_searchHash
 // searches the LZW hash table for a match
 //
-static char GIF_searchHash(UINT32 key, UINT32 *pOutput)
+static char GIF_searchHash(const gifencoder_t *e, UINT32 key, UINT32 *pOutput)
 {
 	UINT32 entry, position = (key >> 6) & 0x3FFF;
 
-	while (giflzw_hashTable[position] != 0)
+	while (e->lzw_hashTable[position] != 0)
 	{
-		entry = giflzw_hashTable[position];
+		entry = e->lzw_hashTable[position];
 		if ((entry >> 12) == key)
 		{
 			*pOutput = (entry & 0xFFF);
@@ -285,15 +307,15 @@ static char GIF_searchHash(UINT32 key, UINT32 *pOutput)
 // GIF_addHash
 // stores a hash in the hash table
 //
-static void GIF_addHash(UINT32 key, UINT32 value)
+static void GIF_addHash(gifencoder_t *e, UINT32 key, UINT32 value)
 {
 	UINT32 position = (key >> 6) & 0x3FFF;
 
 	for (;;)
 	{
-		if (giflzw_hashTable[position] == 0)
+		if (e->lzw_hashTable[position] == 0)
 		{
-			giflzw_hashTable[position] = (key << 12) | (value & 0xFFF);
+			e->lzw_hashTable[position] = (key << 12) | (value & 0xFFF);
 			return;
 		}
 
@@ -306,89 +328,89 @@ static void GIF_addHash(UINT32 key, UINT32 value)
 // feeds bytes into the working code,
 // and to the hash table or output from there.
 //
-static void GIF_feedByte(UINT8 pbyte)
+static void GIF_feedByte(gifencoder_t *e, UINT8 pbyte)
 {
 	UINT32 key, hashOutput = 0;
 
 	// Prepare a code with this byte if we have none
-	if (giflzw_workingCode == UINT16_MAX)
+	if (e->lzw_workingCode == UINT16_MAX)
 	{
-		giflzw_workingCode = pbyte;
+		e->lzw_workingCode = pbyte;
 		return;
 	}
 
 	// If we're here, this means we have a code in progress
 	// Is this string already in the dictionary?
-	key = (giflzw_workingCode << 8) | pbyte;
+	key = (e->lzw_workingCode << 8) | pbyte;
 
-	if (0 == GIF_searchHash(key, &hashOutput))
+	if (0 == GIF_searchHash(e, key, &hashOutput))
 	{
 		// It wasn't found.
 		// That means we can output what we already had, and
 		// create a new dictionary entry containing that
 		// plus our new byte.
-		if (giflzw_nextCodeToAssign > (1 << gifbwr_bits_min))
-			++gifbwr_bits_min; // out of room, extend minbits
+		if (e->lzw_nextCodeToAssign > (1 << e->bwr_bits_min))
+			++e->bwr_bits_min; // out of room, extend minbits
 
-		GIF_bwrwrite(giflzw_workingCode);
-		GIF_addHash(key, giflzw_nextCodeToAssign);
-		++giflzw_nextCodeToAssign;
+		GIF_bwrwrite(e, e->lzw_workingCode);
+		GIF_addHash(e, key, e->lzw_nextCodeToAssign);
+		++e->lzw_nextCodeToAssign;
 
 		// Seed the working code with this byte, for the next
 		// round
-		giflzw_workingCode = pbyte;
+		e->lzw_workingCode = pbyte;
 		return;
 	}
 
 	// This string is in there, so update our working code!
-	giflzw_workingCode = hashOutput;
+	e->lzw_workingCode = hashOutput;
 }
 
 //
 // GIF_lzw
 // polls the hashtable, does writing, etc
 //
-static void GIF_lzw(void)
+static void GIF_lzw(gifencoder_t *e)
 {
-	while (scrbuf_pos <= scrbuf_writeend)
+	while (e->scrbuf_pos <= e->scrbuf_writeend)
 	{
-		GIF_feedByte(*scrbuf_pos);
-		if (giflzw_nextCodeToAssign >= GIFLZW_MAXCODE)
+		GIF_feedByte(e, *e->scrbuf_pos);
+		if (e->lzw_nextCodeToAssign >= GIFLZW_MAXCODE)
 		{
-			GIF_bwrwrite(GIFLZW_TABLECLR);
-			GIF_prepareLZW();
+			GIF_bwrwrite(e, GIFLZW_TABLECLR);
+			GIF_prepareLZW(e);
 		}
-		if ((scrbuf_pos += scrbuf_downscaleamt) >= scrbuf_lineend)
+		if ((e->scrbuf_pos += gif_downscaleamt) >= e->scrbuf_lineend)
 		{
-			scrbuf_lineend += (vid.width * scrbuf_downscaleamt);
-			scrbuf_linebegin += (vid.width * scrbuf_downscaleamt);
-			scrbuf_pos = scrbuf_linebegin;
+			e->scrbuf_lineend += (gif_width * gif_downscaleamt);
+			e->scrbuf_linebegin += (gif_width * gif_downscaleamt);
+			e->scrbuf_pos = e->scrbuf_linebegin;
 		}
 		// Just a bit of overflow prevention
-		if (gifbwr_bufsize >= 248)
+		if (e->bwr_bufsize >= 248)
 			break;
 	}
-	if (scrbuf_pos > scrbuf_writeend)
+	if (e->scrbuf_pos > e->scrbuf_writeend)
 	{
 		// 4.15.14 - I failed to account for the possibility that
 		// these two writes could possibly cause minbits increases.
 		// Luckily, we have a guarantee that the first byte CANNOT exceed
 		// the maximum possible code.  So, we do a minbits check here...
-		if (giflzw_nextCodeToAssign++ > (1 << gifbwr_bits_min))
-			++gifbwr_bits_min; // out of room, extend minbits
-		GIF_bwrwrite(giflzw_workingCode);
+		if (e->lzw_nextCodeToAssign++ > (1 << e->bwr_bits_min))
+			++e->bwr_bits_min; // out of room, extend minbits
+		GIF_bwrwrite(e, e->lzw_workingCode);
 
 		// And luckily once more, if the data marker somehow IS at
 		// MAXCODE it doesn't matter, because it still marks the
 		// end of the stream and thus no extending will happen!
 		// But still, we need to check minbits again...
-		if (giflzw_nextCodeToAssign++ > (1 << gifbwr_bits_min))
-			++gifbwr_bits_min; // out of room, extend minbits
-		GIF_bwrwrite(GIFLZW_DATAEND);
+		if (e->lzw_nextCodeToAssign++ > (1 << e->bwr_bits_min))
+			++e->bwr_bits_min; // out of room, extend minbits
+		GIF_bwrwrite(e, GIFLZW_DATAEND);
 
 		// Okay, the flush is safe at least.
-		GIF_bwrflush();
-		gif_writeover = 1;
+		GIF_bwrflush(e);
+		e->writeover = 1;
 	}
 }
 
@@ -422,7 +444,7 @@ static RGBA_t *GIF_getpalette(size_t palnum)
 // writes the gif palette.
 // used both for the header and local color tables.
 //
-static UINT8 *GIF_palwrite(UINT8 *p, RGBA_t *pal)
+static UINT8 *GIF_palwrite(UINT8 *p, const RGBA_t *pal)
 {
 	INT32 i;
 	for (i = 0; i < 256; i++)
@@ -450,18 +472,8 @@ static void GIF_headwrite(void)
 	WRITEMEM(p, gifhead_base, sizeof(gifhead_base));
 
 	// Image width/height
-	if (gif_downscale)
-	{
-		scrbuf_downscaleamt = vid.dupx;
-		rwidth = (vid.width / scrbuf_downscaleamt);
-		rheight = (vid.height / scrbuf_downscaleamt);
-	}
-	else
-	{
-		scrbuf_downscaleamt = 1;
-		rwidth = vid.width;
-		rheight = vid.height;
-	}
+	rwidth = (gif_width / gif_downscaleamt);
+	rheight = (gif_height / gif_downscaleamt);
 
 	WRITEUINT16(p, rwidth);
 	WRITEUINT16(p, rheight);
@@ -484,235 +496,451 @@ static void GIF_headwrite(void)
 
 
 
-// GIF FRAME (surprise!)
+// GIF JOBs
 // ---
-const UINT8 gifframe_gchead[4] = {0x21,0xF9,0x04,0x04}; // GCE, bytes, packed byte (no trans = 0 | no input = 0 | don't remove = 4)
+// Frames are diffed, converted and compressed on the media thread pool, several
+// at once, then written to the file in order from the game thread. If the
+// pool falls behind, frames are dropped instead of stalling the game.
+#define GIF_MAXJOBS 4
 
-static UINT8 *gifframe_data = NULL;
-static size_t gifframe_size = 8192;
+typedef enum
+{
+	GIFJOB_FREE,
+	GIFJOB_BUSY, // being encoded
+	GIFJOB_DONE, // waiting to be written
+} gifjobstate_t;
 
-//
-// GIF_rgbconvert
-// converts an RGB frame to a frame with a palette.
-//
-#ifdef HWRENDER
+typedef struct
+{
+	gifjobstate_t state;
+
+	UINT8 *rgb; // this frame
+	const UINT8 *prevrgb; // last frame queued, NULL to write the whole frame
+	UINT8 *screen; // palette indices, only filled inside the changed region
+
+	UINT16 delay;
+	boolean palchanged;
+	RGBA_t palette[256]; // local color table, if palchanged
+
+	UINT8 *data; // the encoded frame
+	size_t size, length;
+
+	gifencoder_t encoder;
+} gifjob_t;
+
+static gifjob_t *gif_jobs[GIF_MAXJOBS];
+static INT32 gif_nextjob = 0; // next to be queued
+static INT32 gif_writejob = 0; // next to be written
+static INT32 gif_lastjob = -1; // last queued, the next frame is diffed against it
+
+#ifdef HAVE_THREADS
+static I_mutex gif_mutex; // guards gifjob_t::state
+static I_cond gif_cond;
+#endif
+
+// Jobs only read the lookup table, so it's only rebuilt with none in flight.
 static colorlookup_t gif_colorlookup;
 
-static void GIF_rgbconvert(const UINT8 *linear, UINT8 *scr)
+static gifjobstate_t GIF_jobstate(const gifjob_t *job)
 {
-	UINT8 r, g, b;
-	size_t src = 0, dest = 0;
-	size_t size = (vid.width * vid.height * 3);
+	gifjobstate_t state;
 
-	InitColorLUT(&gif_colorlookup, (gif_localcolortable) ? gif_framepalette : gif_headerpalette, true);
+#ifdef HAVE_THREADS
+	I_lock_mutex(&gif_mutex);
+#endif
+	state = job->state;
+#ifdef HAVE_THREADS
+	I_unlock_mutex(gif_mutex);
+#endif
+
+	return state;
+}
 
-	while (src < size)
+static void GIF_setjobstate(gifjob_t *job, gifjobstate_t state)
+{
+#ifdef HAVE_THREADS
+	I_lock_mutex(&gif_mutex);
+#endif
+	job->state = state;
+#ifdef HAVE_THREADS
+	I_wake_all_cond(&gif_cond);
+	I_unlock_mutex(gif_mutex);
+#endif
+}
+
+//
+// GIF_rgbconvert
+// converts the region of an RGB frame that will be written to palette indices.
+//
+static void GIF_rgbconvert(gifjob_t *job, INT32 blitx, INT32 blity, INT32 blitw, INT32 blith)
+{
+	INT32 x, y;
+
+	for (y = blity; y < blity + blith; y += gif_downscaleamt)
 	{
-		r = (UINT8)linear[src];
-		g = (UINT8)linear[src + 1];
-		b = (UINT8)linear[src + 2];
-		scr[dest] = GetColorLUTDirect(&gif_colorlookup, r, g, b);
-		src += (3 * scrbuf_downscaleamt);
-		dest += scrbuf_downscaleamt;
+		const UINT8 *src = job->rgb + ((y * gif_width) * 3);
+		UINT8 *dest = job->screen + (y * gif_width);
+
+		for (x = blitx; x < blitx + blitw; x += gif_downscaleamt)
+			dest[x] = GetColorLUTDirect(&gif_colorlookup, src[x * 3], src[x * 3 + 1], src[x * 3 + 2]);
 	}
 }
-#endif
 
 //
-// GIF_framewrite
-// writes a frame into the file.
+// GIF_reserve
+// makes room for at least n more bytes of encoded frame.
 //
-static void GIF_framewrite(INT32 input_width, INT32 input_height, const UINT8 *input)
+static UINT8 *GIF_reserve(gifjob_t *job, UINT8 *p, size_t n)
 {
-	UINT8 *p;
-	UINT8 *movie_screen = screens[2];
+	const size_t pos = p - job->data;
+	UINT8 *data;
+
+	if (pos + n < job->size)
+		return p;
+
+	// realloc moves data, so p is now invalid
+	data = realloc(job->data, job->size * 2);
+	if (data == NULL)
+		return NULL;
+
+	job->data = data;
+	job->size *= 2;
+	return job->data + pos;
+}
+
+const UINT8 gifframe_gchead[4] = {0x21,0xF9,0x04,0x04}; // GCE, bytes, packed byte (no trans = 0 | no input = 0 | don't remove = 4)
+
+//
+// GIF_encodejob
+// diffs, converts and compresses one frame. Runs on the media thread pool.
+//
+static void GIF_encodejob(void *userdata)
+{
+	gifjob_t *job = userdata;
+	gifencoder_t *e = &job->encoder;
+	UINT8 *p = job->data;
 	INT32 blitx, blity, blitw, blith;
-	boolean palchanged;
+	INT32 startline;
+
+	// Compare image data (for optimizing GIF)
+	if (job->prevrgb)
+		GIF_optimizeregion(job->rgb, job->prevrgb, &blitx, &blity, &blitw, &blith);
+	else
+	{
+		blitx = blity = 0;
+		blitw = gif_width;
+		blith = gif_height;
+	}
 
-	(void)input_width;
-	(void)input_height;
+	if (gif_downscaleamt > 1)
+	{
+		// Ensure our downscaled blitx/y starts and ends on a pixel.
+		blitx -= (blitx % gif_downscaleamt);
+		blity -= (blity % gif_downscaleamt);
+		blitw = ((blitw + (gif_downscaleamt - 1)) / gif_downscaleamt) * gif_downscaleamt;
+		blith = ((blith + (gif_downscaleamt - 1)) / gif_downscaleamt) * gif_downscaleamt;
+	}
 
-	I_Assert(input_width == vid.width && input_height == vid.height);
+	GIF_rgbconvert(job, blitx, blity, blitw, blith);
 
-	if (!gifframe_data)
-		gifframe_data = Z_Malloc(gifframe_size, PU_STATIC, NULL);
-	p = gifframe_data;
+	// screen regions are handled in GIF_lzw
+	WRITEMEM(p, gifframe_gchead, 4);
 
-	if (!gif_out)
-		return;
+	WRITEUINT16(p, job->delay);
+	WRITEUINT8(p, 0);
+	WRITEUINT8(p, 0); // end of GCE
 
-	// Lactozilla: Compare the header's palette with the current frame's palette and see if it changed.
-	if (gif_localcolortable)
+	WRITEUINT8(p, 0x2C);
+	WRITEUINT16(p, (UINT16)(blitx / gif_downscaleamt));
+	WRITEUINT16(p, (UINT16)(blity / gif_downscaleamt));
+	WRITEUINT16(p, (UINT16)(blitw / gif_downscaleamt));
+	WRITEUINT16(p, (UINT16)(blith / gif_downscaleamt));
+
+	if (job->palchanged)
 	{
-		gif_framepalette = GIF_getpalette(max(st_palette, 0));
-		palchanged = memcmp(gif_headerpalette, gif_framepalette, sizeof(RGBA_t) * 256);
+		// The palettes are different, so write the Local Color Table!
+		WRITEUINT8(p, 0x87); // (0x87 = 1000 0111)
+		p = GIF_palwrite(p, job->palette);
 	}
 	else
-		palchanged = false;
+		WRITEUINT8(p, 0); // no local table of colors, or they are equal
 
-	// Compare image data (for optimizing GIF)
-	// If the palette has changed, the entire frame is considered to be different.
-	if (gif_optimize && gif_frames > 0 && (!palchanged))
+	e->scrbuf_pos = job->screen + blitx + (blity * gif_width);
+	e->scrbuf_writeend = e->scrbuf_pos + (blitw - 1) + ((blith - 1) * gif_width);
+
+	e->bwr_cur = e->bwr_buf;
+	e->bwr_bufsize = 0;
+	e->bwr_bits_buf = e->bwr_bits_num = 0;
+
+	GIF_prepareLZW(e);
+	e->lzw_workingCode = UINT16_MAX;
+	WRITEUINT8(p, e->bwr_bits_min - 1);
+
+	startline = (e->scrbuf_pos - job->screen) / gif_width;
+	e->scrbuf_linebegin = job->screen + (startline * gif_width) + blitx;
+	e->scrbuf_lineend = e->scrbuf_linebegin + blitw;
+
+	//prewrite a table clear
+	GIF_bwrwrite(e, GIFLZW_TABLECLR);
+
+	e->writeover = 0;
+	while (!e->writeover)
 	{
-		// before blit movie_screen points to last frame, cur_screen points to this frame
-		UINT8 *cur_screen = screens[0];
-		GIF_optimizeregion(cur_screen, movie_screen, &blitx, &blity, &blitw, &blith);
+		GIF_lzw(e); // main lzw packing loop
 
-		// blit to temp screen
-		if (rendermode == render_soft)
-		{
-			I_Assert(input != NULL);
-			GIF_rgbconvert(input, movie_screen);
-		}
-#ifdef HWRENDER
-		else if (rendermode == render_opengl)
-		{
-			UINT8 *linear = HWR_GetScreenshot();
-			GIF_rgbconvert(linear, movie_screen);
-			free(linear);
-		}
-#endif
+		p = GIF_reserve(job, p, e->bwr_bufsize + 2);
+		if (p == NULL)
+			break;
+
+		// reset after writing to read
+		e->bwr_cur = e->bwr_buf;
+		WRITEUINT8(p, e->bwr_bufsize);
+		WRITEMEM(p, e->bwr_cur, e->bwr_bufsize);
+
+		e->bwr_bufsize = 0;
+		e->bwr_cur = e->bwr_buf;
 	}
+
+	if (p == NULL)
+		job->length = 0; // out of memory, lose the frame rather than corrupt the file
 	else
 	{
-		blitx = blity = 0;
-		blitw = vid.width;
-		blith = vid.height;
+		WRITEUINT8(p, 0); //terminator
+		job->length = p - job->data;
+	}
 
-#ifdef HWRENDER
-		// Copy the current OpenGL frame into the base screen
-		if (rendermode == render_opengl)
+	GIF_setjobstate(job, GIFJOB_DONE);
+}
+
+//
+// GIF_writejobs
+// writes out finished frames, in order.
+// if wait is set, waits for every frame in flight.
+//
+static void GIF_writejobs(boolean wait)
+{
+	for (;;)
+	{
+		gifjob_t *job = gif_jobs[gif_writejob];
+		gifjobstate_t state;
+
+#ifdef HAVE_THREADS
+		if (wait && GIF_jobstate(job) == GIFJOB_BUSY)
 		{
-			UINT8 *linear = HWR_GetScreenshot();
-			GIF_rgbconvert(linear, screens[0]);
-			free(linear);
+			I_lock_mutex(&gif_mutex);
+			while (job->state == GIFJOB_BUSY)
+				I_hold_cond(&gif_cond, gif_mutex);
+			I_unlock_mutex(gif_mutex);
 		}
 #endif
 
-		// Copy the first frame into the movie screen
-		// OpenGL already does the same above.
-		if (gif_frames == 0 && rendermode == render_soft)
-		{
-			I_Assert(input != NULL);
-			GIF_rgbconvert(input, screens[0]);
-		}
+		state = GIF_jobstate(job);
+		if (state != GIFJOB_DONE)
+			return;
 
-		movie_screen = screens[0];
+		if (gif_out && job->length)
+			fwrite(job->data, 1, job->length, gif_out);
+
+		GIF_setjobstate(job, GIFJOB_FREE);
+		gif_writejob = (gif_writejob + 1) % GIF_MAXJOBS;
 	}
+}
 
-	// screen regions are handled in GIF_lzw
+static void GIF_freejobs(void)
+{
+	INT32 i;
+
+	for (i = 0; i < GIF_MAXJOBS; i++)
 	{
-		UINT16 delay = 0;
-		INT32 startline;
+		if (gif_jobs[i] == NULL)
+			continue;
+
+		free(gif_jobs[i]->rgb);
+		free(gif_jobs[i]->screen);
+		free(gif_jobs[i]->data);
+		free(gif_jobs[i]);
+		gif_jobs[i] = NULL;
+	}
+}
 
-		if (gif_dynamicdelay ==(UINT8) 2)
-		{
-			// golden's attempt at creating a "dynamic delay"
-			UINT16 mingifdelay = 10; // minimum gif delay in milliseconds (keep at 10 because gifs can't get more precise).
-			gif_delayus += (I_GetPreciseTime() - gif_prevframetime) / (I_GetPrecisePrecision() / 1000000); // increase delay by how much time was spent between last measurement
-
-			if (gif_delayus/1000 >= mingifdelay) // delay is big enough to be able to effect gif frame delay?
-			{
-				int frames = (gif_delayus/1000) / mingifdelay; // get amount of frames to delay.
-				delay = frames; // set the delay to delay that amount of frames.
-				gif_delayus -= frames*(mingifdelay*1000); // remove frames by the amount of milliseconds they take. don't reset to 0, the microseconds help consistency.
-			}
-		}
-		else if (gif_dynamicdelay ==(UINT8) 1)
-		{
-			float delayf = ceil(100.0f/NEWTICRATE);
+static boolean GIF_allocjobs(void)
+{
+	const size_t pixels = (size_t)gif_width * gif_height;
+	INT32 i;
 
-			delay = (UINT16)((I_GetPreciseTime() - gif_prevframetime)) / (I_GetPrecisePrecision() / 1000000) /10/1000;
+	for (i = 0; i < GIF_MAXJOBS; i++)
+	{
+		gifjob_t *job = calloc(1, sizeof *job);
 
-			if (delay < (UINT16)(delayf))
-				delay = (UINT16)(delayf);
-		}
-		else
-		{
-			// the original code
-			int d1 = (int)((100.0f/NEWTICRATE)*(gif_frames+1));
-			int d2 = (int)((100.0f/NEWTICRATE)*(gif_frames));
-			delay = d1-d2;
-		}
+		gif_jobs[i] = job;
+		if (job == NULL)
+			break;
 
-		WRITEMEM(p, gifframe_gchead, 4);
+		job->state = GIFJOB_FREE;
+		job->size = 8192;
+		job->rgb = malloc(pixels * 3);
+		job->screen = malloc(pixels);
+		job->data = malloc(job->size);
 
-		WRITEUINT16(p, delay);
-		WRITEUINT8(p, 0);
-		WRITEUINT8(p, 0); // end of GCE
+		if (!job->rgb || !job->screen || !job->data)
+			break;
+	}
 
-		if (scrbuf_downscaleamt > 1)
-		{
-			// Ensure our downscaled blitx/y starts and ends on a pixel.
-			blitx -= (blitx % scrbuf_downscaleamt);
-			blity -= (blity % scrbuf_downscaleamt);
-			blitw = ((blitw + (scrbuf_downscaleamt - 1)) / scrbuf_downscaleamt) * scrbuf_downscaleamt;
-			blith = ((blith + (scrbuf_downscaleamt - 1)) / scrbuf_downscaleamt) * scrbuf_downscaleamt;
-		}
+	if (i < GIF_MAXJOBS)
+	{
+		GIF_freejobs();
+		return false;
+	}
+
+	gif_nextjob = gif_writejob = 0;
+	gif_lastjob = -1;
+	return true;
+}
 
-		WRITEUINT8(p, 0x2C);
-		WRITEUINT16(p, (UINT16)(blitx / scrbuf_downscaleamt));
-		WRITEUINT16(p, (UINT16)(blity / scrbuf_downscaleamt));
-		WRITEUINT16(p, (UINT16)(blitw / scrbuf_downscaleamt));
-		WRITEUINT16(p, (UINT16)(blith / scrbuf_downscaleamt));
 
-		if (!gif_localcolortable)
-			WRITEUINT8(p, 0); // no local table of colors
-		else
+
+// GIF FRAME (surprise!)
+// ---
+
+//
+// GIF_framedelay
+// how long the previous frame stays up, in hundredths of a second.
+//
+static UINT16 GIF_framedelay(void)
+{
+	UINT16 delay = 0;
+
+	if (gif_dynamicdelay ==(UINT8) 2)
+	{
+		// golden's attempt at creating a "dynamic delay"
+		UINT16 mingifdelay = 10; // minimum gif delay in milliseconds (keep at 10 because gifs can't get more precise).
+		gif_delayus += (I_GetPreciseTime() - gif_prevframetime) / (I_GetPrecisePrecision() / 1000000); // increase delay by how much time was spent between last measurement
+
+		if (gif_delayus/1000 >= mingifdelay) // delay is big enough to be able to effect gif frame delay?
 		{
-			if (palchanged)
-			{
-				// The palettes are different, so write the Local Color Table!
-				WRITEUINT8(p, 0x87); // (0x87 = 1000 0111)
-				p = GIF_palwrite(p, gif_framepalette);
-			}
-			else
-				WRITEUINT8(p, 0); // They are equal, no Local Color Table needed.
+			int frames = (gif_delayus/1000) / mingifdelay; // get amount of frames to delay.
+			delay = frames; // set the delay to delay that amount of frames.
+			gif_delayus -= frames*(mingifdelay*1000); // remove frames by the amount of milliseconds they take. don't reset to 0, the microseconds help consistency.
 		}
+	}
+	else if (gif_dynamicdelay ==(UINT8) 1)
+	{
+		float delayf = ceil(100.0f/NEWTICRATE);
+
+		delay = (UINT16)((I_GetPreciseTime() - gif_prevframetime)) / (I_GetPrecisePrecision() / 1000000) /10/1000;
+
+		if (delay < (UINT16)(delayf))
+			delay = (UINT16)(delayf);
+	}
+	else
+	{
+		// the original code
+		INT32 frames = gif_frames + gif_dropped;
+		int d1 = (int)((100.0f/NEWTICRATE)*(frames+1));
+		int d2 = (int)((100.0f/NEWTICRATE)*(frames));
+		delay = d1-d2;
+	}
+
+	gif_prevframetime = I_GetPreciseTime();
+	return delay;
+}
+
+//
+// GIF_framewrite
+// queues a frame to be written into the file.
+//
+static void GIF_framewrite(INT32 input_width, INT32 input_height, const UINT8 *input)
+{
+	gifjob_t *job;
+	RGBA_t *palette;
+	boolean palchanged;
+	UINT16 delay;
+
+	if (!gif_out)
+		return;
 
-		scrbuf_pos = movie_screen + blitx + (blity * vid.width);
-		scrbuf_writeend = scrbuf_pos + (blitw - 1) + ((blith - 1) * vid.width);
+	GIF_writejobs(false);
 
-		if (!gifbwr_buf)
-			gifbwr_buf = Z_Malloc(256, PU_STATIC, NULL);
-		gifbwr_cur = gifbwr_buf;
+	delay = GIF_framedelay();
 
-		GIF_prepareLZW();
-		giflzw_workingCode = UINT16_MAX;
-		WRITEUINT8(p, gifbwr_bits_min - 1);
+	job = gif_jobs[gif_nextjob];
 
-		startline = (scrbuf_pos - movie_screen) / vid.width;
-		scrbuf_linebegin = movie_screen + (startline * vid.width) + blitx;
-		scrbuf_lineend = scrbuf_linebegin + blitw;
+	// The job after this one is diffed against this one's frame,
+	// so its frame can't be replaced until that's done too.
+	if (input_width != gif_width || input_height != gif_height
+		|| GIF_jobstate(job) != GIFJOB_FREE
+		|| GIF_jobstate(gif_jobs[(gif_nextjob + 1) % GIF_MAXJOBS]) == GIFJOB_BUSY)
+	{
+		// Saturate rather than wrap over a long run of dropped frames
+		gif_delaycarry = (UINT16)min((UINT32)gif_delaycarry + delay, UINT16_MAX);
+		++gif_dropped;
+		return;
+	}
+
+	// Lactozilla: Compare the header's palette with the current frame's palette and see if it changed.
+	if (gif_localcolortable)
+	{
+		gif_framepalette = GIF_getpalette(max(st_palette, 0));
+		palchanged = memcmp(gif_headerpalette, gif_framepalette, sizeof(RGBA_t) * 256);
+	}
+	else
+		palchanged = false;
 
-		//prewrite a table clear
-		GIF_bwrwrite(GIFLZW_TABLECLR);
+	// Rebuilding the lookup table is slow, but it only happens when the palette flashes.
+	palette = (gif_localcolortable) ? gif_framepalette : gif_headerpalette;
+	if (!gif_colorlookup.init || memcmp(gif_colorlookup.palette, palette, sizeof(RGBA_t) * 256))
+	{
+		GIF_writejobs(true);
+		InitColorLUT(&gif_colorlookup, palette, true);
+	}
 
-		gif_writeover = 0;
-		while (!gif_writeover)
+	if (input == NULL)
+	{
+#ifdef HWRENDER
+		// Legacy OpenGL has to be read back here
+		if (rendermode == render_opengl)
 		{
-			GIF_lzw(); // main lzw packing loop
-
-			if ((size_t)(p - gifframe_data) + gifbwr_bufsize + 1 >= gifframe_size)
-			{
-				INT32 temppos = p - gifframe_data;
-				gifframe_data = Z_Realloc(gifframe_data, (gifframe_size *= 2), PU_STATIC, NULL);
-				p = gifframe_data + temppos; // realloc moves gifframe_data, so p is now invalid
-			}
-
-			// reset after writing to read
-			gifbwr_cur = gifbwr_buf;
-			WRITEUINT8(p, gifbwr_bufsize);
-			WRITEMEM(p, gifbwr_cur, gifbwr_bufsize);
-
-			gifbwr_bufsize = 0;
-			gifbwr_cur = gifbwr_buf;
+			UINT8 *linear = HWR_GetScreenshot();
+			if (linear == NULL)
+				return;
+			memcpy(job->rgb, linear, (size_t)gif_width * gif_height * 3);
+			free(linear);
+		}
+		else
+#endif
+		{
+			I_Assert(input != NULL); // software always passes its frame
+			return;
 		}
-		WRITEUINT8(p, 0); //terminator
 	}
-	fwrite(gifframe_data, 1, (p - gifframe_data), gif_out);
+	else
+		memcpy(job->rgb, input, (size_t)gif_width * gif_height * 3);
+
+	// If the palette has changed, the entire frame is considered to be different.
+	if (gif_optimize && gif_lastjob >= 0 && !palchanged)
+		job->prevrgb = gif_jobs[gif_lastjob]->rgb;
+	else
+		job->prevrgb = NULL;
+
+	job->delay = (UINT16)min((UINT32)delay + gif_delaycarry, UINT16_MAX);
+	gif_delaycarry = 0;
+
+	job->palchanged = palchanged;
+	if (palchanged)
+		memcpy(job->palette, gif_framepalette, sizeof(RGBA_t) * 256);
+
+	GIF_setjobstate(job, GIFJOB_BUSY);
+
+	gif_lastjob = gif_nextjob;
+	gif_nextjob = (gif_nextjob + 1) % GIF_MAXJOBS;
 	++gif_frames;
-	gif_prevframetime = I_GetPreciseTime();
+
+#ifdef HAVE_THREADS
+	I_MediaThreadPoolSubmit(GIF_encodejob, job);
+#else
+	GIF_encodejob(job);
+	GIF_writejobs(false);
+#endif
 }
 
 
@@ -727,10 +955,6 @@ static void GIF_framewrite(INT32 input_width, INT32 input_height, const UINT8 *i
 //
 INT32 GIF_open(const char *filename)
 {
-	gif_out = fopen(filename, "wb");
-	if (!gif_out)
-		return 0;
-
 	gif_optimize = (!!cv_gif_optimize.value);
 	gif_downscale = (!!cv_gif_downscale.value);
 	gif_dynamicdelay = (UINT8)cv_gif_dynamicdelay.value;
@@ -738,10 +962,26 @@ INT32 GIF_open(const char *filename)
 	gif_colorprofile = (!!cv_screenshot_colorprofile.value);
 	gif_headerpalette = GIF_getpalette(0);
 
+	gif_width = vid.width;
+	gif_height = vid.height;
+	gif_downscaleamt = (gif_downscale) ? vid.dupx : 1;
+
+	if (!GIF_allocjobs())
+		return 0;
+
+	gif_out = fopen(filename, "wb");
+	if (!gif_out)
+	{
+		GIF_freejobs();
+		return 0;
+	}
+
 	GIF_headwrite();
 	gif_frames = 0;
+	gif_dropped = 0;
 	gif_prevframetime = I_GetPreciseTime();
 	gif_delayus = 0;
+	gif_delaycarry = 0;
 	return 1;
 }
 
@@ -773,24 +1013,17 @@ INT32 GIF_close(void)
 	if (!gif_out)
 		return 0;
 
+	GIF_writejobs(true);
+	GIF_freejobs();
+
 	// final terminator.
 	fwrite(";", 1, 1, gif_out);
 	fclose(gif_out);
 	gif_out = NULL;
 
-	if (gifbwr_buf)
-		Z_Free(gifbwr_buf);
-	gifbwr_buf = gifbwr_cur = NULL;
-
-	if (gifframe_data)
-		Z_Free(gifframe_data);
-	gifframe_data = NULL;
-
-	if (giflzw_hashTable)
-		Z_Free(giflzw_hashTable);
-	giflzw_hashTable = NULL;
-
 	CONS_Printf(M_GetText("Animated gif closed; wrote %d frames\n"), gif_frames);
+	if (gif_dropped)
+		CONS_Printf(M_GetText("%d frames were dropped to keep up\n"), gif_dropped);
 	return 1;
 }
 #endif //ifdef HAVE_ANIGIF
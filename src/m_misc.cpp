@@ -46,6 +46,10 @@
 #include "m_argv.h"
 #include "i_system.h"
 #include "command.h" // cv_execversion
+#ifdef HAVE_THREADS
+#include "i_threads.h"
+#include "core/thread_pool.h"
+#endif
 
 #include "m_anigif.h"
 #ifdef SRB2_CONFIG_ENABLE_WEBM_MOVIES
@@ -150,6 +154,9 @@ CV_PossibleValue_t zlib_window_bits_t[] = {
 
 #ifdef USE_APNG
 static boolean apng_downscale = false; // So nobody can do something dumb like changing cvars mid output
+static INT32 apng_width = 0, apng_height = 0; // and the rest are read while writing frames
+static png_uint_16 apng_downscaleamt = 1;
+static png_uint_16 apng_delay = 0;
 #endif
 
 boolean takescreenshot = false; // Take a screenshot this tic
@@ -850,6 +857,13 @@ FUNCNORETURN static void PNG_error(png_structp PNG, png_const_charp pngtext)
 	I_Error("libpng error at %p: %s", (void*)PNG, pngtext);
 }
 
+// For writes that set up png_jmpbuf and may be on another thread
+FUNCNORETURN static void PNG_longjmp_error(png_structp PNG, png_const_charp pngtext)
+{
+	CONS_Debug(DBG_RENDER, "libpng error at %p: %s\n", (void*)PNG, pngtext);
+	png_longjmp(PNG, 1);
+}
+
 static void PNG_warn(png_structp PNG, png_const_charp pngtext)
 {
 	CONS_Debug(DBG_RENDER, "libpng warning at %p: %s", (void*)PNG, pngtext);
@@ -889,70 +903,81 @@ static void M_PNGhdr(png_structp png_ptr, png_infop png_info_ptr, PNG_CONST png_
 	}
 }
 
-static void M_PNGText(png_structp png_ptr, png_infop png_info_ptr, PNG_CONST png_byte movie)
+// Game state for the PNG text chunks, gathered up front so the file can
+// be written on another thread.
+struct pnginfotext_t
 {
-#ifdef PNG_TEXT_SUPPORTED
-#define SRB2PNGTXT 11 //PNG_KEYWORD_MAX_LENGTH(79) is the max
-	png_text png_infotext[SRB2PNGTXT];
-	char keytxt[SRB2PNGTXT][12] = {
-	"Title", "Description", "Playername", "Mapnum", "Mapname",
-	"Location", "Interface", "Render Mode", "Revision", "Build Date", "Build Time"};
-	char titletxt[] = "Dr. Robotnik's Ring Racers " VERSIONSTRING;
-	png_charp playertxt =  cv_playername[0].zstring;
-	char desctxt[] = "Ring Racers Screenshot";
-	char Movietxt[] = "Ring Racers Movie";
-	size_t i;
-	char interfacetxt[] =
-#ifdef HAVE_SDL
-	 "SDL";
-#else
-	 "Unknown";
-#endif
-	char rendermodetxt[9];
-	char maptext[8];
-	char lvlttltext[48];
-	char locationtxt[40];
-	char ctrevision[40];
-	char ctdate[40];
-	char cttime[40];
+	char playername[MAXPLAYERNAME+1];
+	char rendermode[9];
+	char map[8];
+	char lvlttl[48];
+	char location[40];
+};
+
+static void M_PNGGetText(pnginfotext_t *info)
+{
+	strlcpy(info->playername, cv_playername[0].zstring, sizeof info->playername);
 
 	switch (rendermode)
 	{
 		case render_soft:
-			strcpy(rendermodetxt, "Software");
+			strcpy(info->rendermode, "Software");
 			break;
 		case render_opengl:
-			strcpy(rendermodetxt, "OpenGL");
+			strcpy(info->rendermode, "OpenGL");
 			break;
 		default: // Just in case
-			strcpy(rendermodetxt, "None");
+			strcpy(info->rendermode, "None");
 			break;
 	}
 
 #if 0
 	if (gamestate == GS_LEVEL)
-		snprintf(maptext, 8, "%s", G_BuildMapName(gamemap));
+		snprintf(info->map, 8, "%s", G_BuildMapName(gamemap));
 	else
 #endif
-		snprintf(maptext, 8, "Unknown");
+		snprintf(info->map, 8, "Unknown");
 
 	if (gamestate == GS_LEVEL && mapheaderinfo[gamemap-1]->lvlttl[0] != '\0')
-		snprintf(lvlttltext, 48, "%s%s%s",
+		snprintf(info->lvlttl, 48, "%s%s%s",
 			mapheaderinfo[gamemap-1]->lvlttl,
 			(mapheaderinfo[gamemap-1]->levelflags & LF_NOZONE) ? "" :
 			(mapheaderinfo[gamemap-1]->zonttl[0] != '\0') ? va(" %s",mapheaderinfo[gamemap-1]->zonttl) : " Zone",
 			(mapheaderinfo[gamemap-1]->actnum > 0) ? va(" %d",mapheaderinfo[gamemap-1]->actnum) : "");
 	else
-		snprintf(lvlttltext, 48, "Unknown");
+		snprintf(info->lvlttl, 48, "Unknown");
 
 	if (gamestate == GS_LEVEL && players[g_localplayers[0]].mo)
-		snprintf(locationtxt, 40, "X:%d Y:%d Z:%d A:%d",
+		snprintf(info->location, 40, "X:%d Y:%d Z:%d A:%d",
 			players[g_localplayers[0]].mo->x>>FRACBITS,
 			players[g_localplayers[0]].mo->y>>FRACBITS,
 			players[g_localplayers[0]].mo->z>>FRACBITS,
 			FixedInt(AngleFixed(players[g_localplayers[0]].mo->angle)));
 	else
-		snprintf(locationtxt, 40, "Unknown");
+		snprintf(info->location, 40, "Unknown");
+}
+
+static void M_PNGText(png_structp png_ptr, png_infop png_info_ptr, pnginfotext_t *info, PNG_CONST png_byte movie)
+{
+#ifdef PNG_TEXT_SUPPORTED
+#define SRB2PNGTXT 11 //PNG_KEYWORD_MAX_LENGTH(79) is the max
+	png_text png_infotext[SRB2PNGTXT];
+	char keytxt[SRB2PNGTXT][12] = {
+	"Title", "Description", "Playername", "Mapnum", "Mapname",
+	"Location", "Interface", "Render Mode", "Revision", "Build Date", "Build Time"};
+	char titletxt[] = "Dr. Robotnik's Ring Racers " VERSIONSTRING;
+	char desctxt[] = "Ring Racers Screenshot";
+	char Movietxt[] = "Ring Racers Movie";
+	size_t i;
+	char interfacetxt[] =
+#ifdef HAVE_SDL
+	 "SDL";
+#else
+	 "Unknown";
+#endif
+	char ctrevision[40];
+	char ctdate[40];
+	char cttime[40];
 
 	memset(png_infotext,0x00,sizeof (png_infotext));
 
@@ -964,18 +989,23 @@ static void M_PNGText(png_structp png_ptr, png_infop png_info_ptr, PNG_CONST png
 		png_infotext[1].text = Movietxt;
 	else
 		png_infotext[1].text = desctxt;
-	png_infotext[2].text = playertxt;
-	png_infotext[3].text = maptext;
-	png_infotext[4].text = lvlttltext;
-	png_infotext[5].text = locationtxt;
+	png_infotext[2].text = info->playername;
+	png_infotext[3].text = info->map;
+	png_infotext[4].text = info->lvlttl;
+	png_infotext[5].text = info->location;
 	png_infotext[6].text = interfacetxt;
-	png_infotext[7].text = rendermodetxt;
+	png_infotext[7].text = info->rendermode;
 	png_infotext[8].text = strncpy(ctrevision, comprevision, sizeof(ctrevision)-1);
 	png_infotext[9].text = strncpy(ctdate, compdate, sizeof(ctdate)-1);
 	png_infotext[10].text = strncpy(cttime, comptime, sizeof(cttime)-1);
 
 	png_set_text(png_ptr, png_info_ptr, png_infotext, SRB2PNGTXT);
 #undef SRB2PNGTXT
+#else
+	(void)png_ptr;
+	(void)png_info_ptr;
+	(void)info;
+	(void)movie;
 #endif
 }
 
@@ -998,7 +1028,7 @@ static png_structp apng_ptr = NULL;
 static png_infop   apng_info_ptr = NULL;
 static apng_infop  apng_ainfo_ptr = NULL;
 static png_FILE_p  apng_FILE = NULL;
-static png_uint_32 apng_frames = 0;
+static png_uint_32 apng_frames = 0; // written so far, guarded by apng_mutex
 #ifdef PNG_STATIC // Win32 build have static libpng
 #define aPNG_set_acTL png_set_acTL
 #define aPNG_write_frame_head png_write_frame_head
@@ -1096,16 +1126,14 @@ static inline boolean M_PNGLib(void)
 
 static void M_PNGFrame(png_structp png_ptr, png_infop png_info_ptr, png_bytep png_buf)
 {
-	png_uint_16 downscale = apng_downscale ? vid.dupx : 1;
+	png_uint_16 downscale = apng_downscaleamt;
 
 	png_uint_32 pitch = png_get_rowbytes(png_ptr, png_info_ptr);
-	PNG_CONST png_uint_32 width = vid.width / downscale;
-	PNG_CONST png_uint_32 height = vid.height / downscale;
+	PNG_CONST png_uint_32 width = apng_width / downscale;
+	PNG_CONST png_uint_32 height = apng_height / downscale;
 	png_bytepp row_pointers = (png_bytepp) png_malloc(png_ptr, height * sizeof (png_bytep));
 	png_uint_32 x, y;
-	png_uint_16 framedelay = (png_uint_16)cv_apng_delay.value;
-
-	apng_frames++;
+	png_uint_16 framedelay = apng_delay;
 
 	for (y = 0; y < height; y++)
 	{
@@ -1143,9 +1171,182 @@ static void M_PNGFrame(png_structp png_ptr, png_infop png_info_ptr, png_bytep pn
 #endif
 		aPNG_write_frame_tail(apng_ptr, apng_info_ptr);
 
+	for (y = 0; y < height; y++)
+		free(row_pointers[y]);
 	png_free(png_ptr, (png_voidp)row_pointers);
 }
 
+// aPNG frames are compressed and written on the media thread pool, one at a time
+// and in order, since they all go into the same stream. If it falls behind,
+// frames are dropped instead of stalling the game.
+#define APNG_MAXFRAMES 4
+
+struct apngframe_t
+{
+	UINT8 *pixels; // kept between frames
+	size_t size;
+};
+
+static apngframe_t apng_queue[APNG_MAXFRAMES];
+static INT32 apng_queuehead = 0;
+static INT32 apng_queuecount = 0;
+static boolean apng_writing = false; // a job is draining the queue
+static boolean apng_failed = false;
+static UINT32 apng_dropped = 0;
+
+#ifdef HAVE_THREADS
+static I_mutex apng_mutex; // guards everything above except the pixels
+static I_cond apng_cond;
+#endif
+
+static inline void M_LockAPNG(void)
+{
+#ifdef HAVE_THREADS
+	I_lock_mutex(&apng_mutex);
+#endif
+}
+
+static inline void M_UnlockAPNG(void)
+{
+#ifdef HAVE_THREADS
+	I_unlock_mutex(apng_mutex);
+#endif
+}
+
+static boolean M_WriteAPNGFrame(png_bytep png_buf)
+{
+	// apng_ptr uses PNG_longjmp_error while frames are being written
+	if (setjmp(png_jmpbuf(apng_ptr)))
+		return false;
+
+	M_PNGFrame(apng_ptr, apng_info_ptr, png_buf);
+	return true;
+}
+
+static void M_RunAPNGJob(void *userdata)
+{
+	(void)userdata;
+
+	for (;;)
+	{
+		apngframe_t *frame;
+		boolean ok;
+
+		M_LockAPNG();
+		if (apng_queuecount == 0 || apng_failed)
+		{
+			apng_writing = false;
+#ifdef HAVE_THREADS
+			I_wake_all_cond(&apng_cond);
+#endif
+			M_UnlockAPNG();
+			return;
+		}
+		frame = &apng_queue[apng_queuehead];
+		M_UnlockAPNG();
+
+		ok = M_WriteAPNGFrame(frame->pixels);
+
+		M_LockAPNG();
+		apng_failed = !ok;
+		if (ok)
+			apng_frames++;
+		apng_queuehead = (apng_queuehead + 1) % APNG_MAXFRAMES;
+		apng_queuecount--;
+		M_UnlockAPNG();
+	}
+}
+
+// Returns false if writing has failed
+static boolean M_QueueAPNGFrame(const UINT8 *linear, size_t size)
+{
+	apngframe_t *frame;
+	boolean start;
+
+	M_LockAPNG();
+	if (apng_failed)
+	{
+		M_UnlockAPNG();
+		return false;
+	}
+	if (apng_queuecount == APNG_MAXFRAMES)
+	{
+		apng_dropped++;
+		M_UnlockAPNG();
+		return true;
+	}
+	// Not read until it's counted below
+	frame = &apng_queue[(apng_queuehead + apng_queuecount) % APNG_MAXFRAMES];
+	M_UnlockAPNG();
+
+	if (frame->size < size)
+	{
+		UINT8 *pixels = static_cast<UINT8*>(realloc(frame->pixels, size));
+
+		if (pixels == NULL)
+		{
+			apng_dropped++;
+			return true;
+		}
+
+		frame->pixels = pixels;
+		frame->size = size;
+	}
+
+	memcpy(frame->pixels, linear, size);
+
+	M_LockAPNG();
+	apng_queuecount++;
+	start = !apng_writing;
+	apng_writing = true;
+	M_UnlockAPNG();
+
+	if (start)
+	{
+#ifdef HAVE_THREADS
+		I_MediaThreadPoolSubmit(M_RunAPNGJob, NULL);
+#else
+		M_RunAPNGJob(NULL);
+#endif
+	}
+
+	return true;
+}
+
+// Whether the frames written and queued fill the file
+static boolean M_APNGFull(void)
+{
+	boolean full;
+
+	M_LockAPNG();
+	full = (apng_frames + apng_queuecount >= PNG_UINT_31_MAX);
+	M_UnlockAPNG();
+
+	return full;
+}
+
+// Waits for every queued frame to be written
+static void M_FinishAPNG(void)
+{
+	INT32 i;
+
+#ifdef HAVE_THREADS
+	I_lock_mutex(&apng_mutex);
+	while (apng_writing)
+		I_hold_cond(&apng_cond, apng_mutex);
+	I_unlock_mutex(apng_mutex);
+#endif
+
+	for (i = 0; i < APNG_MAXFRAMES; i++)
+	{
+		free(apng_queue[i].pixels);
+		apng_queue[i].pixels = NULL;
+		apng_queue[i].size = 0;
+	}
+
+	apng_queuehead = apng_queuecount = 0;
+}
+
 static void M_PNGfix_acTL(png_structp png_ptr, png_infop png_info_ptr,
 		apng_infop png_ainfo_ptr)
 {
@@ -1164,6 +1365,11 @@ static boolean M_SetupaPNG(png_const_charp filename, png_bytep pal)
 
 	downscale = apng_downscale ? vid.dupx : 1;
 
+	apng_width = vid.width;
+	apng_height = vid.height;
+	apng_downscaleamt = downscale;
+	apng_delay = (png_uint_16)cv_apng_delay.value;
+
 	apng_FILE = fopen(filename,"wb+"); // + mode for reading
 	if (!apng_FILE)
 	{
@@ -1216,7 +1422,11 @@ static boolean M_SetupaPNG(png_const_charp filename, png_bytep pal)
 
 	M_PNGhdr(apng_ptr, apng_info_ptr, vid.width / downscale, vid.height / downscale, pal);
 
-	M_PNGText(apng_ptr, apng_info_ptr, true);
+	{
+		pnginfotext_t info;
+		M_PNGGetText(&info);
+		M_PNGText(apng_ptr, apng_info_ptr, &info, true);
+	}
 
 	apng_set_set_acTL_fn(apng_ptr, apng_ainfo_ptr, aPNG_set_acTL);
 
@@ -1225,6 +1435,12 @@ static boolean M_SetupaPNG(png_const_charp filename, png_bytep pal)
 	apng_write_info(apng_ptr, apng_info_ptr, apng_ainfo_ptr);
 
 	apng_frames = 0;
+	apng_dropped = 0;
+	apng_failed = false;
+
+	// Frames are written on another thread from here on, so errors have to
+	// unwind to M_WriteAPNGFrame instead of calling I_Error.
+	png_set_error_fn(apng_ptr, png_get_error_ptr(apng_ptr), PNG_longjmp_error, PNG_warn);
 
 	return true;
 }
@@ -1452,13 +1668,17 @@ void M_LegacySaveFrame(void)
 				else
 					linear = HWR_GetScreenshot();
 #endif
-				M_PNGFrame(apng_ptr, apng_info_ptr, (png_bytep)linear);
+				if (linear && !M_QueueAPNGFrame(linear, (size_t)vid.width * vid.height * (rendermode == render_soft ? 1 : 3)))
+				{
+					CONS_Alert(CONS_ERROR, M_GetText("Couldn't write aPNG frame, stopping\n"));
+					M_StopMovie();
+				}
 #ifdef HWRENDER
 				if (rendermode != render_soft && linear)
 					free(linear);
 #endif
 
-				if (apng_frames == PNG_UINT_31_MAX)
+				if (M_APNGFull())
 				{
 					CONS_Alert(CONS_NOTICE, M_GetText("Max movie size reached\n"));
 					M_StopMovie();
@@ -1555,6 +1775,14 @@ void M_StopMovie(void)
 			if (!apng_FILE)
 				return;
 
+			M_FinishAPNG();
+
+			// Back on this thread, no jmpbuf is set up
+			png_set_error_fn(apng_ptr, png_get_error_ptr(apng_ptr), PNG_error, PNG_warn);
+
+			if (apng_failed)
+				CONS_Alert(CONS_ERROR, M_GetText("aPNG is likely incomplete, a frame failed to write\n"));
+
 			if (apng_frames)
 			{
 				M_PNGfix_acTL(apng_ptr, apng_info_ptr, apng_ainfo_ptr);
@@ -1566,6 +1794,8 @@ void M_StopMovie(void)
 			fclose(apng_FILE);
 			apng_FILE = NULL;
 			CONS_Printf("aPNG closed; wrote %u frames\n", (UINT32)apng_frames);
+			if (apng_dropped)
+				CONS_Printf("%u frames were dropped to keep up\n", (UINT32)apng_dropped);
 			apng_frames = 0;
 			break;
 #else
@@ -1590,16 +1820,29 @@ void M_StopMovie(void)
 //                            SCREEN SHOTS
 // ==========================================================================
 #ifdef USE_PNG
-/** Writes a PNG file to disk.
+// Snapshot of the zlib cvars, since those can change while a file is written
+struct pngzlib_t
+{
+	INT32 level, memory, strategy, window_bits;
+};
+
+static void M_PNGGetZlib(pngzlib_t *zlib)
+{
+	zlib->level = cv_zlib_level.value;
+	zlib->memory = cv_zlib_memory.value;
+	zlib->strategy = cv_zlib_strategy.value;
+	zlib->window_bits = cv_zlib_window_bits.value;
+}
+
+/** Writes a PNG to an already open file, and closes it. Safe to call from
+  * any thread, since errors unwind back here instead of calling I_Error.
   *
-  * \param filename Filename to write to.
-  * \param data     The image data.
-  * \param width    Width of the picture.
-  * \param height   Height of the picture.
-  * \param palette  Palette of image data.
-  *  \note if palette is NULL, BGR888 format
+  * \param png_FILE File to write to.
+  * \param filename Its name, so it can be removed on failure.
+  * \sa M_SavePNG
   */
-boolean M_SavePNG(const char *filename, const void *data, int width, int height, const UINT8 *palette)
+static boolean M_WritePNG(png_FILE_p png_FILE, const char *filename, const void *data, int width, int height, const UINT8 *palette,
+	pnginfotext_t *info, const pngzlib_t *zlib)
 {
 	png_structp png_ptr;
 	png_infop png_info_ptr;
@@ -1608,16 +1851,8 @@ boolean M_SavePNG(const char *filename, const void *data, int width, int height,
 	jmp_buf jmpbuf;
 #endif
 #endif
-	png_FILE_p png_FILE;
-
-	png_FILE = fopen(filename,"wb");
-	if (!png_FILE)
-	{
-		CONS_Debug(DBG_RENDER, "M_SavePNG: Error on opening %s for write\n", filename);
-		return false;
-	}
 
-	png_ptr = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, PNG_error, PNG_warn);
+	png_ptr = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, PNG_longjmp_error, PNG_warn);
 	if (!png_ptr)
 	{
 		CONS_Debug(DBG_RENDER, "M_SavePNG: Error on initialize libpng\n");
@@ -1659,14 +1894,14 @@ boolean M_SavePNG(const char *filename, const void *data, int width, int height,
 
 	//png_set_filter(png_ptr, 0, PNG_ALL_FILTERS);
 
-	png_set_compression_level(png_ptr, cv_zlib_level.value);
-	png_set_compression_mem_level(png_ptr, cv_zlib_memory.value);
-	png_set_compression_strategy(png_ptr, cv_zlib_strategy.value);
-	png_set_compression_window_bits(png_ptr, cv_zlib_window_bits.value);
+	png_set_compression_level(png_ptr, zlib->level);
+	png_set_compression_mem_level(png_ptr, zlib->memory);
+	png_set_compression_strategy(png_ptr, zlib->strategy);
+	png_set_compression_window_bits(png_ptr, zlib->window_bits);
 
 	M_PNGhdr(png_ptr, png_info_ptr, width, height, palette);
 
-	M_PNGText(png_ptr, png_info_ptr, false);
+	M_PNGText(png_ptr, png_info_ptr, info, false);
 
 	png_write_info(png_ptr, png_info_ptr);
 
@@ -1675,7 +1910,234 @@ boolean M_SavePNG(const char *filename, const void *data, int width, int height,
 	png_write_end(png_ptr, png_info_ptr);
 	png_destroy_write_struct(&png_ptr, &png_info_ptr);
 
-	fclose(png_FILE);
+	return (fclose(png_FILE) == 0);
+}
+
+/** Writes a PNG file to disk.
+  *
+  * \param filename Filename to write to.
+  * \param data     The image data.
+  * \param width    Width of the picture.
+  * \param height   Height of the picture.
+  * \param palette  Palette of image data.
+  *  \note if palette is NULL, BGR888 format
+  */
+boolean M_SavePNG(const char *filename, const void *data, int width, int height, const UINT8 *palette)
+{
+	png_FILE_p png_FILE;
+	pnginfotext_t info;
+	pngzlib_t zlib;
+
+	png_FILE = fopen(filename,"wb");
+	if (!png_FILE)
+	{
+		CONS_Debug(DBG_RENDER, "M_SavePNG: Error on opening %s for write\n", filename);
+		return false;
+	}
+
+	M_PNGGetText(&info);
+	M_PNGGetZlib(&zlib);
+
+	return M_WritePNG(png_FILE, filename, data, width, height, palette, &info, &zlib);
+}
+
+// ==========================================================================
+//                        BACKGROUND SCREEN SHOTS
+// ==========================================================================
+// The screen is copied once, then compressed and written on the media thread pool,
+// since a large screenshot takes a noticeable while to encode. Results are
+// reported from M_ScreenshotTicker, on the game thread.
+#define MAXSCREENSHOTJOBS 4
+
+enum screenshotjobstate_t
+{
+	SSJOB_FREE,
+	SSJOB_BUSY,
+	SSJOB_DONE,
+};
+
+struct screenshotjob_t
+{
+	screenshotjobstate_t state;
+	boolean ok;
+
+	png_FILE_p file; // opened on the game thread, so the name is taken right away
+	char filename[MAX_WADPATH + 20];
+	const char *freename; // into filename
+
+	UINT8 *pixels; // kept between screenshots
+	size_t pixelsize;
+	UINT32 width, height;
+
+	pnginfotext_t info;
+	pngzlib_t zlib;
+};
+
+static screenshotjob_t screenshotjobs[MAXSCREENSHOTJOBS];
+static INT32 screenshotjob_next = 0; // oldest, and next to be reused
+
+#ifdef HAVE_THREADS
+static I_mutex screenshotjob_mutex;
+static I_cond screenshotjob_cond;
+#endif
+
+static screenshotjobstate_t M_ScreenShotJobState(const screenshotjob_t *job)
+{
+	screenshotjobstate_t state;
+
+#ifdef HAVE_THREADS
+	I_lock_mutex(&screenshotjob_mutex);
+#endif
+	state = job->state;
+#ifdef HAVE_THREADS
+	I_unlock_mutex(screenshotjob_mutex);
+#endif
+
+	return state;
+}
+
+static void M_SetScreenShotJobState(screenshotjob_t *job, screenshotjobstate_t state)
+{
+#ifdef HAVE_THREADS
+	I_lock_mutex(&screenshotjob_mutex);
+#endif
+	job->state = state;
+#ifdef HAVE_THREADS
+	I_wake_all_cond(&screenshotjob_cond);
+	I_unlock_mutex(screenshotjob_mutex);
+#endif
+}
+
+static void M_RunScreenShotJob(void *userdata)
+{
+	screenshotjob_t *job = static_cast<screenshotjob_t*>(userdata);
+
+	job->ok = M_WritePNG(job->file, job->filename, job->pixels, job->width, job->height, NULL, &job->info, &job->zlib);
+	job->file = NULL;
+
+	M_SetScreenShotJobState(job, SSJOB_DONE);
+}
+
+static void M_ReportScreenShot(const screenshotjob_t *job)
+{
+	const size_t pathlen = job->freename - job->filename;
+
+	if (job->ok)
+	{
+		if (moviemode != MM_SCREENSHOT)
+			CONS_Printf(M_GetText("Screen shot %s saved in %.*s\n"), job->freename, (int)pathlen, job->filename);
+	}
+	else
+	{
+		CONS_Alert(CONS_ERROR, M_GetText("Couldn't create screen shot %s in %.*s\n"), job->freename, (int)pathlen, job->filename);
+
+		if (moviemode == MM_SCREENSHOT)
+			M_StopMovie();
+	}
+}
+
+// Reports a screenshot if it's finished, waiting for it first if wait is set
+static void M_FinishScreenShot(screenshotjob_t *job, boolean wait)
+{
+#ifdef HAVE_THREADS
+	if (wait)
+	{
+		I_lock_mutex(&screenshotjob_mutex);
+		while (job->state == SSJOB_BUSY)
+			I_hold_cond(&screenshotjob_cond, screenshotjob_mutex);
+		I_unlock_mutex(screenshotjob_mutex);
+	}
+#else
+	(void)wait;
+#endif
+
+	if (M_ScreenShotJobState(job) != SSJOB_DONE)
+		return;
+
+	M_ReportScreenShot(job);
+	M_SetScreenShotJobState(job, SSJOB_FREE);
+}
+
+// Reports finished screenshots. If wait is set, waits for all of them.
+static void M_FinishScreenShots(boolean wait)
+{
+	INT32 i;
+
+	for (i = 0; i < MAXSCREENSHOTJOBS; i++)
+		M_FinishScreenShot(&screenshotjobs[(screenshotjob_next + i) % MAXSCREENSHOTJOBS], wait);
+}
+
+static void M_FlushScreenShots(void)
+{
+	M_FinishScreenShots(true);
+}
+
+// Picks a job to copy the next screenshot into, waiting for the oldest if they're all busy
+static screenshotjob_t *M_GetScreenShotJob(void)
+{
+	static boolean exitfunc = false;
+	screenshotjob_t *job = &screenshotjobs[screenshotjob_next];
+
+	if (!exitfunc)
+	{
+		// Don't leave half written files behind when quitting
+		I_AddExitFunc(M_FlushScreenShots);
+		exitfunc = true;
+	}
+
+	// Only the oldest needs to be done, the others can keep going
+	if (M_ScreenShotJobState(job) != SSJOB_FREE)
+	{
+		M_FinishScreenShot(job, true);
+	}
+
+	screenshotjob_next = (screenshotjob_next + 1) % MAXSCREENSHOTJOBS;
+	return job;
+}
+
+// Returns false if the file couldn't be created at all
+static boolean M_QueueScreenShot(const char *pathname, const char *freename, UINT32 width, UINT32 height, tcb::span<const std::byte> data)
+{
+	screenshotjob_t *job = M_GetScreenShotJob();
+	const size_t size = data.size_bytes();
+
+	snprintf(job->filename, sizeof job->filename, "%s%s", pathname, freename);
+	job->freename = job->filename + strlen(pathname);
+
+	if (job->pixelsize < size)
+	{
+		UINT8 *pixels = static_cast<UINT8*>(realloc(job->pixels, size));
+
+		if (pixels == NULL)
+			return false;
+
+		job->pixels = pixels;
+		job->pixelsize = size;
+	}
+
+	job->file = fopen(job->filename, "wb");
+	if (!job->file)
+	{
+		CONS_Debug(DBG_RENDER, "M_SavePNG: Error on opening %s for write\n", job->filename);
+		return false;
+	}
+
+	memcpy(job->pixels, data.data(), size);
+	job->width = width;
+	job->height = height;
+
+	M_PNGGetText(&job->info);
+	M_PNGGetZlib(&job->zlib);
+
+	M_SetScreenShotJobState(job, SSJOB_BUSY);
+
+#ifdef HAVE_THREADS
+	I_MediaThreadPoolSubmit(M_RunScreenShotJob, job);
+#else
+	M_RunScreenShotJob(job);
+	M_FinishScreenShots(false);
+#endif
+
 	return true;
 }
 #else
@@ -1827,9 +2289,10 @@ void M_DoScreenShot(UINT32 width, UINT32 height, tcb::span<const std::byte> data
 	else
 #endif
 	{
-		const void* pixel_data = static_cast<const void*>(data.data());
 #ifdef USE_PNG
-		ret = M_SavePNG(va(pandf,pathname,freename), pixel_data, width, height, NULL);
+		// Reported by M_ScreenshotTicker once it's written
+		if (M_QueueScreenShot(pathname, freename, width, height, data))
+			return;
 #else
 		ret = WritePCXfile(va(pandf,pathname,freename), linear, vid.width, vid.height, screenshot_palette);
 #endif
@@ -1858,6 +2321,10 @@ void M_ScreenshotTicker(void)
 {
 	const UINT8 pid = 0; // TODO: should splitscreen players be allowed to use this too?
 
+#ifdef USE_PNG
+	M_FinishScreenShots(false);
+#endif
+
 	if (M_MenuButtonPressed(pid, MBT_SCREENSHOT))
 	{
 		M_ScreenShot();
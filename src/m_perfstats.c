@@ -15,11 +15,13 @@
 #include "i_video.h"
 #include "d_netcmd.h"
 #include "r_main.h"
+#include "r_plane.h" // visplane stats
 #include "i_system.h"
 #include "i_time.h"
 #include "z_zone.h"
 #include "p_local.h"
 #include "g_game.h"
+#include "deh_tables.h" // MOBJTYPE_LIST, FREE_MOBJS
 
 #ifdef HWRENDER
 #include "hardware/hw_main.h"
@@ -58,8 +60,13 @@ precise_t ps_acs_time = 0;
 
 int ps_checkposition_calls = 0;
 
+int ps_atlas_uploads = 0;
+int ps_atlas_uploadkb = 0;
+int ps_atlas_repacks = 0;
+
 precise_t ps_lua_thinkframe_time = 0;
 int ps_lua_mobjhooks = 0;
+int ps_lua_mobjhooks_bytype[NUMMOBJTYPES];
 
 // dynamically allocated resizeable array for thinkframe hook stats
 ps_hookinfo_t *thinkframe_hooks = NULL;
@@ -196,6 +203,7 @@ static void M_DrawRenderStats(void)
 		{"portals", "Portals+Skybox:", &ps_sw_portaltime},
 		{"planes ", "R_DrawPlanes:  ", &ps_sw_planetime},
 		{"masked ", "R_DrawMasked:  ", &ps_sw_maskedtime},
+		{"sprsort", " Sprite sort:  ", &ps_sw_spritesorttime}, // part of R_DrawMasked
 		{"other  ", "Other:         ", &extrarendertime},
 		{0}
 	};
@@ -219,6 +227,25 @@ static void M_DrawRenderStats(void)
 		{0}
 	};
 
+	// Rounded, since the counts are whole numbers
+	int visplaneavgchain = ps_visplanelookups ?
+		(ps_visplaneprobes + ps_visplanelookups / 2) / ps_visplanelookups : 0;
+
+	perfstatrow_t visplanes_row[] = {
+		{"visplns", "Visplanes:   ", &ps_numvisplanes},
+		{"merges ", "Merges:      ", &ps_visplanemerges},
+		{"avgchn ", "Avg chain:   ", &visplaneavgchain},
+		{"maxchn ", "Max chain:   ", &ps_visplanemaxchain},
+		{0}
+	};
+
+	perfstatrow_t atlas_row[] = {
+		{"atlsupl", "Atlas upload:", &ps_atlas_uploads},
+		{"atlskb ", "Atlas KB:    ", &ps_atlas_uploadkb},
+		{"atlsrpk", "Atlas repack:", &ps_atlas_repacks},
+		{0}
+	};
+
 	perfstatrow_t batchtime_row[] = {
 		{"batsort", "Batch sort:  ", &ps_hw_batchsorttime},
 		{"batdraw", "Batch render:", &ps_hw_batchdrawtime},
@@ -251,6 +278,9 @@ static void M_DrawRenderStats(void)
 
 	perfstatcol_t    rendercalls_col =  {90, 115, V_BLUEMAP,      rendercalls_row};
 
+	perfstatcol_t      visplanes_col =  {90, 115, V_BLUEMAP,        visplanes_row};
+	perfstatcol_t          atlas_col =  {90, 115, V_BLUEMAP,            atlas_row};
+
 	perfstatcol_t      batchtime_col =  {90, 115, V_REDMAP,         batchtime_row};
 
 	perfstatcol_t     batchcount_col = {155, 200, V_PURPLEMAP,     batchcount_row};
@@ -311,6 +341,15 @@ static void M_DrawRenderStats(void)
 		draw_row = 10;
 		M_DrawPerfCount(&rendercalls_col);
 
+		if (rendermode == render_soft)
+		{
+			draw_row += half_row;
+			M_DrawPerfCount(&visplanes_col);
+		}
+
+		draw_row += half_row;
+		M_DrawPerfCount(&atlas_col);
+
 #ifdef HWRENDER
 		if (rendermode == render_opengl && cv_glbatching.value)
 		{
@@ -490,6 +529,65 @@ static void M_DrawTickStats(void)
 	M_DrawPerfCount(&misc_calls_col);
 }
 
+#define PS_MAXHOOKTYPES 48
+
+// Mobj hook calls per type this tic, busiest first
+static void PS_DrawMobjHookCounts(int x, int y)
+{
+	mobjtype_t top[PS_MAXHOOKTYPES];
+	int numtop = 0;
+	int i, j;
+	char s[100];
+
+	for (i = 0; i < NUMMOBJTYPES; i++)
+	{
+		if (ps_lua_mobjhooks_bytype[i] <= 0)
+			continue;
+
+		for (j = numtop; j > 0 && ps_lua_mobjhooks_bytype[top[j - 1]] < ps_lua_mobjhooks_bytype[i]; j--)
+		{
+			if (j < PS_MAXHOOKTYPES)
+				top[j] = top[j - 1];
+		}
+
+		if (j < PS_MAXHOOKTYPES)
+		{
+			top[j] = i;
+			if (numtop < PS_MAXHOOKTYPES)
+				numtop++;
+		}
+	}
+
+	if (numtop == 0)
+		return;
+
+	y += 4;
+	V_DrawSmallString(x, y, V_MONOSPACE | V_GRAYMAP, "Lua mobj hooks by type");
+	y += 4;
+
+	for (i = 0; i < numtop; i++)
+	{
+		const char *name;
+
+		if (y > 192)
+		{
+			y = 4;
+			x += 106;
+			if (x > 214)
+				break;
+		}
+
+		if (top[i] < MT_FIRSTFREESLOT)
+			name = MOBJTYPE_LIST[top[i]] + 3; // skip MT_
+		else
+			name = FREE_MOBJS[top[i] - MT_FIRSTFREESLOT];
+
+		snprintf(s, sizeof s - 1, "%20.20s: %d", name ? name : "?", ps_lua_mobjhooks_bytype[top[i]]);
+		V_DrawSmallString(x, y, V_MONOSPACE | V_PURPLEMAP, s);
+		y += 4;
+	}
+}
+
 void M_DrawPerfStats(void)
 {
 	char s[363];
@@ -701,6 +799,9 @@ void M_DrawPerfStats(void)
 						break;
 				}
 			}
+
+			if (x <= 214)
+				PS_DrawMobjHookCounts(x, y);
 		}
 	}
 }
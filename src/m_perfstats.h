@@ -42,8 +42,14 @@ extern precise_t ps_acs_time;
 
 extern int       ps_checkposition_calls;
 
+// hwr2 patch atlases, for the last frame
+extern int       ps_atlas_uploads;
+extern int       ps_atlas_uploadkb;
+extern int       ps_atlas_repacks;
+
 extern precise_t ps_lua_thinkframe_time;
 extern int       ps_lua_mobjhooks;
+extern int       ps_lua_mobjhooks_bytype[NUMMOBJTYPES];
 
 struct ps_hookinfo_t
 {
@@ -64,7 +64,7 @@ std::unique_ptr<AudioEncoder> Impl::make_audio_encoder(const Config cfg) const
 	return container_->make_audio_encoder({2, a.sample_rate});
 }
 
-std::unique_ptr<VideoEncoder> Impl::make_video_encoder(const Config cfg) const
+std::unique_ptr<VideoEncoder> Impl::make_video_encoder(const Config cfg)
 {
 	if (!cfg.video)
 	{
@@ -73,7 +73,7 @@ std::unique_ptr<VideoEncoder> Impl::make_video_encoder(const Config cfg) const
 
 	const Config::Video& v = *cfg.video;
 
-	return container_->make_video_encoder({v.width, v.height, v.frame_rate, kBufferMethod});
+	return container_->make_video_encoder({v.width, v.height, v.frame_rate, kBufferMethod, &row_workers_});
 }
 
 Impl::~Impl()
@@ -102,6 +102,15 @@ Impl::~Impl()
 		CONS_Alert(CONS_ERROR, "AVRecorder::Impl::~Impl: %s\n", ex.what());
 		return;
 	}
+
+	if (video_frames_dropped_ > 0)
+	{
+		CONS_Printf(
+			"Video: %d frames dropped, encoder could not keep up (queue peaked at %zu)\n",
+			video_frames_dropped_.load(),
+			video_queue_peak_.load()
+		);
+	}
 }
 
 std::optional<int> Impl::advance_video_pts()
@@ -113,16 +122,30 @@ std::optional<int> Impl::advance_video_pts()
 	// spend longer than one frame rate on a single
 	// frame. It should normalize though.
 
-	if (video_queue_.vec_.size() >= 3)
-	{
-		return {};
-	}
-
 	SRB2_ASSERT(video_encoder_ != nullptr);
 
 	const float tic_pts = video_encoder_->frame_rate() / static_cast<float>(TICRATE);
 	const int pts = ((I_GetTime() - epoch_) + FixedToFloat(g_time.timefrac)) * tic_pts;
 
+	const std::size_t depth = video_queue_.vec_.size();
+
+	if (depth > video_queue_peak_)
+	{
+		video_queue_peak_ = depth;
+	}
+
+	if (depth >= kMaxQueuedVideoFrames)
+	{
+		// Only count each frame that was actually due once.
+		if (pts >= video_queue_.pts() && pts != last_dropped_pts_)
+		{
+			video_frames_dropped_++;
+			last_dropped_pts_ = pts;
+		}
+
+		return {};
+	}
+
 	if (!video_queue_.advance(pts, 1))
 	{
 		return {};
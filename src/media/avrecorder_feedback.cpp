@@ -144,6 +144,11 @@ void AVRecorder::draw_statistics() const
 		return 0;
 	}();
 
+	if (const int dropped = impl_->video_frames_dropped_; dropped > 0)
+	{
+		draw(150, fmt::format("-{} dropped", dropped), V_REDMAP);
+	}
+
 	draw(200, fmt::format("{:.0f}", fps), fps_color);
 	draw(230, fmt::format("{:.1f}s", impl_->container_->duration().count()));
 	draw(260, fmt::format("{:.1f} MB", size / kMb), mb_color);
@@ -24,6 +24,7 @@
 #include "../i_time.h"
 #include "avrecorder.hpp"
 #include "container.hpp"
+#include "row_workers.hpp"
 
 namespace srb2::media
 {
@@ -98,6 +99,9 @@ public:
 	// the original, unmodified value.
 	const decltype(max_duration_) max_duration_config_ = max_duration_;
 
+	// Must outlive video_encoder_.
+	RowWorkers row_workers_;
+
 	std::unique_ptr<MediaContainer> container_;
 	std::unique_ptr<AudioEncoder> audio_encoder_;
 	std::unique_ptr<VideoEncoder> video_encoder_;
@@ -114,6 +118,11 @@ public:
 	// Average number of frames actually encoded per second.
 	std::atomic<float> video_frame_rate_avg_ = 0.f;
 
+	// Frames that were due but skipped because the encoder
+	// fell behind, and the deepest the video queue has been.
+	std::atomic<int> video_frames_dropped_ = 0;
+	std::atomic<std::size_t> video_queue_peak_ = 0;
+
 	Impl(Config config);
 	~Impl();
 
@@ -126,6 +135,10 @@ public:
 	// Use to notify worker thread if queues were modified.
 	void wake_up_worker() { queue_cond_.notify_one(); }
 
+	// Returns a recycled staging frame if one of the right
+	// size is available.
+	StagingVideoFrame::instance_t reuse_staging_video_frame(uint32_t width, uint32_t height, int pts);
+
 private:
 	enum class QueueState
 	{
@@ -134,6 +147,16 @@ private:
 		kFinished, // all queues are finished -- no more data may be queued
 	};
 
+	// Staging frames hold a full copy of the screen. Keep a
+	// few around after encoding so capture doesn't allocate
+	// and zero fill a new buffer every frame.
+	static constexpr std::size_t kMaxQueuedVideoFrames = 3;
+	static constexpr std::size_t kMaxPooledVideoFrames = kMaxQueuedVideoFrames + 1;
+
+	std::vector<StagingVideoFrame::instance_t> staging_pool_; // guarded by queue_mutex_
+
+	int last_dropped_pts_ = -1; // guarded by queue_mutex_
+
 	const tic_t epoch_;
 
 	VideoEncoder::FrameCount video_frame_count_reference_ = {};
@@ -143,7 +166,7 @@ private:
 	std::condition_variable_any queue_cond_;
 
 	std::unique_ptr<AudioEncoder> make_audio_encoder(const Config cfg) const;
-	std::unique_ptr<VideoEncoder> make_video_encoder(const Config cfg) const;
+	std::unique_ptr<VideoEncoder> make_video_encoder(const Config cfg);
 
 	QueueState encode_queues();
 	void update_video_frame_rate_avg();
@@ -153,6 +176,7 @@ private:
 	void container_dtor_handler(const MediaContainer& container) const;
 
 	VideoFrame::instance_t convert_staging_video_frame(const StagingVideoFrame& indexed);
+	void recycle_staging_video_frame(StagingVideoFrame::instance_t frame);
 };
 
 template <>
@@ -30,25 +30,69 @@ VideoFrame::instance_t Impl::convert_staging_video_frame(const StagingVideoFrame
 
 	const VideoFrame::Buffer& buffer = frame->rgba_buffer();
 
-	const uint8_t* s = staging.screen.data();
-	uint8_t* p = buffer.plane.data();
+	const uint8_t* src = staging.screen.data();
+	uint8_t* dst = buffer.plane.data();
+
+	const int width = frame->width();
 
 	// Convert from RGB8 to RGBA8
-	for (int y = 0; y < frame->height(); ++y)
+	row_workers_.run(
+		frame->height(),
+		1,
+		[&](int begin, int end)
+		{
+			for (int y = begin; y < end; ++y)
+			{
+				const uint8_t* s = src + (y * staging.width * 3);
+				uint8_t* p = dst + (y * buffer.row_stride);
+
+				for (int x = 0; x < width; ++x)
+				{
+					p[x * 4] = s[x * 3];
+					p[x * 4 + 1] = s[x * 3 + 1];
+					p[x * 4 + 2] = s[x * 3 + 2];
+					p[x * 4 + 3] = 255;
+				}
+			}
+		}
+	);
+
+	return frame;
+}
+
+AVRecorder::StagingVideoFrame::instance_t
+Impl::reuse_staging_video_frame(uint32_t width, uint32_t height, int pts)
+{
+	auto _ = queue_guard();
+
+	while (!staging_pool_.empty())
 	{
-		for (int x = 0; x < frame->width(); ++x)
+		StagingVideoFrame::instance_t frame = std::move(staging_pool_.back());
+
+		staging_pool_.pop_back();
+
+		// The resolution changed, these are useless now.
+		if (frame->width != width || frame->height != height)
 		{
-			p[x * 4] = s[x * 3];
-			p[x * 4 + 1] = s[x * 3 + 1];
-			p[x * 4 + 2] = s[x * 3 + 2];
-			p[x * 4 + 3] = 255;
+			continue;
 		}
 
-		s += staging.width * 3;
-		p += buffer.row_stride;
+		frame->pts = pts;
+
+		return frame;
 	}
 
-	return frame;
+	return nullptr;
+}
+
+void Impl::recycle_staging_video_frame(StagingVideoFrame::instance_t frame)
+{
+	auto _ = queue_guard();
+
+	if (staging_pool_.size() < kMaxPooledVideoFrames)
+	{
+		staging_pool_.emplace_back(std::move(frame));
+	}
 }
 
 AVRecorder::StagingVideoFrame::instance_t AVRecorder::new_staging_video_frame(uint32_t width, uint32_t height)
@@ -60,6 +104,11 @@ AVRecorder::StagingVideoFrame::instance_t AVRecorder::new_staging_video_frame(ui
 		return nullptr;
 	}
 
+	if (auto frame = impl_->reuse_staging_video_frame(width, height, *pts))
+	{
+		return frame;
+	}
+
 	return std::make_unique<StagingVideoFrame>(width, height, *pts);
 }
 
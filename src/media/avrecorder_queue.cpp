@@ -128,6 +128,8 @@ Impl::QueueState Impl::encode_queues()
 		{
 			auto frame = convert_staging_video_frame(*p);
 
+			recycle_staging_video_frame(std::move(p));
+
 			video_encoder_->encode(std::move(frame));
 		}
 
@@ -54,6 +54,8 @@ const Options VP8Encoder::options_("vp8", {
 	})},
 	{"sharpness", Options::values<int>("7", {0, 7})},
 	{"token_parts", Options::values<int>("0", {0, 3})},
-	{"threads", Options::values<int>("1", {1})},
+	{"threads", Options::values<int>("auto", {1}, {
+		{"auto", static_cast<int>(ThreadsOption::kAuto)},
+	})},
 });
 // clang-format on
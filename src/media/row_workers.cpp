@@ -0,0 +1,44 @@
+// DR. ROBOTNIK'S RING RACERS
+//-----------------------------------------------------------------------------
+// Copyright (C) 2024 by James Robert Roman
+// Copyright (C) 2024 by Kart Krew
+//
+// This program is free software distributed under the
+// terms of the GNU General Public License, version 2.
+// See the 'LICENSE' file for more details.
+//-----------------------------------------------------------------------------
+
+#include <algorithm>
+#include <thread>
+
+#include "row_workers.hpp"
+
+using namespace srb2::media;
+
+namespace
+{
+
+// Same cap as the main thread pool
+constexpr unsigned int kMaxBands = 8;
+
+int band_count()
+{
+	return std::clamp(std::thread::hardware_concurrency(), 1u, kMaxBands);
+}
+
+}; // namespace
+
+RowWorkers::RowWorkers() :
+	bands_(band_count()),
+
+	// With one band, a default constructed pool runs
+	// everything immediately on the calling thread.
+	pool_(bands_ > 1 ? ThreadPool(bands_ - 1) : ThreadPool())
+{
+}
+
+RowWorkers::~RowWorkers()
+{
+	// ThreadPool's own destructor does not join its threads.
+	pool_.shutdown();
+}
@@ -0,0 +1,90 @@
+// DR. ROBOTNIK'S RING RACERS
+//-----------------------------------------------------------------------------
+// Copyright (C) 2024 by James Robert Roman
+// Copyright (C) 2024 by Kart Krew
+//
+// This program is free software distributed under the
+// terms of the GNU General Public License, version 2.
+// See the 'LICENSE' file for more details.
+//-----------------------------------------------------------------------------
+
+#ifndef __SRB2_MEDIA_ROW_WORKERS_HPP__
+#define __SRB2_MEDIA_ROW_WORKERS_HPP__
+
+#include <algorithm>
+
+#include "../core/thread_pool.h"
+
+namespace srb2::media
+{
+
+// Splits per-row image work (pixel format conversion) into
+// horizontal bands and runs them in parallel.
+//
+// This is a private pool, not g_main_threadpool, because
+// ThreadPool only supports scheduling from one thread and
+// the main pool belongs to the game thread. Only one thread
+// may call RowWorkers::run (the recorder's worker thread).
+class RowWorkers
+{
+public:
+	// Picks a thread count from the hardware.
+	RowWorkers();
+	~RowWorkers();
+
+	RowWorkers(const RowWorkers&) = delete;
+	RowWorkers& operator=(const RowWorkers&) = delete;
+
+	// Number of bands that work is split into. The calling
+	// thread always processes one of them.
+	int bands() const { return bands_; }
+
+	// Calls fn(begin, end) for each band of rows in [0,
+	// rows). Every band except the last starts and ends on
+	// a multiple of align (e.g. 2 for chroma subsampled
+	// planes). Returns once all bands are finished.
+	template <typename F>
+	void run(int rows, int align, F fn);
+
+private:
+	int bands_;
+	ThreadPool pool_;
+};
+
+template <typename F>
+void RowWorkers::run(int rows, int align, F fn)
+{
+	// Bands smaller than this aren't worth the overhead
+	constexpr int kMinBandRows = 32;
+
+	const int n = std::clamp(rows / kMinBandRows, 1, bands_);
+	const int step = ((rows / n) + (align - 1)) / align * align;
+
+	if (n == 1)
+	{
+		fn(0, rows);
+		return;
+	}
+
+	pool_.begin_sema();
+
+	for (int y = step; y < rows; y += step)
+	{
+		const int end = std::min(y + step, rows);
+
+		pool_.schedule([fn, y, end] { fn(y, end); });
+	}
+
+	ThreadPool::Sema sema = pool_.end_sema();
+
+	pool_.notify_sema(sema);
+
+	// First band on this thread while the others run.
+	fn(0, std::min(step, rows));
+
+	pool_.wait_sema(sema);
+}
+
+}; // namespace srb2::media
+
+#endif // __SRB2_MEDIA_ROW_WORKERS_HPP__
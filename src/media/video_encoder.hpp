@@ -17,6 +17,8 @@
 namespace srb2::media
 {
 
+class RowWorkers;
+
 class VideoEncoder : virtual public MediaEncoder
 {
 public:
@@ -26,6 +28,10 @@ public:
 		int height;
 		int frame_rate;
 		VideoFrame::BufferMethod buffer_method;
+
+		// Optional, splits pixel format conversion across
+		// threads. Must outlive the encoder.
+		RowWorkers* row_workers = nullptr;
 	};
 
 	struct FrameCount
@@ -8,17 +8,20 @@
 // See the 'LICENSE' file for more details.
 //-----------------------------------------------------------------------------
 
+#include <algorithm>
 #include <chrono>
 #include <cstddef>
 #include <cstdint>
 #include <memory>
 #include <mutex>
 #include <stdexcept>
+#include <thread>
 
 #include <fmt/format.h>
 #include <tcb/span.hpp>
 
 #include "../cxxutil.hpp"
+#include "row_workers.hpp"
 #include "vp8.hpp"
 #include "vpx_error.hpp"
 #include "yuv420p.hpp"
@@ -32,7 +35,8 @@ const vpx_codec_enc_cfg_t VP8Encoder::configure(const Config user)
 	vpx_codec_enc_cfg_t cfg;
 	vpx_codec_enc_config_default(kCodec, &cfg, 0);
 
-	cfg.g_threads = options_.get<int>("threads");
+	// VP8 splits macroblock rows between these threads.
+	cfg.g_threads = configured_thread_count();
 
 	cfg.g_w = user.width;
 	cfg.g_h = user.height;
@@ -68,7 +72,27 @@ const vpx_codec_enc_cfg_t VP8Encoder::configure(const Config user)
 	return cfg;
 }
 
-VP8Encoder::VP8Encoder(Config config) : ctx_(config), img_(config.width, config.height), frame_rate_(config.frame_rate)
+int VP8Encoder::configured_thread_count()
+{
+	// libvpx gains little past this many threads at the
+	// resolutions the game renders at.
+	constexpr unsigned int kMaxAutoThreads = 8;
+
+	const int threads = options_.get<int>("threads");
+
+	if (threads == static_cast<int>(ThreadsOption::kAuto))
+	{
+		return std::clamp(std::thread::hardware_concurrency(), 1u, kMaxAutoThreads);
+	}
+
+	return threads;
+}
+
+VP8Encoder::VP8Encoder(Config config) :
+	ctx_(config),
+	img_(config.width, config.height),
+	frame_rate_(config.frame_rate),
+	row_workers_(config.row_workers)
 {
 	SRB2_ASSERT(config.buffer_method == VideoFrame::BufferMethod::kEncoderAllocatedRGBA8888);
 
@@ -166,7 +190,18 @@ void VP8Encoder::encode(VideoFrame::instance_t frame)
 		rgba_scaled_buffer_.release();
 	}
 
-	frame_->convert();
+	if (row_workers_)
+	{
+		const YUV420pFrame* frame = frame_.get();
+
+		// Chroma rows are shared by two luma rows, so bands
+		// must be split on even rows.
+		row_workers_->run(frame->height(), 2, [frame](int begin, int end) { frame->convert(begin, end); });
+	}
+	else
+	{
+		frame_->convert();
+	}
 
 	if (vpx_codec_encode(ctx_, img_, frame_->pts(), 1, 0, deadline_) != VPX_CODEC_OK)
 	{
@@ -80,15 +80,21 @@ private:
 	    kInfinite = 0,
 	};
 
+	enum class ThreadsOption : int
+	{
+	    kAuto = 0,
+	};
+
 	static vpx_codec_iface_t* kCodec;
 
 	static const vpx_codec_enc_cfg_t configure(const Config config);
+	static int configured_thread_count();
 
 	CtxWrapper ctx_;
 	ImgWrapper img_;
 
 	const int frame_rate_;
-	const int thread_count_ = options_.get<int>("threads");
+	const int thread_count_ = configured_thread_count();
 	const int deadline_ = options_.get<int>("deadline");
 
 	mutable std::recursive_mutex frame_count_mutex_;
@@ -102,6 +108,8 @@ private:
 
 	std::unique_ptr<YUV420pFrame> frame_;
 
+	RowWorkers* const row_workers_;
+
 	bool process();
 
 	template <typename T> // T = option type
@@ -80,20 +80,24 @@ const VideoFrame::Buffer& YUV420pFrame::rgba_buffer() const
 	return *rgba_;
 }
 
-void YUV420pFrame::convert() const
+void YUV420pFrame::convert(int row_begin, int row_end) const
 {
+	SRB2_ASSERT(row_begin % 2 == 0);
+
+	const int uv_row = row_begin / 2;
+
 	// ABGR = RGBA in memory
 	libyuv::ABGRToI420(
-		rgba_->plane.data(),
+		rgba_->plane.data() + (row_begin * rgba_->row_stride),
 		rgba_->row_stride,
-		y_.plane.data(),
+		y_.plane.data() + (row_begin * y_.row_stride),
 		y_.row_stride,
-		u_.plane.data(),
+		u_.plane.data() + (uv_row * u_.row_stride),
 		u_.row_stride,
-		v_.plane.data(),
+		v_.plane.data() + (uv_row * v_.row_stride),
 		v_.row_stride,
 		width(),
-		height()
+		row_end - row_begin
 	);
 }
 
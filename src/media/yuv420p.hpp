@@ -52,7 +52,12 @@ public:
 	void reset(int pts, const BufferRGBA& rgba) { *this = YUV420pFrame(pts, y_, u_, v_, rgba); }
 
 	// Converts RGBA buffer to YUV planes.
-	void convert() const;
+	void convert() const { convert(0, height()); }
+
+	// Converts only rows [row_begin, row_end). row_begin
+	// must be even because chroma rows cover two luma rows.
+	// Separate ranges may be converted in parallel.
+	void convert(int row_begin, int row_end) const;
 
 	// Scales the existing buffer into a new one. This new
 	// buffer replaces the existing one.
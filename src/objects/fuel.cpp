@@ -190,7 +190,7 @@ private:
 			vis->state(Config::kState);
 			vis->target(this);
 			vis->scale(scale);
-			vis->radius = radius;
+			P_SetThingRadius(vis, radius);
 			vis->spriteyoffset(zOfs);
 
 			vis->phys_angle_ofs(angleOutward);
@@ -562,7 +562,7 @@ Obj_GardenTopDeploy (mobj_t *rider)
 	if (player)
 	{
 		player->curshield = KSHIELD_TOP;
-		rider->radius = K_DefaultPlayerRadius(player);
+		P_SetThingRadius(rider, K_DefaultPlayerRadius(player));
 
 		/* Doing this here to set itemscale.
 		   And unset right afterward so the item box doesn't flicker! */
@@ -620,7 +620,7 @@ Obj_GardenTopThrow (player_t *player)
 
 	player->curshield = KSHIELD_NONE;
 
-	player->mo->radius = K_DefaultPlayerRadius(player);
+	P_SetThingRadius(player->mo, K_DefaultPlayerRadius(player));
 
 	return top;
 }
@@ -786,7 +786,7 @@ Obj_InitHyudoroCenter (mobj_t * center, mobj_t * master)
 			128 * center->scale;
 	}
 
-	center->radius = hyu->radius;
+	P_SetThingRadius(center, hyu->radius);
 
 	hyu->angle = center->angle;
 	P_SetTarget(&hyudoro_center(hyu), center);
@@ -875,7 +875,9 @@ Obj_HyudoroCenterThink (mobj_t *center)
 	fixed_t max_radius = hyudoro_center_max_radius(center);
 
 	if (center->radius < max_radius)
-		center->radius += max_radius / 64;
+	{
+		P_SetThingRadius(center, center->radius + max_radius / 64);
+	}
 }
 
 void
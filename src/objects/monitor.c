@@ -154,7 +154,7 @@ spawn_part_side
 	{
 		mobj_t *part = spawn_part(monitor, p->states[i]);
 
-		part->radius = rad;
+		P_SetThingRadius(part, rad);
 		part_theta(part) = ang;
 
 		// add one point for each layer (back to front order)
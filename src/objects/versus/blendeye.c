@@ -1336,7 +1336,7 @@ static mobj_t *VS_PredictedPuyoShot(mobj_t *arena, mobj_t *source, mobj_t *shot,
 		reticule = P_SpawnMobj(x, y, tempz, MT_SPIKEDTARGET);
 		reticule->renderflags |= RF_NOSPLATBILLBOARD;
 		reticule->destscale = 2*reticule->destscale;
-		reticule->radius = FixedMul(mobjinfo[MT_PLAYER].radius, mapobjectscale)/2;
+		P_SetThingRadius(reticule, FixedMul(mobjinfo[MT_PLAYER].radius, mapobjectscale)/2);
 		//P_SetScale(reticule, reticule->destscale); -- intentionally not here, for animation
 
 		if (P_MobjWasRemoved(shot) == false)
@@ -2200,6 +2200,7 @@ void EV_CrumbleChain(sector_t *sec, ffloor_t *rover)
 	rover->fofflags &= ~FOF_EXISTS;
 	rover->master->frontsector->moved = true;
 	P_RecalcPrecipInSector(sec);
+	P_InvalidateSectorSight(rover->target);
 }
 
 // Used for bobbing platforms on the water
@@ -2335,7 +2336,10 @@ void EV_MarioBlock(ffloor_t *rover, sector_t *sector, mobj_t *puncher)
 		return;
 
 	if (!(rover->fofflags & FOF_SOLID))
+	{
 		rover->fofflags |= (FOF_SOLID|FOF_RENDERALL|FOF_CUTLEVEL);
+		P_InvalidateSectorSight(rover->target);
+	}
 
 	// Find an item to pop out!
 	thing = SearchMarioNode(roversec->touching_thinglist);
@@ -646,9 +646,11 @@ void P_TouchSpecialThing(mobj_t *special, mobj_t *toucher, boolean heightcheck)
 			// Snap to the unfortunate player and quit moving laterally, or we can end up quite far away
 			special->momx = 0;
 			special->momy = 0;
+			P_UnsetThingPosition(special);
 			special->x = toucher->x;
 			special->y = toucher->y;
 			special->z = toucher->z;
+			P_SetThingPosition(special);
 
 			S_StartSound(toucher, sfx_s1b2);
 			return;
@@ -80,6 +80,9 @@ typedef enum
 extern thinker_t thlist[];
 extern mobj_t *mobjcache;
 
+mobj_t *P_AllocMobj(void);
+void P_ClearMobjSlabs(void);
+
 void P_InitThinkers(void);
 void P_InvalidateThinkersWithoutInit(void);
 void P_AddThinker(const thinklistnum_t n, thinker_t *thinker);
@@ -422,6 +425,7 @@ extern mprecipsecnode_t *precipsector_list;
 
 void P_UnsetThingPosition(mobj_t *thing);
 void P_SetThingPosition(mobj_t *thing);
+void P_SetThingRadius(mobj_t *thing, fixed_t radius);
 void P_SetUnderlayPosition(mobj_t *thing);
 
 struct TryMoveResult_t
@@ -455,6 +459,9 @@ boolean P_CheckSight(mobj_t *t1, mobj_t *t2);
 boolean P_TraceBlockingLines(mobj_t *t1, mobj_t *t2);
 boolean P_TraceBotTraversal(mobj_t *t1, mobj_t *t2);
 boolean P_TraceWaypointTraversal(mobj_t *t1, mobj_t *t2);
+void P_ClearSightCache(void);
+void P_InvalidateSightCache(void);
+void P_InvalidateSectorSight(sector_t *sector);
 void P_CheckHoopPosition(mobj_t *hoopthing, fixed_t x, fixed_t y, fixed_t z, fixed_t radius);
 
 boolean P_CheckSector(sector_t *sector, boolean crunch);
@@ -491,6 +498,7 @@ extern INT32 bmapheight; // in mapblocks
 extern fixed_t bmaporgx;
 extern fixed_t bmaporgy; // origin of block map
 extern mobj_t **blocklinks; // for thing chains
+extern blockcell_t *blockcells; // for thing arrays, mirrors blocklinks
 extern precipmobj_t **precipblocklinks; // special blockmap for precip rendering
 
 extern struct minimapinfo
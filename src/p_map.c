@@ -2296,7 +2296,7 @@ boolean P_CheckPosition(mobj_t *thing, fixed_t x, fixed_t y, TryMoveResult_t *re
 		{
 			for (by = yl; by <= yh; by++)
 			{
-				if (!P_BlockThingsIterator(bx, by, PIT_CheckThing))
+				if (!P_BlockThingsIteratorBox(bx, by, g_tm.bbox, PIT_CheckThing))
 				{
 					blockval = false;
 				}
@@ -2971,7 +2971,7 @@ boolean P_CheckMove(mobj_t *thing, fixed_t x, fixed_t y, boolean allowdropoff, T
 	boolean moveok = false;
 	mobj_t *hack = P_SpawnMobjFromMobj(thing, 0, 0, 0, MT_RAY);
 
-	hack->radius = thing->radius;
+	P_SetThingRadius(hack, thing->radius);
 	hack->height = thing->height;
 
 	moveok = increment_move(hack, x, y, allowdropoff, NULL, result);
@@ -4386,6 +4386,9 @@ boolean P_CheckSector(sector_t *sector, boolean crunch)
 	nofit = false;
 	crushchange = crunch;
 
+	// Sector planes are about to move, old sight results through it are stale.
+	P_InvalidateSectorSight(sector);
+
 	// killough 4/4/98: scan list front-to-back until empty or exhausted,
 	// restarting from beginning after each thing is processed. Avoids
 	// crashes, and is sure to examine all things in the sector, and only
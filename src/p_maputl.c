@@ -1028,6 +1028,93 @@ void P_LineOpening(line_t *linedef, mobj_t *mobj, opening_t *open)
 // THING POSITION SETTING
 //
 
+//
+// P_SetBlockEntryBox
+// Copies a thing's current bounding box into its blockcells entry.
+//
+static void P_SetBlockEntryBox(blockentry_t *entry, mobj_t *thing)
+{
+	entry->bbox[BOXTOP] = thing->y + thing->radius;
+	entry->bbox[BOXBOTTOM] = thing->y - thing->radius;
+	entry->bbox[BOXRIGHT] = thing->x + thing->radius;
+	entry->bbox[BOXLEFT] = thing->x - thing->radius;
+}
+
+//
+// P_AddToBlockCell
+// Appends a thing to the end of a cell and remembers where it went.
+//
+static void P_AddToBlockCell(mobj_t *thing, INT32 cellnum)
+{
+	blockcell_t *cell = &blockcells[cellnum];
+	blockentry_t *entry;
+
+	if (cell->count >= cell->capacity)
+	{
+		cell->capacity = cell->capacity ? cell->capacity * 2 : 8;
+		cell->entries = Z_Realloc(cell->entries, cell->capacity * sizeof(*cell->entries), PU_LEVEL, NULL);
+	}
+
+	entry = &cell->entries[cell->count];
+	entry->mobj = thing;
+	entry->visit = 0;
+	P_SetBlockEntryBox(entry, thing);
+
+	thing->blockcell = cellnum;
+	thing->blockentry = (INT32)cell->count;
+	cell->count++;
+}
+
+//
+// P_RemoveFromBlockCell
+// Removes a thing from its cell by moving the cell's
+// last entry into its slot.
+//
+static void P_RemoveFromBlockCell(mobj_t *thing)
+{
+	blockcell_t *cell;
+	INT32 i;
+
+	if (thing->blockcell < 0)
+		return;
+
+	cell = &blockcells[thing->blockcell];
+	i = thing->blockentry;
+
+	I_Assert(i >= 0 && i < (INT32)cell->count);
+	I_Assert(cell->entries[i].mobj == thing);
+
+	cell->count--;
+
+	if (i != (INT32)cell->count)
+	{
+		cell->entries[i] = cell->entries[cell->count];
+		cell->entries[i].mobj->blockentry = i;
+	}
+
+	thing->blockcell = -1;
+	thing->blockentry = -1;
+}
+
+//
+// P_SetThingRadius
+// Changes a thing's radius and refreshes its blockcells entry.
+//
+// The boxes in blockcells are only ever written when a thing is
+// linked and through here, so a linked thing's x and y must only
+// change between P_UnsetThingPosition and P_SetThingPosition, and
+// its radius only through this function.
+//
+void P_SetThingRadius(mobj_t *thing, fixed_t radius)
+{
+	thing->radius = radius;
+
+	if ((thing->flags & MF_NOBLOCKMAP) || thing->bprev == NULL || thing->blockcell < 0)
+		return;
+
+	P_SetBlockEntryBox(&blockcells[thing->blockcell].entries[thing->blockentry], thing);
+}
+
 //
 // P_UnsetThingPosition
 // Unlinks a thing from block map and sectors.
@@ -1087,6 +1174,9 @@ void P_UnsetThingPosition(mobj_t *thing)
 		mobj_t *bnext, **bprev = thing->bprev;
 		if (bprev && (*bprev = bnext = thing->bnext) != NULL)  // unlink from block map
 			bnext->bprev = bprev;
+
+		if (bprev)
+			P_RemoveFromBlockCell(thing);
 	}
 }
 
@@ -1124,10 +1214,14 @@ static void P_LinkToBlockMap(mobj_t *thing, mobj_t **bmap)
 
 		thing->bprev = link;
 		*link = thing;
+
+		P_AddToBlockCell(thing, (blocky * bmapwidth) + blockx);
 	}
 	else // thing is off the map
 	{
 		thing->bnext = NULL, thing->bprev = NULL;
+		thing->blockcell = -1;
+		thing->blockentry = -1;
 	}
 }
 
@@ -1383,6 +1477,71 @@ boolean P_BlockThingsIterator(INT32 x, INT32 y, BlockItReturn_t (*func)(mobj_t *
 	return true;
 }
 
+//
+// P_BlockThingsIteratorBox
+// Same as P_BlockThingsIterator, but skips things whose bounding box
+// does not overlap bbox, without dereferencing them. Only use this
+// with functions that ignore such things anyway, and that do not
+// depend on the order things were linked in.
+//
+boolean P_BlockThingsIteratorBox(INT32 x, INT32 y, const fixed_t *bbox, BlockItReturn_t (*func)(mobj_t *))
+{
+	static UINT32 visitcount = 0;
+	blockcell_t *cell;
+	UINT32 visit;
+	INT32 i;
+
+	if (x < 0 || y < 0 || x >= bmapwidth || y >= bmapheight)
+		return true;
+
+	cell = &blockcells[y*bmapwidth + x];
+
+	if (++visitcount == 0)
+		visitcount = 1;
+	visit = visitcount;
+
+	// Walk backwards so that things func links into this cell,
+	// which are appended, are not visited, same as the chain.
+	for (i = (INT32)cell->count - 1; i >= 0; i--)
+	{
+		blockentry_t *entry;
+		BlockItReturn_t ret;
+
+		// func may have removed things, shrinking the cell.
+		if (i >= (INT32)cell->count)
+		{
+			i = (INT32)cell->count;
+			continue;
+		}
+
+		entry = &cell->entries[i];
+
+		// A removal moves the last entry down into the gap,
+		// which may be one that was already visited.
+		if (entry->visit == visit)
+			continue;
+
+		if (entry->bbox[BOXLEFT] >= bbox[BOXRIGHT]
+			|| entry->bbox[BOXRIGHT] <= bbox[BOXLEFT]
+			|| entry->bbox[BOXBOTTOM] >= bbox[BOXTOP]
+			|| entry->bbox[BOXTOP] <= bbox[BOXBOTTOM])
+		{
+			continue;
+		}
+
+		entry->visit = visit;
+		ret = func(entry->mobj);
+
+		if (ret == BMIT_ABORT)
+			return false; // failure
+
+		if (ret == BMIT_STOP)
+			return true; // success
+	}
+
+	return true;
+}
+
 //
 // INTERCEPT ROUTINES
 //
@@ -87,8 +87,26 @@ typedef enum
 	BMIT_ABORT // End blockmap search with failure
 } BlockItReturn_t;
 
+// Compact copy of a blocklinks chain, in no particular order,
+// with each thing's bounding box from when it was last linked
+// or resized. Lets iterators reject things that are out of
+// range without dereferencing them.
+struct blockentry_t
+{
+	mobj_t *mobj;
+	fixed_t bbox[4];
+	UINT32 visit; // Last P_BlockThingsIteratorBox pass to call func on this
+};
+
+struct blockcell_t
+{
+	blockentry_t *entries;
+	UINT32 count, capacity;
+};
+
 boolean P_BlockLinesIterator(INT32 x, INT32 y, BlockItReturn_t(*func)(line_t *));
 boolean P_BlockThingsIterator(INT32 x, INT32 y, BlockItReturn_t(*func)(mobj_t *));
+boolean P_BlockThingsIteratorBox(INT32 x, INT32 y, const fixed_t *bbox, BlockItReturn_t(*func)(mobj_t *));
 
 #define PT_ADDLINES		(1)
 #define PT_ADDTHINGS	(2)
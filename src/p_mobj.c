@@ -66,6 +66,50 @@ mobj_t *trackercap = NULL;
 
 mobj_t *mobjcache = NULL;
 
+//
+// Mobj slabs
+//
+// Mobjs are carved out of large contiguous PU_LEVEL blocks instead of
+// being allocated one at a time. New thinkers go at the end of the
+// list, so objects spawned together think one after another and now
+// also sit next to each other in memory; P_RunThinkers walks them in
+// mostly ascending address order instead of hopping around the zone.
+// Removed mobjs still go back through mobjcache, since a slab can
+// only be freed as a whole (with the rest of PU_LEVEL).
+//
+#define MOBJSLABSIZE (256)
+
+static mobj_t *mobjslab = NULL;
+static size_t mobjslabused = MOBJSLABSIZE;
+
+void P_ClearMobjSlabs(void)
+{
+	mobjcache = NULL;
+	mobjslab = NULL;
+	mobjslabused = MOBJSLABSIZE;
+}
+
+mobj_t *P_AllocMobj(void)
+{
+	mobj_t *mobj;
+
+	if (mobjcache != NULL)
+	{
+		mobj = mobjcache;
+		mobjcache = mobjcache->hnext;
+		memset(mobj, 0, sizeof(*mobj));
+		return mobj;
+	}
+
+	if (mobjslabused >= MOBJSLABSIZE)
+	{
+		mobjslab = Z_Calloc(MOBJSLABSIZE * sizeof(*mobjslab), PU_LEVEL, NULL);
+		mobjslabused = 0;
+	}
+
+	return &mobjslab[mobjslabused++];
+}
+
 void P_InitCachedActions(void)
 {
 	actioncachehead.prev = actioncachehead.next = &actioncachehead;
@@ -4867,9 +4911,11 @@ void P_SpawnParaloop(fixed_t x, fixed_t y, fixed_t z, fixed_t radius, INT32 numb
 
 		if (spawncenter)
 		{
+			P_UnsetThingPosition(mobj);
 			mobj->x = x;
 			mobj->y = y;
 			mobj->z = z;
+			P_SetThingPosition(mobj);
 		}
 
 		if (mobj->fuse <= 1)
@@ -4902,7 +4948,7 @@ void P_SetScale(mobj_t *mobj, fixed_t newscale)
 
 	mobj->scale = newscale;
 
-	mobj->radius = FixedMul(FixedDiv(mobj->radius, oldscale), newscale);
+	P_SetThingRadius(mobj, FixedMul(FixedDiv(mobj->radius, oldscale), newscale));
 	mobj->height = FixedMul(FixedDiv(mobj->height, oldscale), newscale);
 
 	player = mobj->player;
@@ -5766,6 +5812,8 @@ static boolean P_ParticleGenSceneryThink(mobj_t *mobj)
 
 static void P_MobjSceneryThink(mobj_t *mobj)
 {
+	LUA_QueueMobjThinkFrame(mobj);
+
 	if (LUA_HookMobj(mobj, MOBJ_HOOK(MobjThinker)))
 		return;
 	if (P_MobjWasRemoved(mobj))
@@ -8701,7 +8749,7 @@ static boolean P_MobjRegularThink(mobj_t *mobj)
 			mobj->color = mobj->target->color;
 			mobj->colorized = true;
 
-			mobj->radius = 24*mobj->target->scale;
+			P_SetThingRadius(mobj, 24*mobj->target->scale);
 			mobj->height = 2*mobj->radius;
 
 			if (mobj->target->player->karmadelay > 0)
@@ -10257,6 +10305,8 @@ void P_MobjThinker(mobj_t *mobj)
 		return;
 	}
 
+	LUA_QueueMobjThinkFrame(mobj);
+
 	// Check for a Lua thinker first
 	if (!mobj->player)
 	{
@@ -10750,16 +10800,7 @@ mobj_t *P_SpawnMobj(fixed_t x, fixed_t y, fixed_t z, mobjtype_t type)
 		type = MT_RAY;
 	}
 
-	if (mobjcache != NULL)
-	{
-		mobj = mobjcache;
-		mobjcache = mobjcache->hnext;
-		memset(mobj, 0, sizeof(*mobj));
-	}
-	else
-	{
-		mobj = Z_Calloc(sizeof (*mobj), PU_LEVEL, NULL);
-	}
+	mobj = P_AllocMobj();
 
 	// this is officially a mobj, declared as soon as possible.
 	mobj->thinker.function.acp1 = (actionf_p1)P_MobjThinker;
@@ -13286,7 +13327,7 @@ static boolean P_SetupSpawnedMapThing(mapthing_t *mthing, mobj_t *mobj)
 		if (mthing->thing_args[3])
 			mobj->flags2 |= MF2_AMBUSH;
 
-		mobj->radius = abs(mthing->thing_args[2]) << FRACBITS;
+		P_SetThingRadius(mobj, abs(mthing->thing_args[2]) << FRACBITS);
 		// FALLTHRU
 	case MT_AXISTRANSFER:
 	case MT_AXISTRANSFERLINE:
@@ -13386,11 +13427,11 @@ static boolean P_SetupSpawnedMapThing(mapthing_t *mthing, mobj_t *mobj)
 		mtag_t tag = mthing->tid;
 
 		if (mthing->thing_args[1] > 0)
-			mobj->radius = (mthing->thing_args[1]) * FRACUNIT;
+			P_SetThingRadius(mobj, (mthing->thing_args[1]) * FRACUNIT);
 		else if (mobjscale > 0)
-			mobj->radius = mobjscale;
+			P_SetThingRadius(mobj, mobjscale);
 		else
-			mobj->radius = DEFAULT_WAYPOINT_RADIUS * mapobjectscale;
+			P_SetThingRadius(mobj, DEFAULT_WAYPOINT_RADIUS * mapobjectscale);
 
 		// Use threshold to store the next waypoint ID
 		// movecount is being used for the current waypoint ID
@@ -13456,11 +13497,11 @@ static boolean P_SetupSpawnedMapThing(mapthing_t *mthing, mobj_t *mobj)
 		// Change size
 		if (mthing->thing_args[0] > 0)
 		{
-			mobj->radius = mthing->thing_args[0] * FRACUNIT;
+			P_SetThingRadius(mobj, mthing->thing_args[0] * FRACUNIT);
 		}
 		else
 		{
-			mobj->radius = 32 * mapobjectscale;
+			P_SetThingRadius(mobj, 32 * mapobjectscale);
 		}
 
 		// Steer away instead of towards
@@ -14494,9 +14535,11 @@ boolean P_CheckMissileSpawn(mobj_t *th)
 	// move a little forward so an angle can be computed if it immediately explodes
 	if (!(th->flags & MF_GRENADEBOUNCE)) // hack: bad! should be a flag.
 	{
+		P_UnsetThingPosition(th);
 		th->x += th->momx>>1;
 		th->y += th->momy>>1;
 		th->z += th->momz>>1;
+		P_SetThingPosition(th);
 	}
 
 	if (!P_TryMove(th, th->x, th->y, true, NULL))
@@ -14626,9 +14669,14 @@ mobj_t *P_SpawnAlteredDirectionMissile(mobj_t *source, mobjtype_t type, fixed_t
 	if (th->flags & MF_MISSILE)
 	{
 		dist = P_CheckMissileSpawn(th);
-		th->x -= th->momx>>1;
-		th->y -= th->momy>>1;
-		th->z -= th->momz>>1;
+		if (!P_MobjWasRemoved(th))
+		{
+			P_UnsetThingPosition(th);
+			th->x -= th->momx>>1;
+			th->y -= th->momy>>1;
+			th->z -= th->momz>>1;
+			P_SetThingPosition(th);
+		}
 	}
 	else
 		dist = 1;
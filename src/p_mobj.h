@@ -275,6 +275,20 @@ typedef enum {
 	PCF_FLIP		= 1<<4,		// Spawning from floor, moving upwards.
 } precipflag_t;
 
+// Interpolated position of a mobj for rendering, see R_InterpolateMobjState.
+struct interpmobjstate_t {
+	fixed_t x;
+	fixed_t y;
+	fixed_t z;
+	subsector_t *subsector;
+	angle_t angle;
+	fixed_t scale;
+	fixed_t spritexscale;
+	fixed_t spriteyscale;
+	fixed_t spritexoffset;
+	fixed_t spriteyoffset;
+};
+
 // Map Object definition.
 struct mobj_t
 {
@@ -412,6 +426,9 @@ struct mobj_t
 	pslope_t *standingslope; // The slope that the object is standing on (shouldn't need synced in savegames, right?)
 
 	boolean resetinterp; // if true, some fields should not be interpolated (see R_InterpolateMobjState implementation)
+	interpmobjstate_t interp; // last result of R_InterpolateMobjState,
+	UINT32 interpgeneration; // valid for this tic
+	fixed_t interpfrac; // and this frac
 	boolean colorized; // Whether the mobj uses the rainbow colormap
 	boolean mirrored; // The object's rotations will be mirrored left to right, e.g., see frame AL from the right and AR from the left
 
@@ -449,6 +466,8 @@ struct mobj_t
 	mobj_t *owner;
 
 	INT32 po_movecount; // Polyobject carrying (NOT savegame, NOT Lua)
+	INT32 blockcell; // Index into blockcells while linked, otherwise -1 (NOT savegame, NOT Lua)
+	INT32 blockentry; // Index into that cell's entries (NOT savegame, NOT Lua)
 
 	// WARNING: New fields must be added separately to savegame and Lua.
 };
@@ -650,6 +650,13 @@ static void Polyobj_removeFromSubsec(polyobj_t *po)
 	}
 }
 
+// Throws out sight results through the subsector a polyobject is attached to.
+static void Polyobj_invalidateSight(polyobj_t *po)
+{
+	if (po->attached)
+		P_InvalidateSectorSight(R_PointInSubsector(po->centerPt.x, po->centerPt.y)->sector);
+}
+
 // Blockmap Functions
 
 // Retrieves a polymaplink object from the free list or creates a new one.
@@ -1023,10 +1030,12 @@ boolean Polyobj_moveXY(polyobj_t *po, fixed_t x, fixed_t y, boolean checkmobjs)
 
 		if (checkmobjs)
 			Polyobj_carryThings(po, x, y);
+		Polyobj_invalidateSight(po);
 		Polyobj_removeFromBlockmap(po); // unlink it from the blockmap
 		Polyobj_removeFromSubsec(po);   // unlink it from its subsector
 		Polyobj_linkToBlockmap(po);     // relink to blockmap
 		Polyobj_attachToSubsec(po);     // relink to subsector
+		Polyobj_invalidateSight(po);
 	}
 
 	return !(hitflags & 2);
@@ -1228,10 +1237,12 @@ boolean Polyobj_rotate(polyobj_t *po, angle_t delta, boolean turnplayers, boolea
 		// update polyobject's angle
 		po->angle += delta;
 
+		Polyobj_invalidateSight(po);
 		Polyobj_removeFromBlockmap(po); // unlink it from the blockmap
 		Polyobj_removeFromSubsec(po);   // remove from subsector
 		Polyobj_linkToBlockmap(po);     // relink to blockmap
 		Polyobj_attachToSubsec(po);     // relink to subsector
+		Polyobj_invalidateSight(po);
 	}
 
 	return !(hitflags & 2);
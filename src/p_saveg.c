@@ -4446,13 +4446,13 @@ static thinker_t* LoadMobjThinker(savebuffer_t *save, actionf_p1 thinker)
 			return NULL;
 		}
 
-		mobj = Z_Calloc(sizeof (*mobj), PU_LEVEL, NULL);
+		mobj = P_AllocMobj();
 
 		mobj->spawnpoint = &mapthings[spawnpointnum];
 		mapthings[spawnpointnum].mobj = mobj;
 	}
 	else
-		mobj = Z_Calloc(sizeof (*mobj), PU_LEVEL, NULL);
+		mobj = P_AllocMobj();
 
 	// declare this as a valid mobj as soon as possible.
 	mobj->thinker.function.acp1 = thinker;
@@ -5454,9 +5454,11 @@ static void P_NetUnArchiveThinkers(savebuffer_t *save)
 				P_RemoveSavegameMobj((mobj_t *)currentthinker); // item isn't saved, don't remove it
 			else
 			{
-				(next->prev = currentthinker->prev)->next = next;
 				R_DestroyLevelInterpolators(currentthinker);
-				Z_Free(currentthinker);
+
+				// Removed mobjs that were still referenced live in a
+				// mobj slab, so they go back to the cache instead.
+				P_UnlinkThinker(currentthinker);
 			}
 		}
 	}
@@ -7091,6 +7093,9 @@ boolean P_LoadNetGame(savebuffer_t *save, boolean reloading)
 		P_NetUnArchiveTubeWaypoints(save);
 		P_NetUnArchiveWaypoints(save);
 		P_RelinkPointers();
+
+		// Mobjs were reallocated and the world was replaced
+		P_ClearSightCache();
 	}
 
 	ACS_UnArchive(save);
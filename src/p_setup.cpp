@@ -50,6 +50,7 @@
 #include "w_wad.h"
 #include "z_zone.h"
 #include "r_splats.h"
+#include "r_particle.h" // R_ClearParticles
 
 #include "hu_stuff.h"
 #include "console.h"
@@ -185,6 +186,7 @@ INT32 *blockmaplump; // Big blockmap
 fixed_t bmaporgx, bmaporgy;
 // for thing chains
 mobj_t **blocklinks;
+blockcell_t *blockcells;
 precipmobj_t **precipblocklinks;
 
 // REJECT
@@ -4162,6 +4164,9 @@ static boolean P_LoadBlockMap(UINT8 *data, size_t count)
 	blocklinks = static_cast<mobj_t**>(Z_Calloc(count, PU_LEVEL, NULL));
 	blockmap = blockmaplump+4;
 
+	count = sizeof (*blockcells) * bmapwidth * bmapheight;
+	blockcells = static_cast<blockcell_t*>(Z_Calloc(count, PU_LEVEL, NULL));
+
 	// haleyjd 2/22/06: setup polyobject blockmap
 	count = sizeof(*polyblocklinks) * bmapwidth * bmapheight;
 	polyblocklinks = static_cast<polymaplink_t**>(Z_Calloc(count, PU_LEVEL, NULL));
@@ -4419,6 +4424,9 @@ static void P_CreateBlockMap(void)
 		blocklinks = static_cast<mobj_t**>(Z_Calloc(count, PU_LEVEL, NULL));
 		blockmap = blockmaplump + 4;
 
+		count = sizeof (*blockcells) * bmapwidth * bmapheight;
+		blockcells = static_cast<blockcell_t*>(Z_Calloc(count, PU_LEVEL, NULL));
+
 		// haleyjd 2/22/06: setup polyobject blockmap
 		count = sizeof(*polyblocklinks) * bmapwidth * bmapheight;
 		polyblocklinks = static_cast<polymaplink_t**>(Z_Calloc(count, PU_LEVEL, NULL));
@@ -8604,15 +8612,22 @@ boolean P_LoadLevel(boolean fromnetsave, boolean reloadinggamestate)
 #endif
 
 	G_FreeGhosts(); // ghosts are allocated with PU_LEVEL
+#ifdef ROTSPRITE
+	Patch_FlushRotationQueue();
+#endif
 	Patch_FreeTag(PU_PATCH_LOWPRIORITY);
 	Patch_FreeTag(PU_PATCH_ROTATED);
 	Z_FreeTags(PU_LEVEL, PU_PURGELEVEL - 1);
-	mobjcache = NULL;
+	R_TrimTextureCache();
+	R_TrimLightTables();
+	P_ClearMobjSlabs();
+	R_ClearParticles();
 
 	R_InitializeLevelInterpolators();
 
 	P_InitThinkers();
 	P_InitTIDHash();
+	P_ClearSightCache();
 	R_InitMobjInterpolators();
 	P_InitCachedActions();
 
@@ -8659,6 +8674,9 @@ boolean P_LoadLevel(boolean fromnetsave, boolean reloadinggamestate)
 	}
 	CON_SetupBackColormap();
 
+	// Light tables made while loading the map are generated together
+	R_BeginLightTableBatch();
+
 	// SRB2 determines the sky texture to be used depending on the map header.
 	P_SetupLevelSky(mapheaderinfo[gamemap-1]->skytexture, true);
 
@@ -8675,6 +8693,7 @@ boolean P_LoadLevel(boolean fromnetsave, boolean reloadinggamestate)
 
 	if (!P_LoadMapFromFile())
 	{
+		R_FinishLightTableBatch();
 		TracyCZoneEnd(__zone);
 		return false;
 	}
@@ -8771,6 +8790,8 @@ boolean P_LoadLevel(boolean fromnetsave, boolean reloadinggamestate)
 	if (rendermode != render_none && !titlemapinaction && !reloadinggamestate)
 		F_WipeColorFill(levelfadecol);
 
+	R_FinishLightTableBatch();
+
 	if (precache || dedicated)
 		R_PrecacheLevel();
 
@@ -8840,6 +8861,11 @@ boolean P_LoadLevel(boolean fromnetsave, boolean reloadinggamestate)
 
 		// Apply FOV override.
 		R_CheckFOV();
+
+#ifdef ROTSPRITE
+		// Rotate everyone's karts in the background
+		Patch_QueueSkinRotations();
+#endif
 	}
 
 	TracyCZoneEnd(__zone);
@@ -9420,6 +9446,9 @@ UINT16 P_PartialAddWadFile(const char *wadfilename)
 	//
 	// search for sprite replacements
 	//
+#ifdef ROTSPRITE
+	Patch_FlushRotationQueue();
+#endif
 	Patch_FreeTag(PU_SPRITE);
 	Patch_FreeTag(PU_PATCH_ROTATED);
 	R_AddSpriteDefs(wadnum);
@@ -39,6 +39,7 @@ typedef struct
 	mobj_t *t1, *t2;
 	boolean alreadyHates;				// For bot traversal, for if the bot is already in a sector it doesn't want to be
 	UINT8 traversed;
+	struct sightsectors_s *touched;		// Sectors the result depends on, for the cache
 } los_t;
 
 typedef boolean (*los_init_t)(mobj_t *, mobj_t *, register los_t *);
@@ -54,6 +55,88 @@ typedef struct
 
 static INT32 sightcounts[2];
 
+//
+// Line of sight result cache.
+//
+// Bots and waypoint searches ask the same questions many times per tic
+// (the same mobj pairs, from the same positions). Results are memoized in
+// a small direct-mapped table. Entries only live for the tic they were made
+// in.
+//
+// Each entry remembers the sectors its trace looked at. Moving planes,
+// FOFs and polyobjects only bump the generation of the sectors involved
+// (P_InvalidateSectorSight), so a door opening elsewhere leaves the entry
+// alone. Changes that can't be pinned to a sector (dynamic slopes, line
+// specials, Lua slopes) still throw everything out (P_InvalidateSightCache).
+//
+// This runs in netgames and replays, so the slot is picked from synced
+// positions only, never from pointers, and a hit replays what the trace
+// would have left behind.
+//
+
+typedef enum
+{
+	LOS_CHECKSIGHT,
+	LOS_BLOCKINGLINES,
+	LOS_BOTTRAVERSAL,
+	LOS_WAYPOINTTRAVERSAL,
+} loskind_t;
+
+#define SIGHTCACHE_SIZE (512)
+#define SIGHTCACHE_SECTORS (16)
+
+typedef struct sightsectors_s
+{
+	sector_t *list[SIGHTCACHE_SECTORS];
+	UINT8 count;
+	boolean overflow; // Touched more than fit, only valid while no sector changes
+} sightsectors_t;
+
+// Player state that traversal reads, on top of t1's position.
+enum
+{
+	SIGHTPLAYER_TRIPWIRE	= 1,	// Trip wire lines and midtextures
+	SIGHTPLAYER_SPECTATOR	= 1<<1,	// Blocking lines
+	SIGHTPLAYER_CARRY		= 1<<2,	// Water running
+	SIGHTPLAYER_EBRAKE		= 1<<3,	// Water running
+	SIGHTPLAYER_WATERSKIP	= 1<<4,	// Step up
+	SIGHTPLAYER_TAKECUT		= 1<<5,	// Bot offroad hatred
+};
+
+typedef struct
+{
+	mobj_t *t1, *t2;
+	fixed_t x1, y1, z1, h1, s1, r1;
+	fixed_t x2, y2, z2, h2, s2;
+	UINT32 flags1;
+	UINT16 eflags1, eflags2;
+	UINT8 kind;
+	boolean result;
+	tic_t time;
+	UINT32 generation;
+
+	// Step up and water running, for traversal
+	fixed_t momx1, momy1, momz1;
+	fixed_t floorz1, ceilingz1;
+	ffloor_t *floorrover1;
+	pslope_t *slope1;
+	UINT8 playerbits1;
+
+	// Sectors the trace looked at, and their generations
+	UINT32 sectorepoch;
+	sightsectors_t sectors;
+	UINT32 sectorgens[SIGHTCACHE_SECTORS];
+
+	// Side effects of the trace
+	UINT8 sightcounted, validcounted;
+	boolean tmset;
+	fixed_t tmx, tmy;
+} sightcache_t;
+
+static sightcache_t sightcache[SIGHTCACHE_SIZE];
+static UINT32 sightcachegeneration = 1;
+static UINT32 sightsectorepoch = 1; // Bumped with any sector's generation
+
 #ifdef DEVELOP
 extern consvar_t cv_debugtraversemax;
 #undef TRAVERSE_MAX
@@ -83,6 +166,38 @@ static INT32 P_DivlineCrossed(fixed_t x1, fixed_t y1, fixed_t x2, fixed_t y2, co
 	return (P_DivlineSide(x1, y1, node) == P_DivlineSide(x2, y2, node));
 }
 
+//
+// P_TouchSightSector
+//
+// Notes that the trace's result depends on this sector.
+//
+static void P_TouchSightSector(register los_t *los, sector_t *sector)
+{
+	sightsectors_t *touched = los->touched;
+	UINT8 i;
+
+	if (touched == NULL || sector == NULL || touched->overflow == true)
+	{
+		return;
+	}
+
+	for (i = 0; i < touched->count; i++)
+	{
+		if (touched->list[i] == sector)
+		{
+			return;
+		}
+	}
+
+	if (touched->count >= SIGHTCACHE_SECTORS)
+	{
+		touched->overflow = true;
+		return;
+	}
+
+	touched->list[touched->count++] = sector;
+}
+
 static boolean P_IsVisiblePolyObj(polyobj_t *po, divline_t *divl, register los_t *los)
 {
 	sector_t *polysec = po->lines[0]->backsector;
@@ -163,6 +278,9 @@ static boolean P_CrossSubsecPolyObj(polyobj_t *po, register los_t *los, register
 		if (P_DivlineCrossed(los->strace.x, los->strace.y, los->t2x, los->t2y, &divl))
 			continue;
 
+		P_TouchSightSector(los, line->frontsector);
+		P_TouchSightSector(los, line->backsector);
+
 		if (funcs->validatePolyobj(po, &divl, los) == false)
 		{
 			return false;
@@ -484,6 +602,9 @@ static boolean P_CrossSubsector(size_t num, register los_t *los, register los_fu
 	// haleyjd 02/23/06: this assignment should be after the above check
 	seg = segs + subsectors[num].firstline;
 
+	// Also covers polyobjects moving into this subsector.
+	P_TouchSightSector(los, subsectors[num].sector);
+
 	// haleyjd 02/23/06: check polyobject lines
 	if (funcs->validatePolyobj != NULL)
 	{
@@ -540,6 +661,9 @@ static boolean P_CrossSubsector(size_t num, register los_t *los, register los_fu
 		if (P_DivlineCrossed(los->strace.x, los->strace.y, los->t2x, los->t2y, &divl))
 			continue;
 
+		P_TouchSightSector(los, line->frontsector);
+		P_TouchSightSector(los, line->backsector);
+
 		if (funcs->validate(seg, &divl, los) == false)
 		{
 			return false;
@@ -681,7 +805,188 @@ static boolean P_InitTraceBotTraversal(mobj_t *t1, mobj_t *t2, register los_t *l
 	return true;
 }
 
-static boolean P_CompareMobjsAcrossLines(mobj_t *t1, mobj_t *t2, register los_funcs_t *funcs)
+//
+// P_ClearSightCache
+//
+// Throws out every cached line of sight result.
+// Done on level load, since mobj pointers get recycled.
+//
+void P_ClearSightCache(void)
+{
+	memset(sightcache, 0, sizeof(sightcache));
+	sightcachegeneration = 1;
+	sightsectorepoch = 1;
+}
+
+//
+// P_InvalidateSightCache
+//
+// Call when level geometry changes in a way that
+// can't be pinned to a sector (slopes, line specials).
+//
+void P_InvalidateSightCache(void)
+{
+	sightcachegeneration++;
+
+	if (sightcachegeneration == 0)
+	{
+		// Wrapped around, make sure nothing stale matches.
+		P_ClearSightCache();
+	}
+}
+
+//
+// P_InvalidateSectorSight
+//
+// Call when a sector's planes or FOFs move, or a polyobject
+// enters or leaves it. If it controls FOFs, the sectors
+// they are in are invalidated too.
+//
+void P_InvalidateSectorSight(sector_t *sector)
+{
+	size_t i;
+
+	sightsectorepoch++;
+	sector->sightgen++;
+
+	for (i = 0; i < sector->numattached; i++)
+	{
+		sectors[sector->attached[i]].sightgen++;
+	}
+}
+
+static UINT8 P_SightCachePlayerBits(loskind_t kind, const mobj_t *t1)
+{
+	const player_t *player = t1->player;
+	UINT8 bits = 0;
+
+	if (player == NULL || kind == LOS_CHECKSIGHT)
+	{
+		return 0;
+	}
+
+	if (K_TripwirePass(player) == true)
+		bits |= SIGHTPLAYER_TRIPWIRE;
+	if (player->spectator == true)
+		bits |= SIGHTPLAYER_SPECTATOR;
+	if (player->carry != CR_NONE)
+		bits |= SIGHTPLAYER_CARRY;
+	if (K_PlayerEBrake(player) == true)
+		bits |= SIGHTPLAYER_EBRAKE;
+	if (t1->waterskip > 0)
+		bits |= SIGHTPLAYER_WATERSKIP;
+	if (kind == LOS_BOTTRAVERSAL && K_BotCanTakeCut(player) == true)
+		bits |= SIGHTPLAYER_TAKECUT;
+
+	return bits;
+}
+
+static sightcache_t *P_GetSightCacheSlot(loskind_t kind, const mobj_t *t1, const mobj_t *t2)
+{
+	UINT32 hash;
+
+	hash = (UINT32)(t1->x >> FRACBITS) * 73856093u;
+	hash ^= (UINT32)(t1->y >> FRACBITS) * 19349663u;
+	hash ^= (UINT32)(t1->z >> FRACBITS) * 83492791u;
+	hash ^= (UINT32)(t2->x >> FRACBITS) * 2654435761u;
+	hash ^= (UINT32)(t2->y >> FRACBITS) * 40503u;
+	hash = hash * 4 + kind;
+
+	return &sightcache[hash % SIGHTCACHE_SIZE];
+}
+
+static boolean P_SightCacheMatches(const sightcache_t *entry, loskind_t kind, const mobj_t *t1, const mobj_t *t2)
+{
+	UINT8 i;
+
+	if (!(entry->generation == sightcachegeneration
+		&& entry->time == leveltime
+		&& entry->kind == kind
+		&& entry->t1 == t1 && entry->t2 == t2
+		&& entry->x1 == t1->x && entry->y1 == t1->y && entry->z1 == t1->z
+		&& entry->h1 == t1->height && entry->s1 == t1->scale && entry->r1 == t1->radius
+		&& entry->flags1 == t1->flags && entry->eflags1 == t1->eflags
+		&& entry->x2 == t2->x && entry->y2 == t2->y && entry->z2 == t2->z
+		&& entry->h2 == t2->height && entry->s2 == t2->scale
+		&& entry->eflags2 == t2->eflags))
+	{
+		return false;
+	}
+
+	if (kind != LOS_CHECKSIGHT
+		&& !(entry->momx1 == t1->momx && entry->momy1 == t1->momy && entry->momz1 == t1->momz
+		&& entry->floorz1 == t1->floorz && entry->ceilingz1 == t1->ceilingz
+		&& entry->floorrover1 == t1->floorrover && entry->slope1 == t1->standingslope
+		&& entry->playerbits1 == P_SightCachePlayerBits(kind, t1)))
+	{
+		return false;
+	}
+
+	if (entry->sectorepoch == sightsectorepoch)
+	{
+		// No sector has changed at all.
+		return true;
+	}
+
+	if (entry->sectors.overflow == true)
+	{
+		return false;
+	}
+
+	for (i = 0; i < entry->sectors.count; i++)
+	{
+		if (entry->sectors.list[i]->sightgen != entry->sectorgens[i])
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static void P_StoreSightCache(sightcache_t *entry, loskind_t kind, mobj_t *t1, mobj_t *t2, boolean result)
+{
+	UINT8 i;
+
+	entry->t1 = t1;
+	entry->t2 = t2;
+	entry->x1 = t1->x;
+	entry->y1 = t1->y;
+	entry->z1 = t1->z;
+	entry->h1 = t1->height;
+	entry->s1 = t1->scale;
+	entry->r1 = t1->radius;
+	entry->flags1 = t1->flags;
+	entry->eflags1 = t1->eflags;
+	entry->x2 = t2->x;
+	entry->y2 = t2->y;
+	entry->z2 = t2->z;
+	entry->h2 = t2->height;
+	entry->s2 = t2->scale;
+	entry->eflags2 = t2->eflags;
+	entry->kind = kind;
+	entry->result = result;
+	entry->time = leveltime;
+	entry->generation = sightcachegeneration;
+
+	entry->momx1 = t1->momx;
+	entry->momy1 = t1->momy;
+	entry->momz1 = t1->momz;
+	entry->floorz1 = t1->floorz;
+	entry->ceilingz1 = t1->ceilingz;
+	entry->floorrover1 = t1->floorrover;
+	entry->slope1 = t1->standingslope;
+	entry->playerbits1 = P_SightCachePlayerBits(kind, t1);
+
+	entry->sectorepoch = sightsectorepoch;
+
+	for (i = 0; i < entry->sectors.count; i++)
+	{
+		entry->sectorgens[i] = entry->sectors.list[i]->sightgen;
+	}
+}
+
+static boolean P_CompareMobjsAcrossLines(mobj_t *t1, mobj_t *t2, register los_funcs_t *funcs, sightsectors_t *touched)
 {
 	los_t los;
 	const sector_t *s1, *s2;
@@ -703,6 +1008,10 @@ static boolean P_CompareMobjsAcrossLines(mobj_t *t1, mobj_t *t2, register los_fu
 	s2 = t2->subsector->sector;
 	pnum = (s1-sectors)*numsectors + (s2-sectors);
 
+	los.touched = touched;
+	P_TouchSightSector(&los, t1->subsector->sector);
+	P_TouchSightSector(&los, t2->subsector->sector);
+
 	if (rejectmatrix != NULL)
 	{
 		// Check in REJECT table.
@@ -760,6 +1069,55 @@ static boolean P_CompareMobjsAcrossLines(mobj_t *t1, mobj_t *t2, register los_fu
 	return P_CrossBSPNode((INT32)numnodes - 1, &los, funcs);
 }
 
+static boolean P_CompareMobjsCached(mobj_t *t1, mobj_t *t2, loskind_t kind, register los_funcs_t *funcs)
+{
+	sightcache_t *entry;
+	boolean result;
+	INT32 oldsightcount;
+	size_t oldvalidcount;
+	fixed_t oldtmx, oldtmy;
+
+	if (P_MobjWasRemoved(t1) == true || P_MobjWasRemoved(t2) == true)
+	{
+		return false;
+	}
+
+	entry = P_GetSightCacheSlot(kind, t1, t2);
+
+	if (P_SightCacheMatches(entry, kind, t1, t2) == true)
+	{
+		sightcounts[1] += entry->sightcounted;
+		validcount += entry->validcounted;
+
+		if (entry->tmset == true)
+		{
+			g_tm.x = entry->tmx;
+			g_tm.y = entry->tmy;
+		}
+
+		return entry->result;
+	}
+
+	oldsightcount = sightcounts[1];
+	oldvalidcount = validcount;
+	oldtmx = g_tm.x;
+	oldtmy = g_tm.y;
+
+	entry->sectors.count = 0;
+	entry->sectors.overflow = false;
+
+	result = P_CompareMobjsAcrossLines(t1, t2, funcs, &entry->sectors);
+	P_StoreSightCache(entry, kind, t1, t2, result);
+
+	entry->sightcounted = (UINT8)(sightcounts[1] - oldsightcount);
+	entry->validcounted = (UINT8)(validcount - oldvalidcount);
+	entry->tmset = (g_tm.x != oldtmx || g_tm.y != oldtmy);
+	entry->tmx = g_tm.x;
+	entry->tmy = g_tm.y;
+
+	return result;
+}
+
 //
 // P_CheckSight
 //
@@ -774,7 +1132,7 @@ boolean P_CheckSight(mobj_t *t1, mobj_t *t2)
 	funcs.validate = &P_IsVisible;
 	funcs.validatePolyobj = &P_IsVisiblePolyObj;
 
-	return P_CompareMobjsAcrossLines(t1, t2, &funcs);
+	return P_CompareMobjsCached(t1, t2, LOS_CHECKSIGHT, &funcs);
 }
 
 boolean P_TraceBlockingLines(mobj_t *t1, mobj_t *t2)
@@ -783,7 +1141,7 @@ boolean P_TraceBlockingLines(mobj_t *t1, mobj_t *t2)
 
 	funcs.validate = &P_CanTraceBlockingLine;
 
-	return P_CompareMobjsAcrossLines(t1, t2, &funcs);
+	return P_CompareMobjsCached(t1, t2, LOS_BLOCKINGLINES, &funcs);
 }
 
 boolean P_TraceBotTraversal(mobj_t *t1, mobj_t *t2)
@@ -793,7 +1151,7 @@ boolean P_TraceBotTraversal(mobj_t *t1, mobj_t *t2)
 	funcs.init = &P_InitTraceBotTraversal;
 	funcs.validate = &P_CanBotTraverse;
 
-	return P_CompareMobjsAcrossLines(t1, t2, &funcs);
+	return P_CompareMobjsCached(t1, t2, LOS_BOTTRAVERSAL, &funcs);
 }
 
 boolean P_TraceWaypointTraversal(mobj_t *t1, mobj_t *t2)
@@ -802,5 +1160,5 @@ boolean P_TraceWaypointTraversal(mobj_t *t1, mobj_t *t2)
 
 	funcs.validate = &P_CanWaypointTraverse;
 
-	return P_CompareMobjsAcrossLines(t1, t2, &funcs);
+	return P_CompareMobjsCached(t1, t2, LOS_WAYPOINTTRAVERSAL, &funcs);
 }
@@ -247,6 +247,7 @@ void T_DynamicSlopeLine (dynlineplanethink_t* th)
 	pslope_t* slope = th->slope;
 	line_t* srcline = th->sourceline;
 
+	const fixed_t oldz = slope->o.z;
 	fixed_t zdelta;
 
 	switch(th->type) {
@@ -278,22 +279,34 @@ void T_DynamicSlopeLine (dynlineplanethink_t* th)
 		slope->zdelta = FixedDiv(zdelta, th->extent);
 		slope->zangle = R_PointToAngle2(0, 0, th->extent, -zdelta);
 		P_CalculateSlopeNormal(slope);
+		P_InvalidateSightCache();
 	}
+	else if (slope->o.z != oldz)
+		P_InvalidateSightCache();
 }
 
 /// Mapthing-defined
 void T_DynamicSlopeVert (dynvertexplanethink_t* th)
 {
 	size_t i;
+	boolean moved = false;
 
 	for (i = 0; i < 3; i++)
 	{
+		const fixed_t oldz = th->vex[i].z;
+
 		if (th->relative & (1 << i))
 			th->vex[i].z = th->origvecheights[i] + (th->secs[i]->floorheight - th->origsecheights[i]);
 		else
 			th->vex[i].z = th->secs[i]->floorheight;
+
+		if (th->vex[i].z != oldz)
+			moved = true;
 	}
 
+	if (moved)
+		P_InvalidateSightCache();
+
 	P_ReconfigureViaVertexes(th->slope, th->vex[0], th->vex[1], th->vex[2]);
 }
 
@@ -2615,6 +2615,9 @@ boolean P_ProcessSpecial(activator_t *activator, INT16 special, INT32 *args, cha
 
 	INT32 secnum = -1;
 
+	// Specials can change lines, FOFs and sectors in any way
+	P_InvalidateSightCache();
+
 	// note: only specials that P_CanActivateSpecial returns true on can be used
 	switch (special)
 	{
@@ -8434,6 +8437,7 @@ void T_Disappear(disappear_t *d)
 			}
 			sectors[s].moved = true;
 			P_RecalcPrecipInSector(&sectors[s]);
+			P_InvalidateSectorSight(&sectors[s]);
 		}
 
 		if (d->exists)
@@ -8886,6 +8890,9 @@ static void P_AddFakeFloorFader(ffloor_t *rover, size_t sectornum, size_t ffloor
   */
 void T_Fade(fade_t *d)
 {
+	ffloor_t *rover = d->rover;
+	const ffloortype_e oldflags = (rover ? rover->fofflags : 0);
+
 	if (d->rover && !P_FadeFakeFloor(d->rover, d->sourcevalue, d->destvalue, d->speed, d->ticbased, &d->timer,
 		d->doexists, d->dotranslucent, d->dolighting, d->docolormap, d->docollision, d->doghostfade, d->exactalpha))
 	{
@@ -8899,6 +8906,10 @@ void T_Fade(fade_t *d)
 
 		P_RemoveFakeFloorFader(d->rover);
 	}
+
+	// Fading can make the FOF solid or make it stop existing
+	if (rover && rover->fofflags != oldflags)
+		P_InvalidateSectorSight(rover->target);
 }
 
 static void P_ResetColormapFader(sector_t *sector)
@@ -51,6 +51,7 @@
 #include "m_easing.h"
 #include "k_hud.h" // messagetimer
 #include "k_endcam.h"
+#include "r_particle.h"
 
 #include "lua_profile.h"
 
@@ -566,6 +567,8 @@ static void P_RunThinkers(void)
 #ifdef PARANOIA
 			I_Assert(currentthinker->function.acp1 != NULL);
 #endif
+			// Start pulling in the next thinker while this one runs.
+			PREFETCH(currentthinker->next);
 			currentthinker->function.acp1(currentthinker);
 		}
 		ps_thlist_times[i] = I_GetPreciseTime() - ps_thlist_times[i];
@@ -920,6 +923,7 @@ void P_Ticker(boolean run)
 		LUA_ResetTicTimers();
 
 		ps_lua_mobjhooks = 0;
+		memset(ps_lua_mobjhooks_bytype, 0, sizeof ps_lua_mobjhooks_bytype);
 		ps_checkposition_calls = 0;
 
 		LUA_HOOK(PreThinkFrame);
@@ -1069,6 +1073,9 @@ void P_Ticker(boolean run)
 		ps_thinkertime = I_GetPreciseTime() - ps_thinkertime;
 		thinkersCompleted = true;
 
+		// Visual-only, so this is safe to run outside of the thinker lists
+		R_RunParticles();
+
 		// Run any "after all the other thinkers" stuff
 		{
 			player_t *finishingPlayers[MAXPLAYERS];
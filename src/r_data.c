@@ -34,6 +34,10 @@
 // DRRR
 #include "k_brightmap.h"
 
+#ifdef HAVE_THREADS
+#include "core/thread_pool.h"
+#endif
+
 //
 // Graphics.
 // SRB2 graphics for walls and sprites
@@ -49,6 +53,7 @@ sprcache_t *spritecachedinfo;
 
 lighttable_t *colormaps;
 UINT8 *encoremap;
+static UINT32 lighttableencorekey; // hash of encoremap for the light table cache, 0 when there is none
 
 // for debugging/info purposes
 size_t flatmemory, spritememory, texturememory;
@@ -319,6 +324,13 @@ void R_ReInitColormaps(UINT16 num, void *newencoremap, size_t encoremapsize)
 
 		encoremap = Z_MallocAlign(256 + 10, PU_LEVEL, NULL, 8);
 		M_Memcpy(encoremap, newencoremap, encoremapsize);
+
+		// Light tables made with a different remap can't be shared.
+		lighttableencorekey = 2166136261u;
+		for (i = 0; i < 256; i++)
+			lighttableencorekey = (lighttableencorekey ^ encoremap[i]) * 16777619u;
+		lighttableencorekey |= 1;
+
 		colormap_p = colormap_p2 = colormaps;
 		colormap_p += COLORMAP_REMAPOFFSET;
 
@@ -333,7 +345,10 @@ void R_ReInitColormaps(UINT16 num, void *newencoremap, size_t encoremapsize)
 		}
 	}
 	else
+	{
 		encoremap = NULL;
+		lighttableencorekey = 0;
+	}
 
 	// Init Boom colormaps.
 	R_ClearColormaps();
@@ -613,29 +628,73 @@ extracolormap_t *R_ColormapForName(char *name)
 // custom colormaps at runtime. NOTE: For GL mode, we only need to color
 // data and not the colormap data.
 //
-static double brightChange[256], map[256][3];
-
 static int RoundUp(double number);
 
-lighttable_t *R_CreateLightTable(extracolormap_t *extra_colormap)
+// Light tables only depend on these values, the palette and the
+// encore remap. They are shared by every colormap with the same
+// values, and kept between levels so the next map can reuse them.
+struct lighttablecache
+{
+	INT32 rgba, fadergba;
+	UINT8 fadestart, fadeend;
+	UINT32 palette; // nearestcubeserial
+	UINT32 encore; // lighttableencorekey
+	lighttable_t *table;
+	UINT32 used; // lighttableepoch of the last level that used it
+	struct lighttablecache *next;
+};
+
+#define LIGHTTABLEHASHSIZE 256
+#define LIGHTTABLECACHESIZE 256 // how many are kept past their level
+
+static struct lighttablecache *lighttablehash[LIGHTTABLEHASHSIZE];
+static size_t numlighttables;
+static UINT32 lighttableepoch;
+
+// Tables made between R_BeginLightTableBatch and
+// R_FinishLightTableBatch are generated all at once.
+static boolean lighttablebatch;
+static struct lighttablecache **pendinglighttables;
+static size_t numpendinglighttables, maxpendinglighttables;
+
+static UINT32 nearestcubeserial;
+
+static UINT32 R_HashLightTable(INT32 rgba, INT32 fadergba, UINT8 fadestart, UINT8 fadeend)
+{
+	UINT32 hash = (UINT32)rgba * 2654435761u;
+
+	hash ^= (UINT32)fadergba * 2246822519u;
+	hash ^= (UINT32)((fadestart << 8) | fadeend) * 3266489917u;
+
+	return (hash ^ (hash >> 16)) & (LIGHTTABLEHASHSIZE - 1);
+}
+
+//
+// R_GenerateLightTable
+//
+// Fills in a light table. This only reads the palette
+// and encore remap, so it is safe to run on any thread.
+//
+static void R_GenerateLightTable(const struct lighttablecache *entry)
 {
+	double brightChange[256], map[256][3];
 	double cmaskr, cmaskg, cmaskb, cdestr, cdestg, cdestb, cdestbright;
 	double maskamt = 0, othermask = 0;
 	double fmaskamt = 0, fothermask = 0;
 
-	UINT8 cr = R_GetRgbaR(extra_colormap->rgba),
-		cg = R_GetRgbaG(extra_colormap->rgba),
-		cb = R_GetRgbaB(extra_colormap->rgba),
-		ca = R_GetRgbaA(extra_colormap->rgba),
-		cfr = R_GetRgbaR(extra_colormap->fadergba),
-		cfg = R_GetRgbaG(extra_colormap->fadergba),
-		cfb = R_GetRgbaB(extra_colormap->fadergba),
-		cfa = R_GetRgbaA(extra_colormap->fadergba);
+	UINT8 cr = R_GetRgbaR(entry->rgba),
+		cg = R_GetRgbaG(entry->rgba),
+		cb = R_GetRgbaB(entry->rgba),
+		ca = R_GetRgbaA(entry->rgba),
+		cfr = R_GetRgbaR(entry->fadergba),
+		cfg = R_GetRgbaG(entry->fadergba),
+		cfb = R_GetRgbaB(entry->fadergba),
+		cfa = R_GetRgbaA(entry->fadergba);
 
-	UINT8 fadestart = extra_colormap->fadestart,
-		fadedist = extra_colormap->fadeend - extra_colormap->fadestart;
+	UINT8 fadestart = entry->fadestart,
+		fadedist = entry->fadeend - entry->fadestart;
 
-	lighttable_t *lighttable = NULL;
+	lighttable_t *lighttable = entry->table;
 	size_t i;
 
 	/////////////////////
@@ -717,10 +776,7 @@ lighttable_t *R_CreateLightTable(extracolormap_t *extra_colormap)
 			brightChange[i] = (fabs(cbest - cdist) / (double)fadedist) * fmaskamt;
 		}
 
-		// Now allocate memory for the actual colormap array itself!
-		// aligned on 8 bit for asm code
-		colormap_p = Z_MallocAlign((COLORMAP_SIZE * (encoremap ? 2 : 1)) + 10, PU_LEVEL, NULL, 8);
-		lighttable = (UINT8 *)colormap_p;
+		colormap_p = lighttable;
 
 		// Calculate the palette index for each palette index, for each light level
 		// (as well as the two unused colormap lines we inherited from Doom)
@@ -775,8 +831,170 @@ lighttable_t *R_CreateLightTable(extracolormap_t *extra_colormap)
 			}
 		}
 	}
+}
+
+#ifdef HAVE_THREADS
+static void R_GenerateLightTableThunk(void *data)
+{
+	R_GenerateLightTable(data);
+}
+#endif
+
+lighttable_t *R_CreateLightTable(extracolormap_t *extra_colormap)
+{
+	const UINT32 hash = R_HashLightTable(extra_colormap->rgba, extra_colormap->fadergba, extra_colormap->fadestart, extra_colormap->fadeend);
+	struct lighttablecache *entry;
+
+	for (entry = lighttablehash[hash]; entry; entry = entry->next)
+	{
+		if (entry->rgba == extra_colormap->rgba
+			&& entry->fadergba == extra_colormap->fadergba
+			&& entry->fadestart == extra_colormap->fadestart
+			&& entry->fadeend == extra_colormap->fadeend
+			&& entry->palette == nearestcubeserial
+			&& entry->encore == lighttableencorekey)
+		{
+			entry->used = lighttableepoch;
+			return entry->table;
+		}
+	}
+
+	entry = Z_Calloc(sizeof(*entry), PU_STATIC, NULL);
+	entry->rgba = extra_colormap->rgba;
+	entry->fadergba = extra_colormap->fadergba;
+	entry->fadestart = extra_colormap->fadestart;
+	entry->fadeend = extra_colormap->fadeend;
+	entry->palette = nearestcubeserial;
+	entry->encore = lighttableencorekey;
+	entry->used = lighttableepoch;
+
+	// Now allocate memory for the actual colormap array itself!
+	// aligned on 8 bit for asm code
+	entry->table = Z_MallocAlign((COLORMAP_SIZE * (encoremap ? 2 : 1)) + 10, PU_STATIC, NULL, 8);
+
+	entry->next = lighttablehash[hash];
+	lighttablehash[hash] = entry;
+	numlighttables++;
+
+	if (lighttablebatch)
+	{
+		if (numpendinglighttables == maxpendinglighttables)
+		{
+			maxpendinglighttables = maxpendinglighttables ? maxpendinglighttables * 2 : 64;
+			Z_Realloc(pendinglighttables, maxpendinglighttables * sizeof(*pendinglighttables), PU_STATIC, &pendinglighttables);
+		}
+
+		pendinglighttables[numpendinglighttables++] = entry;
+	}
+	else
+	{
+		R_GenerateLightTable(entry);
+	}
+
+	return entry->table;
+}
+
+//
+// R_BeginLightTableBatch
+//
+// Light tables made after this are only filled in by
+// R_FinishLightTableBatch, across the thread pool.
+// Used while loading a level, where nothing is drawn.
+//
+void R_BeginLightTableBatch(void)
+{
+	lighttablebatch = true;
+	numpendinglighttables = 0;
+}
+
+//
+// R_FinishLightTableBatch
+//
+void R_FinishLightTableBatch(void)
+{
+	size_t i;
+
+	lighttablebatch = false;
+
+#ifdef HAVE_THREADS
+	I_ThreadPoolBeginSema();
+#endif
+
+	for (i = 0; i < numpendinglighttables; i++)
+	{
+#ifdef HAVE_THREADS
+		I_ThreadPoolSubmit(R_GenerateLightTableThunk, pendinglighttables[i]);
+#else
+		R_GenerateLightTable(pendinglighttables[i]);
+#endif
+	}
+
+#ifdef HAVE_THREADS
+	// Not WaitIdle, tables a worker already started must be done too
+	I_ThreadPoolWaitSema();
+#endif
+
+	numpendinglighttables = 0;
+}
+
+static int R_CompareLightTableUsed(const void *a, const void *b)
+{
+	const UINT32 useda = (*(struct lighttablecache *const *)a)->used;
+	const UINT32 usedb = (*(struct lighttablecache *const *)b)->used;
+
+	return (useda > usedb) - (useda < usedb);
+}
+
+//
+// R_TrimLightTables
+//
+// Called at level load, once the last level's colormaps are gone.
+// Frees the least recently used light tables past LIGHTTABLECACHESIZE.
+//
+void R_TrimLightTables(void)
+{
+	struct lighttablecache **order, **link, *entry;
+	size_t i, count = 0;
+
+	lighttableepoch++;
+
+	if (numlighttables <= LIGHTTABLECACHESIZE)
+		return;
+
+	order = Z_Malloc(numlighttables * sizeof(*order), PU_STATIC, NULL);
+
+	for (i = 0; i < LIGHTTABLEHASHSIZE; i++)
+		for (entry = lighttablehash[i]; entry; entry = entry->next)
+			order[count++] = entry;
+
+	qsort(order, count, sizeof(*order), R_CompareLightTableUsed);
+
+	// Mark which ones to free by clearing their table
+	for (i = 0; i < count - LIGHTTABLECACHESIZE; i++)
+	{
+		Z_Free(order[i]->table);
+		order[i]->table = NULL;
+	}
+
+	Z_Free(order);
+
+	for (i = 0; i < LIGHTTABLEHASHSIZE; i++)
+	{
+		link = &lighttablehash[i];
 
-	return lighttable;
+		while ((entry = *link) != NULL)
+		{
+			if (entry->table)
+			{
+				link = &entry->next;
+				continue;
+			}
+
+			*link = entry->next;
+			Z_Free(entry);
+			numlighttables--;
+		}
+	}
 }
 
 extracolormap_t *R_CreateColormapFromLinedef(char *p1, char *p2, char *p3)
@@ -1069,6 +1287,143 @@ extracolormap_t *R_AddColormaps(extracolormap_t *exc_augend, extracolormap_t *ex
 	return exc_augend;
 }
 
+// Nearest colors are looked up through a 32x32x32 cube over RGB space.
+// Each cell lists only the palette entries that can be the nearest for
+// some color inside of it, in palette order, so searching a cell gives
+// exactly what searching the whole palette would.
+#define NEARESTCUBECELL(r, g, b) ((((r) >> NEARESTCUBESHIFT) << (2*NEARESTCUBEBITS)) | (((g) >> NEARESTCUBESHIFT) << NEARESTCUBEBITS) | ((b) >> NEARESTCUBESHIFT))
+
+static nearestcolorcube_t mastercube; // for pMasterPalette
+
+//
+// R_BuildNearestColorCube
+//
+// Builds a cube for the first 256 colors of palette.
+// Uses static scratch space, so only call this from the main thread.
+//
+void R_BuildNearestColorCube(nearestcolorcube_t *cube, const RGBA_t *palette)
+{
+	// Closest and farthest squared distance along one channel,
+	// from each palette color to each cell's range.
+	static INT32 mindist[3][NEARESTCUBESIZE][256], maxdist[3][NEARESTCUBESIZE][256];
+	size_t numentries = 0;
+	INT32 c, i, p, r, g, b;
+
+	M_Memcpy(cube->palette, palette, sizeof cube->palette);
+
+	for (c = 0; c < 3; c++)
+	{
+		for (i = 0; i < NEARESTCUBESIZE; i++)
+		{
+			const INT32 lo = i << NEARESTCUBESHIFT;
+			const INT32 hi = lo + (1 << NEARESTCUBESHIFT) - 1;
+
+			for (p = 0; p < 256; p++)
+			{
+				const INT32 v = (c == 0) ? palette[p].s.red : (c == 1) ? palette[p].s.green : palette[p].s.blue;
+				const INT32 closest = (v < lo) ? lo - v : (v > hi) ? v - hi : 0;
+				const INT32 farthest = max(v - lo, hi - v);
+
+				mindist[c][i][p] = closest * closest;
+				maxdist[c][i][p] = farthest * farthest;
+			}
+		}
+	}
+
+	for (r = 0; r < NEARESTCUBESIZE; r++)
+	for (g = 0; g < NEARESTCUBESIZE; g++)
+	for (b = 0; b < NEARESTCUBESIZE; b++)
+	{
+		// No color in this cell is farther than this from its nearest palette entry.
+		INT32 bound = INT32_MAX;
+
+		for (p = 0; p < 256; p++)
+		{
+			const INT32 d = maxdist[0][r][p] + maxdist[1][g][p] + maxdist[2][b][p];
+			if (d < bound)
+				bound = d;
+		}
+
+		cube->cells[(r << (2*NEARESTCUBEBITS)) | (g << NEARESTCUBEBITS) | b] = (UINT32)numentries;
+
+		for (p = 0; p < 256; p++)
+		{
+			if (mindist[0][r][p] + mindist[1][g][p] + mindist[2][b][p] > bound)
+				continue;
+
+			// Plain realloc, so a cube can be freed off the main thread
+			if (numentries == cube->maxentries)
+			{
+				cube->maxentries = cube->maxentries ? cube->maxentries * 2 : 65536;
+				cube->entries = realloc(cube->entries, cube->maxentries);
+				if (cube->entries == NULL)
+					I_Error("R_BuildNearestColorCube: Out of memory");
+			}
+
+			cube->entries[numentries++] = (UINT8)p;
+		}
+	}
+
+	cube->cells[NEARESTCUBESIZE*NEARESTCUBESIZE*NEARESTCUBESIZE] = (UINT32)numentries;
+}
+
+void R_FreeNearestColorCube(nearestcolorcube_t *cube)
+{
+	free(cube->entries);
+	cube->entries = NULL;
+	cube->maxentries = 0;
+}
+
+//
+// R_NearestCubeColor
+//
+// Same as NearestPaletteColor for the cube's palette.
+//
+UINT8 R_NearestCubeColor(const nearestcolorcube_t *cube, UINT8 r, UINT8 g, UINT8 b)
+{
+	const UINT32 cell = NEARESTCUBECELL(r, g, b);
+	int dr, dg, db;
+	int distortion, bestdistortion = 256 * 256 * 4, bestcolor = 0, i;
+	UINT32 j;
+
+	for (j = cube->cells[cell]; j < cube->cells[cell + 1]; j++)
+	{
+		i = cube->entries[j];
+		dr = r - cube->palette[i].s.red;
+		dg = g - cube->palette[i].s.green;
+		db = b - cube->palette[i].s.blue;
+		distortion = dr*dr + dg*dg + db*db;
+		if (distortion < bestdistortion)
+		{
+			if (!distortion)
+				return (UINT8)i;
+
+			bestdistortion = distortion;
+			bestcolor = i;
+		}
+	}
+
+	return (UINT8)bestcolor;
+}
+
+//
+// R_InitNearestColorCube
+//
+// Builds the cube for pMasterPalette. Called when the palette is
+// loaded, and does nothing if its colors are the same as before.
+//
+void R_InitNearestColorCube(void)
+{
+	if (pMasterPalette == NULL)
+		return;
+
+	if (mastercube.entries && !memcmp(mastercube.palette, pMasterPalette, sizeof mastercube.palette))
+		return;
+
+	R_BuildNearestColorCube(&mastercube, pMasterPalette);
+	nearestcubeserial++;
+}
+
 // Thanks to quake2 source!
 // utils3/qdata/images.c
 UINT8 NearestPaletteColor(UINT8 r, UINT8 g, UINT8 b, RGBA_t *palette)
@@ -1080,6 +1435,9 @@ UINT8 NearestPaletteColor(UINT8 r, UINT8 g, UINT8 b, RGBA_t *palette)
 	if (palette == NULL)
 		palette = pMasterPalette;
 
+	if (palette == pMasterPalette && mastercube.entries)
+		return R_NearestCubeColor(&mastercube, r, g, b);
+
 	for (i = 0; i < 256; i++)
 	{
 		dr = r - palette[i].s.red;
@@ -1193,16 +1551,9 @@ void R_PrecacheLevel(void)
 	texturepresent[skytexture] = 1;
 
 	texturememory = 0;
-	for (j = 0; j < (unsigned)numtextures; j++)
-	{
-		if (!texturepresent[j])
-			continue;
-
-		if (!texturecache[j])
-			R_GenerateTexture(j);
-		// pre-caching individual patches that compose textures became obsolete,
-		// since we cache entire composite textures
-	}
+	// pre-caching individual patches that compose textures became obsolete,
+	// since we cache entire composite textures
+	R_GenerateTextures(texturepresent);
 	free(texturepresent);
 
 	//
@@ -95,6 +95,9 @@ typedef enum
 } textmapcolormapflags_t;
 
 lighttable_t *R_CreateLightTable(extracolormap_t *extra_colormap);
+void R_BeginLightTableBatch(void);
+void R_FinishLightTableBatch(void);
+void R_TrimLightTables(void);
 extracolormap_t * R_CreateColormapFromLinedef(char *p1, char *p2, char *p3);
 extracolormap_t* R_CreateColormap(INT32 rgba, INT32 fadergba, UINT8 fadestart, UINT8 fadeend, UINT8 flags);
 extracolormap_t *R_AddColormaps(extracolormap_t *exc_augend, extracolormap_t *exc_addend,
@@ -119,6 +122,23 @@ const char *R_NameForColormap(extracolormap_t *extra_colormap);
 #define R_PutRgbaRGB(r, g, b) (R_PutRgbaR(r) + R_PutRgbaG(g) + R_PutRgbaB(b))
 #define R_PutRgbaRGBA(r, g, b, a) (R_PutRgbaRGB(r, g, b) + R_PutRgbaA(a))
 
+// RGB to palette index lookup, see R_BuildNearestColorCube
+#define NEARESTCUBEBITS 5
+#define NEARESTCUBESIZE (1<<NEARESTCUBEBITS)
+#define NEARESTCUBESHIFT (8-NEARESTCUBEBITS)
+
+struct nearestcolorcube_t
+{
+	RGBA_t palette[256];
+	UINT32 cells[NEARESTCUBESIZE*NEARESTCUBESIZE*NEARESTCUBESIZE + 1]; // where each cell starts in entries
+	UINT8 *entries; // palette indexes that can be nearest, for each cell
+	size_t maxentries;
+};
+
+void R_BuildNearestColorCube(nearestcolorcube_t *cube, const RGBA_t *palette);
+void R_FreeNearestColorCube(nearestcolorcube_t *cube);
+UINT8 R_NearestCubeColor(const nearestcolorcube_t *cube, UINT8 r, UINT8 g, UINT8 b);
+void R_InitNearestColorCube(void);
 UINT8 NearestPaletteColor(UINT8 r, UINT8 g, UINT8 b, RGBA_t *palette);
 #define NearestColor(r, g, b) NearestPaletteColor(r, g, b, NULL)
 
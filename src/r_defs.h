@@ -523,6 +523,7 @@ struct sector_t
 	lightlist_t *lightlist;
 	INT32 numlights;
 	boolean moved;
+	UINT32 sightgen; // bumped when the planes or FOFs change, for the sight cache
 
 	// per-sector colormaps!
 	extracolormap_t *extra_colormap;
@@ -878,6 +879,7 @@ struct rotsprite_t
 {
 	INT32 angles;
 	void **patches;
+	bitarray_t *queued; // Angles being rotated in the background
 };
 #endif
 
@@ -17,6 +17,8 @@
 ///        The frame buffer is a linear one, and we need only the base address.
 
 #include <algorithm>
+#include <atomic>
+#include <string>
 
 #include "doomdef.h"
 #include "doomstat.h"
@@ -31,6 +33,9 @@
 #include "k_color.h" // SRB2kart
 #include "i_threads.h"
 #include "libdivide.h" // used by NPO2 tilted span functions
+#include "m_argv.h" // -nosimd, -noblendcache
+#include "d_main.h" // srb2home
+#include "core/thread_pool.h"
 
 #ifdef HWRENDER
 #include "hardware/hw_main.h"
@@ -38,6 +43,16 @@
 
 #include <tracy/tracy/Tracy.hpp>
 
+// AVX2 drawers, picked at runtime by R_SetSIMDDrawFuncs.
+// Not tied to NONX86, since that's also set for x86 builds without asm.
+#if !defined(NOSIMD) && (defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86))
+#define R_DRAW_AVX2
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
 // --------------------------------------------
 // assembly or c drawer routines for 8bpp/16bpp
 // --------------------------------------------
@@ -198,14 +213,29 @@ CV_PossibleValue_t Color_cons_t[MAXSKINCOLORS+1];
 
 #define TRANSTAB_AMTMUL10 (255.0f / 10.0f)
 
+// Blend tables are kept in srb2home, since generating them is slow.
+// The key is a hash of both palettes, so a new palette means new tables.
+#define BLENDCACHEFILE "blendtables.dat"
+#define BLENDCACHEHEADER "RRBLENDTAB"
+#define BLENDCACHEVERSION 1
+
+// Add, subtract and reverse subtract have one table per alpha step,
+// modulate only has one.
+#define BLENDTABLESTEPS 10
+#define BLENDTABLESIZE(i) ((i) == blendtab_modulate ? 0x10000 : BLENDTABLESTEPS * 0x10000)
+
+// Shared by the jobs generating one set of blend tables.
+// The last job to finish saves the tables and frees this.
 struct GenerateBlendTables_State
 {
-	RGBA_t *masterPalette;
-	RGBA_t *gammaCorrectedPalette;
+	nearestcolorcube_t masterPalette;
+	nearestcolorcube_t gammaCorrectedPalette;
+	std::atomic<INT32> remaining;
+	UINT64 key;
+	std::string cachepath;
 };
 
-static void R_GenerateBlendTables_Core(struct GenerateBlendTables_State *state);
-static void R_GenerateTranslucencyTable(UINT8 *table, RGBA_t* sourcepal, int style, UINT8 blendamt);
+static void R_GenerateTranslucencyTable(UINT8 *table, const nearestcolorcube_t *sourcepal, int style, UINT8 blendamt);
 
 static void R_AllocateBlendTables(void)
 {
@@ -222,18 +252,144 @@ static void R_AllocateBlendTables(void)
 	blendtables[blendtab_modulate] = static_cast<UINT8 *>(Z_MallocAlign(0x10000, PU_STATIC, NULL, 16));
 }
 
-#ifdef HAVE_THREADS
-static void R_GenerateBlendTables_Thread(void *userdata)
+static UINT64 R_BlendTablesKey(void)
+{
+	const UINT8 *palettes[2] = {
+		reinterpret_cast<const UINT8 *>(pMasterPalette),
+		reinterpret_cast<const UINT8 *>(pGammaCorrectedPalette)
+	};
+	UINT64 key = 14695981039346656037ULL; // FNV-1a
+	size_t i, j;
+
+	for (i = 0; i < 2; i++)
+	{
+		for (j = 0; j < 256 * sizeof(RGBA_t); j++)
+		{
+			key ^= palettes[i][j];
+			key *= 1099511628211ULL;
+		}
+	}
+
+	return key;
+}
+
+//
+// R_LoadBlendTables
+//
+// Reads the blend tables from BLENDCACHEFILE, if they were
+// made from the same palettes. Returns false if they weren't.
+//
+static boolean R_LoadBlendTables(const char *path, UINT64 key)
 {
-	struct GenerateBlendTables_State *state = static_cast<struct GenerateBlendTables_State *>(userdata);
+	char header[sizeof BLENDCACHEHEADER - 1];
+	UINT16 version;
+	UINT8 filekey[8];
+	boolean ok;
+	FILE *f;
+	INT32 i;
 
-	R_GenerateBlendTables_Core(state);
+	f = fopen(path, "rb");
+	if (f == NULL)
+		return false;
 
-	free(state->masterPalette);
-	free(state->gammaCorrectedPalette);
-	free(state);
+	ok = (fread(header, 1, sizeof header, f) == sizeof header)
+		&& !memcmp(header, BLENDCACHEHEADER, sizeof header)
+		&& (fread(&version, sizeof version, 1, f) == 1)
+		&& SHORT(version) == BLENDCACHEVERSION
+		&& (fread(filekey, 1, sizeof filekey, f) == sizeof filekey);
+
+	for (i = 0; i < 8 && ok; i++)
+	{
+		if (filekey[i] != (UINT8)(key >> (i * 8)))
+			ok = false;
+	}
+
+	for (i = 0; i < NUMBLENDMAPS && ok; i++)
+		ok = (fread(blendtables[i], 1, BLENDTABLESIZE(i), f) == BLENDTABLESIZE(i));
+
+	fclose(f);
+	return ok;
+}
+
+static void R_SaveBlendTables(const char *path, UINT64 key)
+{
+	std::string temppath = std::string(path) + ".tmp";
+	const UINT16 version = SHORT(BLENDCACHEVERSION);
+	UINT8 filekey[8];
+	boolean ok;
+	FILE *f;
+	INT32 i;
+
+	// This runs off the main thread, so failing is silent;
+	// the tables just get generated again next time.
+	f = fopen(temppath.c_str(), "wb");
+	if (f == NULL)
+		return;
+
+	for (i = 0; i < 8; i++)
+		filekey[i] = (UINT8)(key >> (i * 8));
+
+	ok = (fwrite(BLENDCACHEHEADER, 1, sizeof BLENDCACHEHEADER - 1, f) == sizeof BLENDCACHEHEADER - 1)
+		&& (fwrite(&version, sizeof version, 1, f) == 1)
+		&& (fwrite(filekey, 1, sizeof filekey, f) == sizeof filekey);
+
+	for (i = 0; i < NUMBLENDMAPS && ok; i++)
+		ok = (fwrite(blendtables[i], 1, BLENDTABLESIZE(i), f) == BLENDTABLESIZE(i));
+
+	if (fclose(f) != 0)
+		ok = false;
+
+	if (!ok)
+	{
+		remove(temppath.c_str());
+		return;
+	}
+
+	remove(path);
+	if (rename(temppath.c_str(), path) != 0)
+		remove(temppath.c_str());
+}
+
+//
+// R_GenerateBlendTable
+//
+// Generates one of the blend tables; job is an index
+// into the alpha steps of each map, in map order.
+// Safe to call from any thread.
+//
+static void R_GenerateBlendTable(struct GenerateBlendTables_State *state, INT32 job)
+{
+	const INT32 map = job / BLENDTABLESTEPS;
+	const INT32 step = job % BLENDTABLESTEPS;
+	const size_t offs = (0x10000 * step);
+	const UINT8 alpha = (TRANSTAB_AMTMUL10 * ((float)(10-step)));
+
+	switch (map)
+	{
+		case blendtab_add:
+			R_GenerateTranslucencyTable(blendtables[blendtab_add] + offs, &state->gammaCorrectedPalette, AST_ADD, alpha);
+			break;
+		case blendtab_subtract:
+			R_GenerateTranslucencyTable(blendtables[blendtab_subtract] + offs, &state->masterPalette, AST_SUBTRACT, alpha); // intentionally uses pMasterPalette
+			break;
+		case blendtab_reversesubtract:
+			R_GenerateTranslucencyTable(blendtables[blendtab_reversesubtract] + offs, &state->gammaCorrectedPalette, AST_REVERSESUBTRACT, alpha);
+			break;
+		default:
+			R_GenerateTranslucencyTable(blendtables[blendtab_modulate], &state->gammaCorrectedPalette, AST_MODULATE, 0);
+			break;
+	}
+
+	if (state->remaining.fetch_sub(1, std::memory_order_acq_rel) != 1)
+		return;
+
+	if (!state->cachepath.empty())
+		R_SaveBlendTables(state->cachepath.c_str(), state->key);
+
+	R_FreeNearestColorCube(&state->masterPalette);
+	R_FreeNearestColorCube(&state->gammaCorrectedPalette);
+	delete state;
 }
-#endif
 
 /** \brief Initializes the translucency tables used by the Software renderer.
 */
@@ -260,41 +416,41 @@ void R_InitTranslucencyTables(void)
 
 void R_GenerateBlendTables(void)
 {
-#ifdef HAVE_THREADS
-	// Allocate copies for the worker thread since the originals can be freed in the main thread.
-	struct GenerateBlendTables_State *state = static_cast<struct GenerateBlendTables_State *>(malloc(sizeof *state));
-	size_t palsize = 256 * sizeof(RGBA_t);
-
-	state->masterPalette = static_cast<RGBA_t *>(memcpy(malloc(palsize), pMasterPalette, palsize));
-	state->gammaCorrectedPalette = static_cast<RGBA_t *>(memcpy(malloc(palsize), pGammaCorrectedPalette, palsize));
-
-	I_spawn_thread("blend-tables",
-			R_GenerateBlendTables_Thread, state);
-#else
-	struct GenerateBlendTables_State state = {pMasterPalette, pGammaCorrectedPalette};
-
-	R_GenerateBlendTables_Core(&state);
-#endif
-}
-
-static void R_GenerateBlendTables_Core(struct GenerateBlendTables_State *state)
-{
+	// The last of the add, subtract and reverse subtract tables, then modulate
+	const INT32 numjobs = (blendtab_modulate * BLENDTABLESTEPS) + 1;
+	struct GenerateBlendTables_State *state;
+	std::string cachepath;
+	const UINT64 key = R_BlendTablesKey();
 	INT32 i;
 
-	for (i = 0; i <= 9; i++)
+	if (!M_CheckParm("-noblendcache"))
 	{
-		const size_t offs = (0x10000 * i);
-		const UINT8 alpha = (TRANSTAB_AMTMUL10 * ((float)(10-i)));
+		cachepath = va(pandf, srb2home, BLENDCACHEFILE);
 
-		R_GenerateTranslucencyTable(blendtables[blendtab_add] + offs, state->gammaCorrectedPalette, AST_ADD, alpha);
-		R_GenerateTranslucencyTable(blendtables[blendtab_subtract] + offs, state->masterPalette, AST_SUBTRACT, alpha); // intentionally uses pMasterPalette
-		R_GenerateTranslucencyTable(blendtables[blendtab_reversesubtract] + offs, state->gammaCorrectedPalette, AST_REVERSESUBTRACT, alpha);
+		if (R_LoadBlendTables(cachepath.c_str(), key))
+			return;
 	}
 
-	R_GenerateTranslucencyTable(blendtables[blendtab_modulate], state->gammaCorrectedPalette, AST_MODULATE, 0);
+	// The jobs get their own palettes since the originals can be freed in the main thread.
+	// Building the cubes here keeps their scratch space on this thread too.
+	state = new GenerateBlendTables_State;
+	R_BuildNearestColorCube(&state->masterPalette, pMasterPalette);
+	R_BuildNearestColorCube(&state->gammaCorrectedPalette, pGammaCorrectedPalette);
+	state->remaining = numjobs;
+	state->key = key;
+	state->cachepath = cachepath;
+
+#ifdef HAVE_THREADS
+	for (i = 0; i < numjobs; i++)
+		srb2::g_main_threadpool->schedule([state, i]() { R_GenerateBlendTable(state, i); });
+	srb2::g_main_threadpool->notify();
+#else
+	for (i = 0; i < numjobs; i++)
+		R_GenerateBlendTable(state, i);
+#endif
 }
 
-void R_GenerateTranslucencyTable(UINT8 *table, RGBA_t* sourcepal, int style, UINT8 blendamt)
+static void R_GenerateTranslucencyTable(UINT8 *table, const nearestcolorcube_t *sourcepal, int style, UINT8 blendamt)
 {
 	INT16 bg, fg;
 	RGBA_t backrgba, frontrgba, result;
@@ -304,13 +460,13 @@ void R_GenerateTranslucencyTable(UINT8 *table, RGBA_t* sourcepal, int style, UIN
 
 	for (bg = 0; bg <= 0xFF; bg++)
 	{
-		backrgba = sourcepal[bg];
+		backrgba = sourcepal->palette[bg];
 		for (fg = 0; fg <= 0xFF; fg++)
 		{
-			frontrgba = sourcepal[fg];
+			frontrgba = sourcepal->palette[fg];
 
 			result.rgba = ASTBlendPixel(backrgba, frontrgba, style, blendamt);
-			table[((fg * 0x100) + bg)] = NearestPaletteColor(result.s.red, result.s.green, result.s.blue, sourcepal);
+			table[((fg * 0x100) + bg)] = R_NearestCubeColor(sourcepal, result.s.red, result.s.green, result.s.blue);
 		}
 	}
 }
@@ -662,3 +818,4 @@ void R_DrawViewBorder(void)
 
 #include "r_draw_column.cpp"
 #include "r_draw_span.cpp"
+#include "r_draw_simd.cpp"
@@ -288,6 +288,9 @@ void R_DrawColumn_Flat(drawcolumndata_t* dc);
 void R_DrawSpan_Flat(drawspandata_t* ds);
 void R_DrawTiltedSpan_Flat(drawspandata_t* ds);
 
+// Swaps in vectorized drawers when the CPU supports them, see r_draw_simd.cpp
+void R_SetSIMDDrawFuncs(void);
+
 #ifdef __cplusplus
 } // extern "C"
 #endif // __cplusplus
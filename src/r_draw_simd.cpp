@@ -0,0 +1,263 @@
+// DR. ROBOTNIK'S RING RACERS
+//-----------------------------------------------------------------------------
+// Copyright (C) 2024 by Kart Krew.
+//
+// This program is free software distributed under the
+// terms of the GNU General Public License, version 2.
+// See the 'LICENSE' file for more details.
+//-----------------------------------------------------------------------------
+/// \file  r_draw_simd.cpp
+/// \brief AVX2 span drawer functions
+/// \note  no includes because this is included as part of r_draw.cpp
+///
+/// These mirror R_DrawSpanTemplate, but compute eight pixels at once.
+/// Every table lookup is done with a 32-bit gather of the aligned word
+/// holding the wanted byte, so nothing is read outside of a word that
+/// contains a valid byte, and the output is identical to the scalar
+/// drawers. SSE4.1 has no gather, so it has no variant here.
+///
+/// Columns are left scalar: their stores are a screen width apart, so
+/// the gathers ended up slower than the plain loop.
+
+#ifdef R_DRAW_AVX2
+
+#if defined(__GNUC__) || defined(__clang__)
+#define AVX2_TARGET __attribute__((target("avx2")))
+#else
+#define AVX2_TARGET
+#endif
+
+// Looks up 8 bytes from table[index] at once.
+AVX2_TARGET static inline __m256i R_GatherBytes_AVX2(const UINT8 *table, __m256i index)
+{
+	const uintptr_t base = (uintptr_t)table;
+	const int *aligned = (const int *)(base & ~(uintptr_t)3);
+	const __m256i offset = _mm256_add_epi32(index, _mm256_set1_epi32((int)(base & 3)));
+	const __m256i words = _mm256_i32gather_epi32(aligned, _mm256_srli_epi32(offset, 2), 4);
+	const __m256i shift = _mm256_slli_epi32(_mm256_and_si256(offset, _mm256_set1_epi32(3)), 3);
+
+	return _mm256_and_si256(_mm256_srlv_epi32(words, shift), _mm256_set1_epi32(0xFF));
+}
+
+// Writes the low byte of each lane to 8 consecutive bytes.
+AVX2_TARGET static inline void R_StoreBytes_AVX2(UINT8 *dest, __m256i v)
+{
+	const __m256i shuffle = _mm256_setr_epi8(
+		0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+		0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
+	);
+	UINT32 lo, hi;
+
+	v = _mm256_shuffle_epi8(v, shuffle);
+	lo = (UINT32)_mm256_cvtsi256_si32(v);
+	hi = (UINT32)_mm256_extract_epi32(v, 4);
+
+	memcpy(dest, &lo, 4);
+	memcpy(dest + 4, &hi, 4);
+}
+
+// Same as R_GetSpanTranslucent, for 8 pixels.
+// bright is the brightmap value per lane, and back is what's already on screen.
+AVX2_TARGET static inline __m256i R_ShadePixels_AVX2(
+	__m256i col, __m256i bright, __m256i back,
+	const UINT8 *translation, const UINT8 *colormap, const UINT8 *fullbright, const UINT8 *transmap)
+{
+	if (translation)
+	{
+		col = R_GatherBytes_AVX2(translation, col);
+	}
+
+	if (fullbright)
+	{
+		const __m256i isbright = _mm256_cmpeq_epi32(bright, _mm256_set1_epi32(BRIGHTPIXEL));
+		col = _mm256_blendv_epi8(R_GatherBytes_AVX2(colormap, col), R_GatherBytes_AVX2(fullbright, col), isbright);
+	}
+	else
+	{
+		col = R_GatherBytes_AVX2(colormap, col);
+	}
+
+	if (transmap)
+	{
+		col = R_GatherBytes_AVX2(transmap, _mm256_or_si256(_mm256_slli_epi32(col, 8), back));
+	}
+
+	return col;
+}
+
+/**	\brief The R_DrawSpan_AVX2 function
+	Same as R_DrawSpanTemplate, eight pixels at a time.
+*/
+template<DrawSpanType Type>
+AVX2_TARGET static void R_DrawSpanTemplate_AVX2(drawspandata_t* ds)
+{
+	static_assert(!(Type & (DS_HOLES|DS_SPRITE)), "masked spans are not vectorized");
+
+	fixed_t xposition;
+	fixed_t yposition;
+	fixed_t xstep, ystep;
+	UINT32 bit;
+
+	UINT8 *dest;
+	UINT8 *dsrc;
+
+	const UINT8 *deststop = screens[0] + vid.rowbytes * vid.height;
+
+	size_t count = (ds->x2 - ds->x1 + 1);
+
+	xposition = ds->xfrac; yposition = ds->yfrac;
+	xstep = ds->xstep; ystep = ds->ystep;
+
+	if constexpr (Type & DS_RIPPLE)
+	{
+		yposition += ds->waterofs;
+	}
+
+	xposition <<= ds->nflatshiftup; yposition <<= ds->nflatshiftup;
+	xstep <<= ds->nflatshiftup; ystep <<= ds->nflatshiftup;
+
+	dest = ylookup[ds->y] + columnofs[ds->x1];
+	if constexpr (Type & DS_RIPPLE)
+	{
+		dsrc = screens[1] + (ds->y + ds->bgofs) * vid.width + ds->x1;
+	}
+	else
+	{
+		dsrc = dest;
+	}
+
+	if (dest+8 > deststop)
+	{
+		return;
+	}
+
+	if (count >= 8)
+	{
+		const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+		const __m128i xshift = _mm_cvtsi32_si128((int)ds->nflatxshift);
+		const __m128i yshift = _mm_cvtsi32_si128((int)ds->nflatyshift);
+		const __m256i ymask = _mm256_set1_epi32((int)ds->nflatmask);
+		const __m256i xstep8 = _mm256_set1_epi32(xstep * 8);
+		const __m256i ystep8 = _mm256_set1_epi32(ystep * 8);
+
+		const UINT8 *translation = (Type & DS_COLORMAP) ? ds->translation : NULL;
+		const UINT8 *fullbright = (Type & DS_BRIGHTMAP) ? ds->fullbright : NULL;
+		const UINT8 *transmap = (Type & DS_TRANSMAP) ? ds->transmap : NULL;
+
+		__m256i xpos = _mm256_add_epi32(_mm256_set1_epi32(xposition), _mm256_mullo_epi32(lanes, _mm256_set1_epi32(xstep)));
+		__m256i ypos = _mm256_add_epi32(_mm256_set1_epi32(yposition), _mm256_mullo_epi32(lanes, _mm256_set1_epi32(ystep)));
+
+		while (count >= 8)
+		{
+			const __m256i bits = _mm256_or_si256(
+				_mm256_and_si256(_mm256_srl_epi32(ypos, yshift), ymask),
+				_mm256_srl_epi32(xpos, xshift)
+			);
+			__m256i bright = _mm256_setzero_si256();
+			__m256i back = _mm256_setzero_si256();
+
+			if constexpr (Type & DS_BRIGHTMAP)
+			{
+				bright = R_GatherBytes_AVX2(ds->brightmap, bits);
+			}
+
+			if constexpr (Type & DS_TRANSMAP)
+			{
+				back = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)dsrc));
+			}
+
+			R_StoreBytes_AVX2(dest, R_ShadePixels_AVX2(
+				R_GatherBytes_AVX2(ds->source, bits), bright, back,
+				translation, ds->colormap, fullbright, transmap
+			));
+
+			xpos = _mm256_add_epi32(xpos, xstep8);
+			ypos = _mm256_add_epi32(ypos, ystep8);
+			xposition += xstep * 8;
+			yposition += ystep * 8;
+
+			dest += 8;
+			dsrc += 8;
+
+			count -= 8;
+		}
+	}
+
+	while (count-- && dest <= deststop)
+	{
+		bit = (((UINT32)yposition >> ds->nflatyshift) & ds->nflatmask) | ((UINT32)xposition >> ds->nflatxshift);
+
+		*dest = R_DrawSpanPixel<Type>(ds, dsrc, ds->colormap, bit);
+
+		dest++;
+		dsrc++;
+
+		xposition += xstep;
+		yposition += ystep;
+	}
+}
+
+#define DEFINE_SIMD_SPAN_FUNC(name, flags) \
+	static void name(drawspandata_t *ds) \
+	{ \
+		ZoneScoped; \
+		constexpr DrawSpanType opt = static_cast<DrawSpanType>(flags); \
+		R_DrawSpanTemplate_AVX2<opt>(ds); \
+	}
+
+DEFINE_SIMD_SPAN_FUNC(R_DrawSpan_AVX2, DS_BASIC)
+DEFINE_SIMD_SPAN_FUNC(R_DrawSpan_Brightmap_AVX2, DS_BRIGHTMAP)
+DEFINE_SIMD_SPAN_FUNC(R_DrawTranslucentSpan_AVX2, DS_TRANSMAP)
+DEFINE_SIMD_SPAN_FUNC(R_DrawTranslucentSpan_Brightmap_AVX2, DS_TRANSMAP|DS_BRIGHTMAP)
+DEFINE_SIMD_SPAN_FUNC(R_DrawTranslucentWaterSpan_AVX2, DS_TRANSMAP|DS_RIPPLE)
+DEFINE_SIMD_SPAN_FUNC(R_DrawTranslucentWaterSpan_Brightmap_AVX2, DS_TRANSMAP|DS_RIPPLE|DS_BRIGHTMAP)
+
+static boolean R_CPUHasAVX2(void)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2");
+#elif defined(_MSC_VER)
+	int info[4];
+
+	__cpuid(info, 0);
+	if (info[0] < 7)
+		return false;
+
+	// The OS must also save the YMM registers.
+	__cpuid(info, 1);
+	if (!(info[2] & (1 << 27)) || (_xgetbv(0) & 6) != 6)
+		return false;
+
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#else
+	return false;
+#endif
+}
+
+#endif // R_DRAW_AVX2
+
+/**	\brief The R_SetSIMDDrawFuncs function
+	Swaps the common span drawers in the function tables
+	for vectorized ones, if the CPU supports them.
+*/
+void R_SetSIMDDrawFuncs(void)
+{
+#ifdef R_DRAW_AVX2
+	if (M_CheckParm("-nosimd") || !R_CPUHasAVX2())
+	{
+		return;
+	}
+
+	spanfuncs[BASEDRAWFUNC] = R_DrawSpan_AVX2;
+	spanfuncs[SPANDRAWFUNC_TRANS] = R_DrawTranslucentSpan_AVX2;
+	spanfuncs[SPANDRAWFUNC_WATER] = R_DrawTranslucentWaterSpan_AVX2;
+
+	spanfuncs_bm[BASEDRAWFUNC] = R_DrawSpan_Brightmap_AVX2;
+	spanfuncs_bm[SPANDRAWFUNC_TRANS] = R_DrawTranslucentSpan_Brightmap_AVX2;
+	spanfuncs_bm[SPANDRAWFUNC_WATER] = R_DrawTranslucentWaterSpan_Brightmap_AVX2;
+
+	CONS_Debug(DBG_RENDER, "R_SetSIMDDrawFuncs: using AVX2 drawers\n");
+#endif
+}
@@ -67,6 +67,13 @@ viewvars_t *newview = &pview_new[0];
 
 enum viewcontext_e viewcontext = VIEWCONTEXT_PLAYER1;
 
+// Bumped for every rendered frame by R_NewInterpolationFrame. Mobjs keep
+// their interpolated state for the frame being drawn, since the renderers
+// ask for it several times per frame; this tells them when it's stale.
+// Per frame rather than per tic, because things can be moved between
+// tics too (rewind previews while paused, for one).
+static UINT32 interpgeneration = 1;
+
 static levelinterpolator_t **levelinterpolators;
 static size_t levelinterpolators_len;
 static size_t levelinterpolators_size;
@@ -269,6 +276,12 @@ void R_InterpolateMobjState(mobj_t *mobj, fixed_t frac, interpmobjstate_t *out)
 		return;
 	}
 
+	if (mobj->interpgeneration == interpgeneration && mobj->interpfrac == frac)
+	{
+		*out = mobj->interp;
+		return;
+	}
+
 	out->x = R_LerpFixed(mobj->old_x, mobj->x, frac);
 	out->y = R_LerpFixed(mobj->old_y, mobj->y, frac);
 	out->z = R_LerpFixed(mobj->old_z, mobj->z, frac);
@@ -281,7 +294,11 @@ void R_InterpolateMobjState(mobj_t *mobj, fixed_t frac, interpmobjstate_t *out)
 	out->spritexoffset = mobj->spritexoffset;
 	out->spriteyoffset = mobj->spriteyoffset;
 
-	out->subsector = R_PointInSubsector(out->x, out->y);
+	// Most things don't move horizontally between tics
+	if (mobj->subsector && out->x == mobj->x && out->y == mobj->y)
+		out->subsector = mobj->subsector;
+	else
+		out->subsector = R_PointInSubsector(out->x, out->y);
 
 	if (mobj->player)
 	{
@@ -291,6 +308,10 @@ void R_InterpolateMobjState(mobj_t *mobj, fixed_t frac, interpmobjstate_t *out)
 	{
 		out->angle = mobj->resetinterp ? mobj->angle : R_LerpAngle(mobj->old_angle, mobj->angle, frac);
 	}
+
+	mobj->interp = *out;
+	mobj->interpgeneration = interpgeneration;
+	mobj->interpfrac = frac;
 }
 
 void R_InterpolatePrecipMobjState(precipmobj_t *mobj, fixed_t frac, interpmobjstate_t *out)
@@ -319,7 +340,11 @@ void R_InterpolatePrecipMobjState(precipmobj_t *mobj, fixed_t frac, interpmobjst
 	out->spritexoffset = R_LerpFixed(mobj->old_spritexoffset, mobj->spritexoffset, frac);
 	out->spriteyoffset = R_LerpFixed(mobj->old_spriteyoffset, mobj->spriteyoffset, frac);
 
-	out->subsector = R_PointInSubsector(out->x, out->y);
+	// Precipitation mostly falls straight down
+	if (mobj->subsector && out->x == mobj->x && out->y == mobj->y)
+		out->subsector = mobj->subsector;
+	else
+		out->subsector = R_PointInSubsector(out->x, out->y);
 
 	out->angle = R_LerpAngle(mobj->old_angle, mobj->angle, frac);
 }
@@ -710,9 +735,15 @@ void R_InitMobjInterpolators(void)
 	interpolated_mobjs_capacity = 0;
 }
 
+void R_NewInterpolationFrame(void)
+{
+	interpgeneration++;
+}
+
 void R_UpdateMobjInterpolators(void)
 {
 	size_t i;
+
 	for (i = 0; i < interpolated_mobjs_len; i++)
 	{
 		mobj_t *mobj = interpolated_mobjs[i];
@@ -746,6 +777,7 @@ void R_ResetMobjInterpolationState(mobj_t *mobj)
 	mobj->old_spriteyscale = mobj->spriteyscale;
 	mobj->old_spritexoffset = mobj->spritexoffset;
 	mobj->old_spriteyoffset = mobj->spriteyoffset;
+	mobj->interpgeneration = 0;
 
 	if (mobj->player)
 	{
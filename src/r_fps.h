@@ -63,19 +63,6 @@ struct viewvars_t {
 
 extern viewvars_t *newview;
 
-struct interpmobjstate_t {
-	fixed_t x;
-	fixed_t y;
-	fixed_t z;
-	subsector_t *subsector;
-	angle_t angle;
-	fixed_t scale;
-	fixed_t spritexscale;
-	fixed_t spriteyscale;
-	fixed_t spritexoffset;
-	fixed_t spriteyoffset;
-};
-
 // Level interpolators
 
 // The union tag for levelinterpolator_t
@@ -139,6 +126,8 @@ void R_SetViewContext(enum viewcontext_e _viewcontext);
 fixed_t R_InterpolateFixed(fixed_t from, fixed_t to);
 angle_t R_InterpolateAngle(angle_t from, angle_t to);
 
+// Drop interpolated mobj states kept from the previous frame
+void R_NewInterpolationFrame(void);
 // Evaluate the interpolated mobj state for the given mobj
 void R_InterpolateMobjState(mobj_t *mobj, fixed_t frac, interpmobjstate_t *out);
 // Evaluate the interpolated mobj state for the given precipmobj
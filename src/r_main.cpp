@@ -128,6 +128,7 @@ precise_t ps_sw_spritecliptime = 0;
 precise_t ps_sw_portaltime = 0;
 precise_t ps_sw_planetime = 0;
 precise_t ps_sw_maskedtime = 0;
+precise_t ps_sw_spritesorttime = 0;
 
 int ps_numbspcalls = 0;
 int ps_numsprites = 0;
@@ -1489,6 +1490,7 @@ static void R_RenderViewpoint(maskcount_t* mask, INT32 cachenum)
 
 	R_RenderFirstBSPNode(cachenum);
 	R_AddPrecipitationSprites();
+	R_AddParticleSprites();
 
 	Mask_Post(mask);
 }
@@ -1538,7 +1540,10 @@ void R_RenderPlayerView(void)
 	mytotal = 0;
 	ProfZeroTimer();
 #endif
-	ps_numbspcalls = ps_numpolyobjects = ps_numdrawnodes = 0;
+	ps_numbspcalls = ps_numpolyobjects = ps_numdrawnodes = ps_numsprites = 0;
+	ps_numvisplanes = ps_visplanemerges = 0;
+	ps_visplanelookups = ps_visplaneprobes = ps_visplanemaxchain = 0;
+	ps_sw_spritesorttime = 0;
 	ps_bsptime = I_GetPreciseTime();
 
 	srb2::ThreadPool::Sema tp_sema;
@@ -106,6 +106,7 @@ extern precise_t ps_sw_spritecliptime;
 extern precise_t ps_sw_portaltime;
 extern precise_t ps_sw_planetime;
 extern precise_t ps_sw_maskedtime;
+extern precise_t ps_sw_spritesorttime;
 
 extern int ps_numbspcalls;
 extern int ps_numsprites;
@@ -0,0 +1,262 @@
+// DR. ROBOTNIK'S RING RACERS
+//-----------------------------------------------------------------------------
+// Copyright (C) 2024 by Kart Krew
+//
+// This program is free software distributed under the
+// terms of the GNU General Public License, version 2.
+// See the 'LICENSE' file for more details.
+//-----------------------------------------------------------------------------
+/// \file  r_particle.cpp
+/// \brief Batched, visual-only particles
+
+#include "r_particle.h"
+
+#include "doomstat.h"
+#include "p_local.h"
+#include "p_mobj.h"
+#include "p_spec.h"
+
+particlepool_t particles;
+
+/*--------------------------------------------------
+	void R_ClearParticles(void)
+
+		See header file for description.
+--------------------------------------------------*/
+void R_ClearParticles(void)
+{
+	particles.count = 0;
+}
+
+/*--------------------------------------------------
+	boolean R_SpawnParticle(const particledef_t *def)
+
+		See header file for description.
+--------------------------------------------------*/
+boolean R_SpawnParticle(const particledef_t *def)
+{
+	const mobjinfo_t *info = NULL;
+	const state_t *st = NULL;
+	size_t i;
+
+	if (particles.count >= MAXPARTICLES)
+	{
+		return false;
+	}
+
+	if (def->type <= MT_NULL || def->type >= NUMMOBJTYPES)
+	{
+		return false;
+	}
+
+	info = &mobjinfo[def->type];
+
+	if (info->spawnstate == S_NULL)
+	{
+		return false;
+	}
+
+	st = &states[info->spawnstate];
+	i = particles.count++;
+
+	particles.x[i] = particles.oldx[i] = def->x;
+	particles.y[i] = particles.oldy[i] = def->y;
+	particles.z[i] = particles.oldz[i] = def->z;
+
+	particles.momx[i] = def->momx;
+	particles.momy[i] = def->momy;
+	particles.momz[i] = def->momz;
+
+	particles.floorz[i] = def->floorz;
+	particles.ceilingz[i] = def->ceilingz;
+	particles.scale[i] = def->scale;
+	particles.flip[i] = def->flip;
+
+	if (info->flags & MF_NOGRAVITY)
+	{
+		particles.gravity[i] = 0;
+	}
+	else
+	{
+		particles.gravity[i] = FixedMul(gravity, def->scale) * (def->flip ? 1 : -1);
+	}
+
+	particles.state[i] = static_cast<statenum_t>(info->spawnstate);
+	particles.tics[i] = st->tics;
+	particles.animtime[i] = 0;
+	particles.life[i] = 0;
+
+	particles.sprite[i] = st->sprite;
+	particles.frame[i] = st->frame;
+	particles.color[i] = def->color;
+
+	return true;
+}
+
+/*--------------------------------------------------
+	static void R_RemoveParticle(size_t i)
+
+		Removes a particle by moving the last one
+		in the pool into its slot.
+
+	Input Arguments:-
+		i - Index of the particle to remove.
+
+	Return:-
+		None
+--------------------------------------------------*/
+static void R_RemoveParticle(size_t i)
+{
+	const size_t last = --particles.count;
+
+	if (i == last)
+	{
+		return;
+	}
+
+	particles.x[i] = particles.x[last];
+	particles.y[i] = particles.y[last];
+	particles.z[i] = particles.z[last];
+	particles.oldx[i] = particles.oldx[last];
+	particles.oldy[i] = particles.oldy[last];
+	particles.oldz[i] = particles.oldz[last];
+	particles.momx[i] = particles.momx[last];
+	particles.momy[i] = particles.momy[last];
+	particles.momz[i] = particles.momz[last];
+	particles.floorz[i] = particles.floorz[last];
+	particles.ceilingz[i] = particles.ceilingz[last];
+	particles.gravity[i] = particles.gravity[last];
+	particles.scale[i] = particles.scale[last];
+	particles.state[i] = particles.state[last];
+	particles.tics[i] = particles.tics[last];
+	particles.animtime[i] = particles.animtime[last];
+	particles.life[i] = particles.life[last];
+	particles.sprite[i] = particles.sprite[last];
+	particles.frame[i] = particles.frame[last];
+	particles.color[i] = particles.color[last];
+	particles.flip[i] = particles.flip[last];
+}
+
+/*--------------------------------------------------
+	static boolean R_AnimateParticle(size_t i)
+
+		Advances a particle's state and FF_ANIMATE
+		frame. No state actions are called.
+
+	Input Arguments:-
+		i - Index of the particle to animate.
+
+	Return:-
+		false if the particle should be removed.
+--------------------------------------------------*/
+static boolean R_AnimateParticle(size_t i)
+{
+	const state_t *st = &states[particles.state[i]];
+
+	if (++particles.life[i] >= PARTICLE_MAXLIFE)
+	{
+		return false;
+	}
+
+	particles.animtime[i]++;
+
+	if (particles.tics[i] != -1 && --particles.tics[i] <= 0)
+	{
+		statenum_t next = st->nextstate;
+
+		if (next == S_NULL)
+		{
+			return false;
+		}
+
+		st = &states[next];
+
+		particles.state[i] = next;
+		particles.tics[i] = st->tics;
+		particles.animtime[i] = 0;
+		particles.sprite[i] = st->sprite;
+	}
+
+	particles.frame[i] = st->frame;
+
+	if ((st->frame & FF_ANIMATE) && st->var1 > 0 && st->var2 > 0)
+	{
+		particles.frame[i] += (particles.animtime[i] / st->var2) % (st->var1 + 1);
+	}
+
+	return true;
+}
+
+/*--------------------------------------------------
+	void R_RunParticles(void)
+
+		See header file for description.
+--------------------------------------------------*/
+void R_RunParticles(void)
+{
+	const size_t count = particles.count;
+	size_t i;
+
+	if (count == 0)
+	{
+		return;
+	}
+
+	// Interpolation history and movement are done in flat passes
+	// over each array, so the compiler can keep them tight.
+	for (i = 0; i < count; i++)
+	{
+		particles.oldx[i] = particles.x[i];
+		particles.oldy[i] = particles.y[i];
+		particles.oldz[i] = particles.z[i];
+	}
+
+	for (i = 0; i < count; i++)
+	{
+		particles.momz[i] += particles.gravity[i];
+	}
+
+	for (i = 0; i < count; i++)
+	{
+		particles.x[i] += particles.momx[i];
+		particles.y[i] += particles.momy[i];
+		particles.z[i] += particles.momz[i];
+	}
+
+	for (i = 0; i < count; i++)
+	{
+		boolean onground = false;
+
+		if (particles.z[i] < particles.floorz[i])
+		{
+			particles.z[i] = particles.floorz[i];
+			onground = !particles.flip[i];
+		}
+		else if (particles.z[i] > particles.ceilingz[i])
+		{
+			particles.z[i] = particles.ceilingz[i];
+			onground = particles.flip[i];
+		}
+		else
+		{
+			continue;
+		}
+
+		particles.momz[i] = 0;
+
+		if (onground)
+		{
+			particles.momx[i] = FixedMul(particles.momx[i], ORIG_FRICTION);
+			particles.momy[i] = FixedMul(particles.momy[i], ORIG_FRICTION);
+		}
+	}
+
+	// Walk backwards so that swap-removal never skips a particle.
+	for (i = count; i-- > 0;)
+	{
+		if (R_AnimateParticle(i) == false)
+		{
+			R_RemoveParticle(i);
+		}
+	}
+}
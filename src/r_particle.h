@@ -0,0 +1,107 @@
+// DR. ROBOTNIK'S RING RACERS
+//-----------------------------------------------------------------------------
+// Copyright (C) 2024 by Kart Krew
+//
+// This program is free software distributed under the
+// terms of the GNU General Public License, version 2.
+// See the 'LICENSE' file for more details.
+//-----------------------------------------------------------------------------
+/// \file  r_particle.h
+/// \brief Batched, visual-only particles
+
+#ifndef __R_PARTICLE_H__
+#define __R_PARTICLE_H__
+
+#include "doomtype.h"
+#include "doomdef.h"
+#include "info.h"
+#include "m_fixed.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Particles are purely cosmetic: they never touch the blockmap,
+// sector thing lists, Lua, netsaves or the game RNG, so they can
+// be spawned in bulk without affecting the simulation.
+#define MAXPARTICLES (4096)
+
+// Hard cap on how long one particle may live, in case
+// its state chain loops or never reaches S_NULL.
+#define PARTICLE_MAXLIFE (10*TICRATE)
+
+struct particledef_t
+{
+	mobjtype_t type; // Spawn state, flags and scale are read from this.
+	fixed_t x, y, z;
+	fixed_t momx, momy, momz;
+	fixed_t scale;
+	fixed_t floorz, ceilingz;
+	UINT16 color; // SKINCOLOR_NONE to leave uncolored.
+	boolean flip; // Falls towards the ceiling.
+};
+
+// Structure of arrays, so that the movement loops
+// in R_RunParticles touch only the fields they need.
+struct particlepool_t
+{
+	size_t count;
+
+	fixed_t x[MAXPARTICLES], y[MAXPARTICLES], z[MAXPARTICLES];
+	fixed_t oldx[MAXPARTICLES], oldy[MAXPARTICLES], oldz[MAXPARTICLES];
+	fixed_t momx[MAXPARTICLES], momy[MAXPARTICLES], momz[MAXPARTICLES];
+	fixed_t floorz[MAXPARTICLES], ceilingz[MAXPARTICLES];
+	fixed_t gravity[MAXPARTICLES]; // Per-tic momz change, already scaled and flipped.
+	fixed_t scale[MAXPARTICLES];
+
+	statenum_t state[MAXPARTICLES];
+	INT32 tics[MAXPARTICLES];
+	UINT16 animtime[MAXPARTICLES];
+	UINT16 life[MAXPARTICLES];
+
+	spritenum_t sprite[MAXPARTICLES];
+	UINT32 frame[MAXPARTICLES];
+	UINT16 color[MAXPARTICLES];
+	boolean flip[MAXPARTICLES];
+};
+
+extern particlepool_t particles;
+
+/*--------------------------------------------------
+	void R_ClearParticles(void);
+
+		Removes every particle. Called on level load.
+--------------------------------------------------*/
+
+void R_ClearParticles(void);
+
+/*--------------------------------------------------
+	boolean R_SpawnParticle(const particledef_t *def);
+
+		Adds a particle to the pool. State actions
+		are never called for particles.
+
+	Input Arguments:-
+		def - Initial properties of the particle.
+
+	Return:-
+		true if the particle was added, false if the
+		pool is full or the type has no spawn state.
+--------------------------------------------------*/
+
+boolean R_SpawnParticle(const particledef_t *def);
+
+/*--------------------------------------------------
+	void R_RunParticles(void);
+
+		Moves, animates and removes particles for
+		one game tic.
+--------------------------------------------------*/
+
+void R_RunParticles(void);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif/*__R_PARTICLE_H__*/
@@ -11,6 +11,8 @@
 /// \file  r_patch.c
 /// \brief Patch generation.
 
+#include <vector>
+
 #include "doomdef.h"
 #include "r_patch.h"
 #include "r_picformats.h"
@@ -64,6 +66,7 @@ patch_t *Patch_Create(softwarepatch_t *source, size_t srcsize, void *dest)
 }
 
 static boolean g_patch_was_freed_this_frame = false;
+static std::vector<const patch_t*> g_patches_freed_this_frame;
 
 //
 // Frees a patch from memory.
@@ -103,6 +106,7 @@ static void Patch_FreeData(patch_t *patch)
 	Z_Free(patch->columns);
 
 	g_patch_was_freed_this_frame = true;
+	g_patches_freed_this_frame.push_back(patch);
 }
 
 void Patch_Free(patch_t *patch)
@@ -119,9 +123,16 @@ boolean Patch_WasFreedThisFrame(void)
 	return g_patch_was_freed_this_frame;
 }
 
+const patch_t *const *Patch_GetFreedThisFrame(size_t *count)
+{
+	*count = g_patches_freed_this_frame.size();
+	return g_patches_freed_this_frame.data();
+}
+
 void Patch_ResetFreedThisFrame(void)
 {
 	g_patch_was_freed_this_frame = false;
+	g_patches_freed_this_frame.clear();
 }
 
 //
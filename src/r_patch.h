@@ -27,6 +27,9 @@ extern "C" {
 patch_t *Patch_Create(softwarepatch_t *source, size_t srcsize, void *dest);
 void Patch_Free(patch_t *patch);
 boolean Patch_WasFreedThisFrame(void);
+// The patches freed this frame, for caches that key on patch pointers.
+// Only the addresses are valid.
+const patch_t *const *Patch_GetFreedThisFrame(size_t *count);
 void Patch_ResetFreedThisFrame(void);
 
 #define Patch_FreeTag(tagnum) Patch_FreeTags(tagnum, tagnum)
@@ -48,6 +51,18 @@ patch_t *Patch_GetRotatedSprite(
 	boolean flip, boolean adjustfeet,
 	void *info, INT32 rotationangle);
 
+// Same as Patch_GetRotatedSprite, but if this angle isn't rotated yet,
+// it's done in the background and the closest ready angle is returned.
+patch_t *Patch_GetRotatedSpriteAsync(
+	spriteframe_t *sprite,
+	size_t frame, size_t spriteangle,
+	boolean flip, boolean adjustfeet,
+	void *info, INT32 rotationangle);
+
+void Patch_UpdateRotationQueue(void);
+void Patch_FlushRotationQueue(void);
+void Patch_QueueSkinRotations(void);
+
 INT32 R_GetRollAngle(angle_t rollangle);
 angle_t R_GetPitchRollAngle(mobj_t *mobj, player_t *viewPlayer);
 angle_t R_ModelRotationAngle(mobj_t *mobj, player_t *viewPlayer);
@@ -18,6 +18,15 @@
 #include "r_main.h" // R_PointToAngle
 #include "k_kart.h" // K_Sliptiding
 #include "p_tick.h"
+#include "r_skins.h"
+#include "g_game.h" // playeringame
+#include "d_netcmd.h" // timedemo_hash
+#include "g_demo.h" // demo.timing
+
+#ifdef HAVE_THREADS
+#include "i_threads.h"
+#include "core/thread_pool.h"
+#endif
 
 #ifdef ROTSPRITE
 fixed_t rollcosang[ROTANGLES];
@@ -117,11 +126,245 @@ patch_t *Patch_GetRotated(patch_t *patch, INT32 angle, boolean flip)
 	return rotsprite->patches[angle];
 }
 
-patch_t *Patch_GetRotatedSprite(
+static void RotatedPatch_GetSpritePivot(spriteinfo_t *sprinfo, size_t frame, patch_t *patch, INT32 *xpivot, INT32 *ypivot)
+{
+	if (in_bit_array(sprinfo->available, frame))
+	{
+		*xpivot = sprinfo->pivot[frame].x;
+		*ypivot = sprinfo->pivot[frame].y;
+	}
+	else if (in_bit_array(sprinfo->available, SPRINFO_DEFAULT_PIVOT))
+	{
+		*xpivot = sprinfo->pivot[SPRINFO_DEFAULT_PIVOT].x;
+		*ypivot = sprinfo->pivot[SPRINFO_DEFAULT_PIVOT].y;
+	}
+	else
+	{
+		*xpivot = patch->leftoffset;
+		*ypivot = patch->height / 2;
+	}
+}
+
+// Total size of the rotated patches made since the last flush
+static size_t rotatedbytes = 0;
+
+#ifdef HAVE_THREADS
+//
+// Background rotation
+//
+// Sprites seen at a new angle are rotated on the thread pool,
+// and the closest angle that's ready is drawn in the meantime.
+// Jobs are only started from Patch_UpdateRotationQueue, outside
+// of rendering, so they never hold up the renderer's own tasks.
+//
+
+#define MAXROTATIONJOBS 8 // In flight at once
+#define MAXROTATIONREQUESTS 1024
+
+typedef struct
+{
+	spriteframe_t *sprite;
+	spriteinfo_t *sprinfo;
+	size_t frame, spriteangle;
+	INT32 angle;
+	boolean flip, adjustfeet;
+} rotationrequest_t;
+
+typedef struct rotationjob_s
+{
+	rotsprite_t *rotsprite;
+	patch_t *patch;
+	INT32 angle, idx;
+	INT32 xpivot, ypivot;
+	boolean flip, adjustfeet;
+	rotatedraw_t raw;
+	struct rotationjob_s *next;
+} rotationjob_t;
+
+// Sprites seen this frame, in a ring buffer
+static rotationrequest_t rotationrequests[MAXROTATIONREQUESTS];
+static size_t rotationrequesthead = 0, numrotationrequests = 0;
+
+// Sprites queued on level load, done after everything that was seen
+static rotationrequest_t *rotationprecache = NULL;
+static size_t rotationprecachepos = 0, numrotationprecache = 0, maxrotationprecache = 0;
+
+static I_mutex rotationjob_mutex;
+static I_cond rotationjob_cond;
+static rotationjob_t *rotationjobsdone = NULL; // Protected by rotationjob_mutex
+static INT32 rotationjobsready = 0; // Jobs in rotationjobsdone, protected by rotationjob_mutex
+static INT32 rotationjobsinflight = 0; // Started and not finished yet, including rotationjobsready
+
+static rotsprite_t *RotatedPatch_GetSpriteRotations(spriteframe_t *sprite, size_t spriteangle, boolean adjustfeet)
+{
+	UINT8 type = (adjustfeet ? 1 : 0);
+
+	if (sprite->rotated[type][spriteangle] == NULL)
+		sprite->rotated[type][spriteangle] = RotatedPatch_Create(ROTANGLES);
+
+	return sprite->rotated[type][spriteangle];
+}
+
+// Finds the closest angle to this one that has already been rotated,
+// looking both ways around the circle. NULL means the unrotated sprite
+// (angle 0) is closest.
+static patch_t *RotatedPatch_GetNearest(rotsprite_t *rotsprite, INT32 angle, boolean flip)
+{
+	const INT32 n = rotsprite->angles;
+	INT32 base = (flip ? n : 0);
+	INT32 d;
+
+	for (d = 1; d <= n / 2; d++)
+	{
+		INT32 lo = (angle - d + n) % n;
+		INT32 hi = (angle + d) % n;
+
+		// Angle 0 isn't cached, it's the sprite itself
+		if (lo != 0 && rotsprite->patches[base + lo])
+			return rotsprite->patches[base + lo];
+
+		if (hi != 0 && rotsprite->patches[base + hi])
+			return rotsprite->patches[base + hi];
+
+		if (lo == 0 || hi == 0)
+			break;
+	}
+
+	return NULL;
+}
+
+static boolean RotatedPatch_CanQueue(void)
+{
+	// Frame hashes must not depend on thread timing
+	if (demo.timing && timedemo_hash)
+		return false;
+
+	return (numrotationrequests < MAXROTATIONREQUESTS);
+}
+
+static void RotatedPatch_RunJob(void *userdata)
+{
+	rotationjob_t *job = (rotationjob_t *)userdata;
+
+	RotatedPatch_Render(job->patch, job->angle, job->xpivot, job->ypivot, job->flip, &job->raw);
+
+	I_lock_mutex(&rotationjob_mutex);
+	job->next = rotationjobsdone;
+	rotationjobsdone = job;
+	rotationjobsready++;
+	I_wake_all_cond(&rotationjob_cond);
+	I_unlock_mutex(rotationjob_mutex);
+}
+
+static void RotatedPatch_StartJob(const rotationrequest_t *req, boolean precache)
+{
+	rotsprite_t *rotsprite = RotatedPatch_GetSpriteRotations(req->sprite, req->spriteangle, req->adjustfeet);
+	INT32 idx = req->angle + (req->flip ? rotsprite->angles : 0);
+	lumpnum_t lump = req->sprite->lumppat[req->spriteangle];
+	rotationjob_t *job;
+
+	if (precache)
+	{
+		if (rotsprite->patches[idx] || in_bit_array(rotsprite->queued, idx))
+			return;
+	}
+	else if (rotsprite->patches[idx])
+	{
+		unset_bit_array(rotsprite->queued, idx);
+		return;
+	}
+
+	if (lump == LUMPERROR)
+	{
+		unset_bit_array(rotsprite->queued, idx);
+		return;
+	}
+
+	job = malloc(sizeof *job);
+
+	if (job == NULL)
+	{
+		unset_bit_array(rotsprite->queued, idx);
+		return;
+	}
+
+	job->rotsprite = rotsprite;
+	job->patch = W_CachePatchNum(lump, PU_SPRITE);
+	job->angle = req->angle;
+	job->idx = idx;
+	job->flip = req->flip;
+	job->adjustfeet = req->adjustfeet;
+	job->next = NULL;
+	RotatedPatch_GetSpritePivot(req->sprinfo, req->frame, job->patch, &job->xpivot, &job->ypivot);
+
+	set_bit_array(rotsprite->queued, idx);
+	rotationjobsinflight++;
+
+	I_ThreadPoolSubmit(RotatedPatch_RunJob, job);
+}
+
+static void RotatedPatch_FinishJobs(boolean store)
+{
+	rotationjob_t *job;
+
+	I_lock_mutex(&rotationjob_mutex);
+	job = rotationjobsdone;
+	rotationjobsdone = NULL;
+	rotationjobsready = 0;
+	I_unlock_mutex(rotationjob_mutex);
+
+	while (job)
+	{
+		rotationjob_t *next = job->next;
+
+		if (store && job->rotsprite->patches[job->idx] == NULL)
+		{
+			RotatedPatch_Store(job->rotsprite, job->idx, &job->raw);
+
+			//BP: we cannot use special tric in hardware mode because feet in ground caused by z-buffer
+			if (job->adjustfeet && job->rotsprite->patches[job->idx])
+				((patch_t *)job->rotsprite->patches[job->idx])->topoffset += FEETADJUST>>FRACBITS;
+		}
+		else
+		{
+			free(job->raw.pixels);
+		}
+
+		unset_bit_array(job->rotsprite->queued, job->idx);
+		rotationjobsinflight--;
+		free(job);
+
+		job = next;
+	}
+}
+
+static void RotatedPatch_AddPrecache(spriteframe_t *sprite, spriteinfo_t *sprinfo, size_t frame, size_t spriteangle, INT32 angle)
+{
+	rotationrequest_t *req;
+
+	if (numrotationprecache >= maxrotationprecache)
+	{
+		maxrotationprecache = maxrotationprecache ? maxrotationprecache * 2 : 1024;
+		rotationprecache = Z_Realloc(rotationprecache, maxrotationprecache * sizeof *rotationprecache, PU_STATIC, NULL);
+	}
+
+	req = &rotationprecache[numrotationprecache++];
+	req->sprite = sprite;
+	req->sprinfo = sprinfo;
+	req->frame = frame;
+	req->spriteangle = spriteangle;
+	req->angle = angle;
+	req->flip = (sprite->flip & (1<<spriteangle)) != 0;
+	req->adjustfeet = false;
+}
+#endif
+
+static patch_t *RotatedPatch_GetSprite(
 	spriteframe_t *sprite,
 	size_t frame, size_t spriteangle,
 	boolean flip, boolean adjustfeet,
-	void *info, INT32 rotationangle)
+	void *info, INT32 rotationangle,
+	boolean async)
 {
 	rotsprite_t *rotsprite;
 	spriteinfo_t *sprinfo = (spriteinfo_t *)info;
@@ -151,32 +394,182 @@ patch_t *Patch_GetRotatedSprite(
 		if (lump == LUMPERROR)
 			return NULL;
 
+#ifdef HAVE_THREADS
+		if (async && in_bit_array(rotsprite->queued, idx))
+			return RotatedPatch_GetNearest(rotsprite, rotationangle, flip);
+
+		if (async && RotatedPatch_CanQueue())
+		{
+			rotationrequest_t *req = &rotationrequests[(rotationrequesthead + numrotationrequests) % MAXROTATIONREQUESTS];
+
+			req->sprite = sprite;
+			req->sprinfo = sprinfo;
+			req->frame = frame;
+			req->spriteangle = spriteangle;
+			req->angle = rotationangle;
+			req->flip = flip;
+			req->adjustfeet = adjustfeet;
+			numrotationrequests++;
+
+			set_bit_array(rotsprite->queued, idx);
+			return RotatedPatch_GetNearest(rotsprite, rotationangle, flip);
+		}
+#endif
+
 		patch = W_CachePatchNum(lump, PU_SPRITE);
+		RotatedPatch_GetSpritePivot(sprinfo, frame, patch, &xpivot, &ypivot);
+
+		RotatedPatch_DoRotation(rotsprite, patch, rotationangle, xpivot, ypivot, flip);
 
-		if (in_bit_array(sprinfo->available, frame))
+		//BP: we cannot use special tric in hardware mode because feet in ground caused by z-buffer
+		if (adjustfeet)
+			((patch_t *)rotsprite->patches[idx])->topoffset += FEETADJUST>>FRACBITS;
+	}
+
+	return rotsprite->patches[idx];
+}
+
+patch_t *Patch_GetRotatedSprite(
+	spriteframe_t *sprite,
+	size_t frame, size_t spriteangle,
+	boolean flip, boolean adjustfeet,
+	void *info, INT32 rotationangle)
+{
+	return RotatedPatch_GetSprite(sprite, frame, spriteangle, flip, adjustfeet, info, rotationangle, false);
+}
+
+patch_t *Patch_GetRotatedSpriteAsync(
+	spriteframe_t *sprite,
+	size_t frame, size_t spriteangle,
+	boolean flip, boolean adjustfeet,
+	void *info, INT32 rotationangle)
+{
+	return RotatedPatch_GetSprite(sprite, frame, spriteangle, flip, adjustfeet, info, rotationangle, true);
+}
+
+void Patch_UpdateRotationQueue(void)
+{
+#ifdef HAVE_THREADS
+	RotatedPatch_FinishJobs(true);
+
+	while (rotationjobsinflight < MAXROTATIONJOBS)
+	{
+		if (numrotationrequests)
 		{
-			xpivot = sprinfo->pivot[frame].x;
-			ypivot = sprinfo->pivot[frame].y;
+			RotatedPatch_StartJob(&rotationrequests[rotationrequesthead], false);
+			rotationrequesthead = (rotationrequesthead + 1) % MAXROTATIONREQUESTS;
+			numrotationrequests--;
 		}
-		else if (in_bit_array(sprinfo->available, SPRINFO_DEFAULT_PIVOT))
+		else if (rotationprecachepos < numrotationprecache && rotatedbytes < ROTSPRITE_PRECACHE_LIMIT)
 		{
-			xpivot = sprinfo->pivot[SPRINFO_DEFAULT_PIVOT].x;
-			ypivot = sprinfo->pivot[SPRINFO_DEFAULT_PIVOT].y;
+			RotatedPatch_StartJob(&rotationprecache[rotationprecachepos++], true);
 		}
 		else
 		{
-			xpivot = patch->leftoffset;
-			ypivot = patch->height / 2;
+			break;
 		}
+	}
+#endif
+}
 
-		RotatedPatch_DoRotation(rotsprite, patch, rotationangle, xpivot, ypivot, flip);
+void Patch_FlushRotationQueue(void)
+{
+#ifdef HAVE_THREADS
+	if (rotationjobsinflight > 0)
+	{
+		I_ThreadPoolWaitIdle();
+
+		// Jobs a worker already took aren't run by WaitIdle, and
+		// they write into memory that's about to be freed.
+		I_lock_mutex(&rotationjob_mutex);
+		while (rotationjobsready < rotationjobsinflight)
+			I_hold_cond(&rotationjob_cond, rotationjob_mutex);
+		I_unlock_mutex(rotationjob_mutex);
+	}
 
-		//BP: we cannot use special tric in hardware mode because feet in ground caused by z-buffer
-		if (adjustfeet)
-			((patch_t *)rotsprite->patches[idx])->topoffset += FEETADJUST>>FRACBITS;
+	RotatedPatch_FinishJobs(false);
+
+	// Nothing is rotating these anymore
+	while (numrotationrequests)
+	{
+		rotationrequest_t *req = &rotationrequests[rotationrequesthead];
+		rotsprite_t *rotsprite = RotatedPatch_GetSpriteRotations(req->sprite, req->spriteangle, req->adjustfeet);
+
+		unset_bit_array(rotsprite->queued, req->angle + (req->flip ? rotsprite->angles : 0));
+
+		rotationrequesthead = (rotationrequesthead + 1) % MAXROTATIONREQUESTS;
+		numrotationrequests--;
 	}
 
-	return rotsprite->patches[idx];
+	rotationrequesthead = 0;
+	rotationprecachepos = numrotationprecache = 0;
+#endif
+
+	rotatedbytes = 0;
+}
+
+void Patch_QueueSkinRotations(void)
+{
+#ifdef HAVE_THREADS
+	// Frames that karts commonly tilt or tumble in
+	static const playersprite_t spr2list[] = {
+		SPR2_STIN, SPR2_SLWN, SPR2_FSTN,
+		SPR2_DRLN, SPR2_DRRN,
+		SPR2_SPIN,
+	};
+	boolean skinqueued[MAXSKINS] = {false};
+	INT32 skinlist[MAXPLAYERS];
+	INT32 numskinlist = 0;
+	INT32 d, i;
+	size_t s, f, rot;
+
+	rotationprecachepos = numrotationprecache = 0;
+
+	for (i = 0; i < MAXPLAYERS; i++)
+	{
+		if (!playeringame[i] || players[i].spectator)
+			continue;
+
+		if (players[i].skin < 0 || players[i].skin >= numskins || skinqueued[players[i].skin])
+			continue;
+
+		skinqueued[players[i].skin] = true;
+		skinlist[numskinlist++] = players[i].skin;
+	}
+
+	// Small tilts from sliptiding and stairs are the most
+	// common, so queue every angle closest to upright first.
+	for (d = 1; d < ROTANGLES / 2; d++)
+	{
+		for (i = 0; i < numskinlist; i++)
+		{
+			skin_t *skin = &skins[skinlist[i]];
+
+			for (s = 0; s < sizeof spr2list / sizeof spr2list[0]; s++)
+			{
+				spritedef_t *sprdef = &skin->sprites[spr2list[s]];
+				spriteinfo_t *sprinfo = &skin->sprinfo[spr2list[s]];
+
+				for (f = 0; f < sprdef->numframes; f++)
+				{
+					spriteframe_t *sprframe = &sprdef->spriteframes[f];
+					size_t numrots = 8;
+
+					if (sprframe->rotate == SRF_SINGLE)
+						numrots = 1;
+					else if (sprframe->rotate & SRF_3DGE)
+						numrots = 16;
+
+					for (rot = 0; rot < numrots; rot++)
+					{
+						RotatedPatch_AddPrecache(sprframe, sprinfo, f, rot, d);
+						RotatedPatch_AddPrecache(sprframe, sprinfo, f, rot, ROTANGLES - d);
+					}
+				}
+			}
+		}
+	}
+#endif
 }
 
 void Patch_Rotate(patch_t *patch, INT32 angle, INT32 xpivot, INT32 ypivot, boolean flip)
@@ -191,6 +584,7 @@ rotsprite_t *RotatedPatch_Create(INT32 numangles)
 	rotsprite_t *rotsprite = Z_Calloc(sizeof(rotsprite_t), PU_STATIC, NULL);
 	rotsprite->angles = numangles;
 	rotsprite->patches = Z_Calloc(rotsprite->angles * 2 * sizeof(void *), PU_STATIC, NULL);
+	rotsprite->queued = Z_Calloc(BIT_ARRAY_SIZE(rotsprite->angles * 2), PU_STATIC, NULL);
 	return rotsprite;
 }
 
@@ -216,9 +610,8 @@ static void RotatedPatch_CalculateDimensions(
 	*newheight = max(height, max(h1, h2));
 }
 
-void RotatedPatch_DoRotation(rotsprite_t *rotsprite, patch_t *patch, INT32 angle, INT32 xpivot, INT32 ypivot, boolean flip)
+void RotatedPatch_Render(patch_t *patch, INT32 angle, INT32 xpivot, INT32 ypivot, boolean flip, rotatedraw_t *out)
 {
-	patch_t *rotated;
 	UINT16 *rawdst, *rawconv;
 	size_t size;
 	pictureflags_t bflip = (flip) ? PICFLAGS_XFLIP : 0;
@@ -231,27 +624,20 @@ void RotatedPatch_DoRotation(rotsprite_t *rotsprite, patch_t *patch, INT32 angle
 	fixed_t ca = rollcosang[angle];
 	fixed_t sa = rollsinang[angle];
 	fixed_t xcenter, ycenter;
-	INT32 idx = angle;
 	INT32 x, y;
 	INT32 sx, sy;
 	INT32 dx, dy;
 	INT32 ox, oy;
 	INT32 minx, miny, maxx, maxy;
 
-	// Don't cache angle = 0
-	if (angle < 1 || angle >= ROTANGLES)
-		return;
+	out->pixels = NULL;
 
 	if (flip)
 	{
-		idx += rotsprite->angles;
 		xpivot = width - xpivot;
 		leftoffset = width - leftoffset;
 	}
 
-	if (rotsprite->patches[idx])
-		return;
-
 	// Find the dimensions of the rotated patch.
 	RotatedPatch_CalculateDimensions(width, height, ca, sa, &newwidth, &newheight);
 
@@ -270,10 +656,13 @@ void RotatedPatch_DoRotation(rotsprite_t *rotsprite, patch_t *patch, INT32 angle
 	maxy = 0;
 
 	// Draw the rotated sprite to a temporary buffer.
+	// This may run on a worker thread, so the zone can't be used.
 	size = (newwidth * newheight);
 	if (!size)
 		size = (width * height);
-	rawdst = Z_Calloc(size * sizeof(UINT16), PU_STATIC, NULL);
+	rawdst = calloc(size, sizeof(UINT16));
+	if (rawdst == NULL)
+		return;
 
 	for (dy = 0; dy < newheight; dy++)
 	{
@@ -316,7 +705,12 @@ void RotatedPatch_DoRotation(rotsprite_t *rotsprite, patch_t *patch, INT32 angle
 		UINT16 *src, *dest;
 
 		size = (width * height);
-		rawconv = Z_Calloc(size * sizeof(UINT16), PU_STATIC, NULL);
+		rawconv = calloc(size, sizeof(UINT16));
+		if (rawconv == NULL)
+		{
+			free(rawdst);
+			return;
+		}
 
 		src = &rawdst[(miny * newwidth) + minx];
 		dest = rawconv;
@@ -332,7 +726,7 @@ void RotatedPatch_DoRotation(rotsprite_t *rotsprite, patch_t *patch, INT32 angle
 		ox -= minx;
 		oy -= miny;
 
-		Z_Free(rawdst);
+		free(rawdst);
 	}
 	else
 	{
@@ -341,14 +735,51 @@ void RotatedPatch_DoRotation(rotsprite_t *rotsprite, patch_t *patch, INT32 angle
 		height = newheight;
 	}
 
+	out->pixels = rawconv;
+	out->width = width;
+	out->height = height;
+	out->leftoffset = ox;
+	out->topoffset = oy;
+}
+
+void RotatedPatch_Store(rotsprite_t *rotsprite, INT32 idx, rotatedraw_t *raw)
+{
+	patch_t *rotated;
+
+	if (raw->pixels == NULL)
+		return;
+
 	// make patch
-	rotated = (patch_t *)Picture_Convert(PICFMT_FLAT16, rawconv, PICFMT_PATCH, 0, NULL, width, height, 0, 0, 0);
+	rotated = (patch_t *)Picture_Convert(PICFMT_FLAT16, raw->pixels, PICFMT_PATCH, 0, NULL, raw->width, raw->height, 0, 0, 0);
 
 	Z_ChangeTag(rotated, PU_PATCH_ROTATED);
 	Z_SetUser(rotated, (void **)(&rotsprite->patches[idx]));
-	Z_Free(rawconv);
+	free(raw->pixels);
+	raw->pixels = NULL;
+
+	rotated->leftoffset = raw->leftoffset;
+	rotated->topoffset = raw->topoffset;
+
+	// The column data, not the pixels, is what the precache limit is about
+	rotatedbytes += Z_Size(rotated) + Z_Size(rotated->columnofs) + Z_Size(rotated->columns);
+}
+
+void RotatedPatch_DoRotation(rotsprite_t *rotsprite, patch_t *patch, INT32 angle, INT32 xpivot, INT32 ypivot, boolean flip)
+{
+	rotatedraw_t raw;
+	INT32 idx = angle;
+
+	// Don't cache angle = 0
+	if (angle < 1 || angle >= ROTANGLES)
+		return;
+
+	if (flip)
+		idx += rotsprite->angles;
+
+	if (rotsprite->patches[idx])
+		return;
 
-	rotated->leftoffset = ox;
-	rotated->topoffset = oy;
+	RotatedPatch_Render(patch, angle, xpivot, ypivot, flip, &raw);
+	RotatedPatch_Store(rotsprite, idx, &raw);
 }
 #endif
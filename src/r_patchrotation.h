@@ -22,6 +22,22 @@ extern "C" {
 rotsprite_t *RotatedPatch_Create(INT32 numangles);
 void RotatedPatch_DoRotation(rotsprite_t *rotsprite, patch_t *patch, INT32 angle, INT32 xpivot, INT32 ypivot, boolean flip);
 
+// A rotated sprite before it is converted into a patch.
+// Rendering one of these is safe to do off the main thread.
+struct rotatedraw_t
+{
+	UINT16 *pixels; // PICFMT_FLAT16, allocated with malloc
+	INT32 width, height;
+	INT32 leftoffset, topoffset;
+};
+
+void RotatedPatch_Render(patch_t *patch, INT32 angle, INT32 xpivot, INT32 ypivot, boolean flip, rotatedraw_t *out);
+void RotatedPatch_Store(rotsprite_t *rotsprite, INT32 idx, rotatedraw_t *raw);
+
+// Skins' rotations are pre-rendered in the background
+// on level load, until this many bytes have been made.
+#define ROTSPRITE_PRECACHE_LIMIT (48<<20)
+
 extern fixed_t rollcosang[ROTANGLES];
 extern fixed_t rollsinang[ROTANGLES];
 
@@ -14,6 +14,8 @@
 ///        while maintaining a per column clipping list only.
 ///        Moreover, the sky areas have to be determined.
 
+#include <algorithm>
+
 #include <tracy/tracy/Tracy.hpp>
 
 #include "command.h"
@@ -58,9 +60,40 @@ visplane_t *ceilingplane;
 visffloor_t ffloor[MAXFFLOORS];
 INT32 numffloors;
 
-//SoM: 3/23/2000: Boom visplane hashing routine.
-#define visplane_hash(picnum,lightlevel,height) \
-  ((unsigned)((picnum)*3+(lightlevel)+(height)*7) & VISPLANEHASHMASK)
+// Visplanes come from here, and go back here at the start of every view.
+#define VISPLANEBLOCK 32
+
+int ps_numvisplanes;
+int ps_visplanemerges;
+int ps_visplanelookups, ps_visplaneprobes, ps_visplanemaxchain;
+
+static inline UINT32 visplane_mix(UINT32 h, UINT32 v)
+{
+	return h ^ (v + 0x9E3779B9u + (h << 6) + (h >> 2));
+}
+
+// Boom only hashed picnum, lightlevel and height, so floors with the same
+// flat at different heights or offsets piled up in a few chains. This
+// takes in everything R_FindPlane compares that can differ within a view.
+static inline unsigned visplane_hash(INT32 picnum, INT32 lightlevel, fixed_t height,
+	fixed_t xoffs, fixed_t yoffs, angle_t plangle, const extracolormap_t *colormap)
+{
+	UINT32 h = (UINT32)picnum;
+
+	h = visplane_mix(h, (UINT32)lightlevel);
+	h = visplane_mix(h, (UINT32)height);
+	h = visplane_mix(h, (UINT32)xoffs);
+	h = visplane_mix(h, (UINT32)yoffs);
+	h = visplane_mix(h, (UINT32)plangle);
+	h = visplane_mix(h, (UINT32)((uintptr_t)colormap >> 4));
+
+	// Fold the high bits down, since the mask only keeps the low ones
+	h ^= h >> 16;
+	h *= 0x85EBCA6Bu;
+	h ^= h >> 13;
+
+	return h & VISPLANEHASHMASK;
+}
 
 //SoM: 3/23/2000: Use boom opening limit removal
 size_t maxopenings;
@@ -319,26 +352,47 @@ void R_ClearPlanes(void)
 
 static visplane_t *new_visplane(unsigned hash)
 {
-	visplane_t *check = freetail;
-	if (!check)
-	{
-		check = static_cast<visplane_t*>(calloc(1, sizeof (*check)));
-		if (check == NULL) I_Error("%s: Out of memory", "new_visplane"); // FIXME: ugly
-	}
-	else
+	visplane_t *check;
+
+	if (!freetail)
 	{
-		freetail = freetail->next;
-		if (!freetail)
-			freehead = &freetail;
+		// Out of free visplanes, so add a block of them. They're never
+		// freed, and R_ClearPlanes gives them back for the next view.
+		visplane_t *block = static_cast<visplane_t*>(calloc(VISPLANEBLOCK, sizeof (*block)));
+		INT32 i;
+
+		if (block == NULL) I_Error("%s: Out of memory", "new_visplane"); // FIXME: ugly
+
+		for (i = 0; i < VISPLANEBLOCK - 1; i++)
+			block[i].next = &block[i + 1];
+
+		freetail = block;
+		freehead = &block[VISPLANEBLOCK - 1].next;
 	}
+
+	check = freetail;
+	freetail = freetail->next;
+	if (!freetail)
+		freehead = &freetail;
+
 	check->next = visplanes[hash];
 	visplanes[hash] = check;
 
 	g_renderstats.visplanes++;
+	ps_numvisplanes++;
 
 	return check;
 }
 
+// Only the columns of this view are used, so don't clear the rest.
+static void R_ClearPlaneColumns(visplane_t *pl)
+{
+	const size_t width = std::min<size_t>(viewwidth + 1, MAXVIDWIDTH);
+
+	memset(pl->top, 0xff, width * sizeof (*pl->top));
+	memset(pl->bottom, 0x00, width * sizeof (*pl->bottom));
+}
+
 //
 // R_FindPlane: Seek a visplane having the identical values:
 //              Same height, same flattexture, same lightlevel.
@@ -422,9 +476,17 @@ visplane_t *R_FindPlane(fixed_t height, INT32 picnum, INT32 lightlevel,
 
 	if (!pfloor)
 	{
-		hash = visplane_hash(picnum, lightlevel, height);
+		INT32 chain = 0;
+
+		hash = visplane_hash(picnum, lightlevel, height, xoff, yoff, plangle, planecolormap);
+		ps_visplanelookups++;
+
 		for (check = visplanes[hash]; check; check = check->next)
 		{
+			ps_visplaneprobes++;
+			if (++chain > ps_visplanemaxchain)
+				ps_visplanemaxchain = chain;
+
 			if (polyobj != check->polyobj)
 				continue;
 			if (height == check->height && picnum == check->picnum
@@ -439,6 +501,7 @@ visplane_t *R_FindPlane(fixed_t height, INT32 picnum, INT32 lightlevel,
 				&& check->ripple == ripple
 				&& check->damage == damage)
 			{
+				ps_visplanemerges++;
 				return check;
 			}
 		}
@@ -470,8 +533,7 @@ visplane_t *R_FindPlane(fixed_t height, INT32 picnum, INT32 lightlevel,
 	check->ripple = ripple;
 	check->damage = damage;
 
-	memset(check->top, 0xff, sizeof (check->top));
-	memset(check->bottom, 0x00, sizeof (check->bottom));
+	R_ClearPlaneColumns(check);
 
 	return check;
 }
@@ -516,6 +578,7 @@ visplane_t *R_CheckPlane(visplane_t *pl, INT32 start, INT32 stop)
 	{
 		pl->minx = unionl;
 		pl->maxx = unionh;
+		ps_visplanemerges++;
 	}
 	else /* Cannot use existing plane; create a new one */
 	{
@@ -527,7 +590,8 @@ visplane_t *R_CheckPlane(visplane_t *pl, INT32 start, INT32 stop)
 		else
 		{
 			unsigned hash =
-				visplane_hash(pl->picnum, pl->lightlevel, pl->height);
+				visplane_hash(pl->picnum, pl->lightlevel, pl->height,
+					pl->xoffs, pl->yoffs, pl->plangle, pl->extra_colormap);
 			new_pl = new_visplane(hash);
 		}
 
@@ -551,8 +615,7 @@ visplane_t *R_CheckPlane(visplane_t *pl, INT32 start, INT32 stop)
 		pl = new_pl;
 		pl->minx = start;
 		pl->maxx = stop;
-		memset(pl->top, 0xff, sizeof pl->top);
-		memset(pl->bottom, 0x00, sizeof pl->bottom);
+		R_ClearPlaneColumns(pl);
 	}
 	return pl;
 }
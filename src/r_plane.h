@@ -73,6 +73,11 @@ extern visplane_t *ceilingplane;
 extern INT16 *lastopening, *openings;
 extern size_t maxopenings;
 
+// Perfstats, reset every view
+extern int ps_numvisplanes;
+extern int ps_visplanemerges;
+extern int ps_visplanelookups, ps_visplaneprobes, ps_visplanemaxchain;
+
 extern INT16 floorclip[MAXVIDWIDTH], ceilingclip[MAXVIDWIDTH];
 extern fixed_t frontscale[MAXVIDWIDTH];
 extern fixed_t yslopetab[MAXSPLITSCREENPLAYERS][MAXVIDHEIGHT*16];
@@ -29,6 +29,12 @@
 #include "byteptr.h"
 #include "dehacked.h"
 #include "k_terrain.h"
+#include "d_main.h" // srb2home
+#include "md5.h"
+
+#ifdef HAVE_THREADS
+#include "core/thread_pool.h"
+#endif
 
 #ifdef HWRENDER
 #include "hardware/hw_glob.h" // HWR_LoadMapTextures
@@ -57,6 +63,63 @@ UINT8 **texturebrightmapcache; // graphics data for brightmap converted for use
 INT32 *texturewidth;
 fixed_t *textureheight; // needed for texture pegging
 
+// Generated textures are kept between levels. Once they take up
+// more than cv_texturecache megabytes, the least recently used
+// ones are freed at level load by R_TrimTextureCache.
+static size_t *texturecachesize; // size of each texturecache block
+static size_t *texturebrightmapcachesize; // size of each texturebrightmapcache block
+static UINT32 *texturecacheused; // texturecacheepoch of the last level that used each texture
+static UINT32 texturecacheepoch;
+static size_t texturecachetotal; // all of the above sizes, added up
+
+// Optional file that keeps generated textures between runs.
+// It is only valid for the exact set of loaded files, so the
+// key is made from the MD5 of every loaded file, in order.
+#define TEXTURECACHEFILE "texturecache.dat"
+#define TEXTURECACHEHEADER "RRTEXCACHE"
+#define TEXTURECACHEVERSION 1
+
+struct texturefileentry
+{
+	UINT32 offset, size; // 0 size means not in the file
+	UINT32 colofs; // texturecolumnofs, relative to the block
+	UINT8 holes, flip;
+};
+
+#define TEXTUREFILEENTRYSIZE (4+4+4+1+1)
+
+static FILE *texturecachefile;
+static struct texturefileentry *texturefileindex; // numtextures entries, if the file is valid
+static UINT8 texturefilekey[16];
+static UINT16 texturefilewads; // numwadfiles when the file was last checked
+static boolean texturefiledirty; // textures were generated that aren't in the file yet
+
+// Optional file that keeps the texture definitions between runs,
+// so that startup doesn't have to parse TEXTURES lumps or read
+// the size of every single patch texture. It is written right
+// after the textures are loaded, with the same key as above.
+#define TEXTUREDEFSFILE "texturedefs.dat"
+#define TEXTUREDEFSHEADER "RRTEXDEFS"
+#ifdef WALLFLATS
+#define TEXTUREDEFSVERSION 0x8001
+#else
+#define TEXTUREDEFSVERSION 1
+#endif
+
+#define TEXTUREDEFSENTRYSIZE (8+1+2+2+1+2)
+#define TEXTUREDEFSPATCHSIZE (2+2+2+2+1+1+1)
+
+static boolean texturedefswarned; // definitions made warnings, don't keep them
+
+// TEXTURES lumps are parsed once, when counting the textures,
+// and the results wait here until they are defined.
+static struct
+{
+	texture_t *texture;
+	UINT16 wad;
+} *parsedtextures;
+static size_t numparsedtextures, maxparsedtextures, nextparsedtexture;
+
 INT32 *texturetranslation;
 INT32 *texturebrightmaps;
 
@@ -252,19 +315,40 @@ static inline void R_DrawBlendFlippedColumnInCache(column_t *patch, UINT8 *cache
 	}
 }
 
-static UINT8 *R_AllocateTextureBlock(size_t blocksize, UINT8 **user)
+static UINT8 *R_AllocateTextureBlock(size_t texnum, size_t blocksize, boolean brightmap)
 {
+	UINT8 **user = brightmap ? &texturebrightmapcache[texnum] : &texturecache[texnum];
+	size_t *size = brightmap ? &texturebrightmapcachesize[texnum] : &texturecachesize[texnum];
+
 	texturememory += blocksize;
 
-	return Z_Malloc(blocksize, PU_LEVEL, user);
+	texturecachetotal += blocksize;
+	*size = blocksize;
+	texturecacheused[texnum] = texturecacheepoch;
+
+	return Z_Malloc(blocksize, PU_TEXTURE, user);
 }
 
-static UINT8 *R_AllocateDummyTextureBlock(size_t width, UINT8 **user)
+static void R_FreeTextureBlock(size_t texnum, boolean brightmap)
+{
+	UINT8 **block = brightmap ? &texturebrightmapcache[texnum] : &texturecache[texnum];
+	size_t *size = brightmap ? &texturebrightmapcachesize[texnum] : &texturecachesize[texnum];
+
+	if (*block == NULL)
+		return;
+
+	texturecachetotal -= *size;
+	*size = 0;
+
+	Z_Free(*block); // Z_Free clears the user
+}
+
+static UINT8 *R_AllocateDummyTextureBlock(size_t texnum, size_t width, boolean brightmap)
 {
 	// Allocate dummy data. Keep 4-bytes aligned.
 	// Column offsets will be initialized to 0, which points to the 0xff byte (empty column flag).
 	size_t blocksize = 4 + (width * 4);
-	UINT8 *block = R_AllocateTextureBlock(blocksize, user);
+	UINT8 *block = R_AllocateTextureBlock(texnum, blocksize, brightmap);
 
 	memset(block, 0, blocksize);
 	block[0] = 0xff;
@@ -296,18 +380,349 @@ static boolean R_CheckTextureLumpLength(texture_t *texture, size_t patch)
 	return true;
 }
 
+// A composite texture that has been allocated,
+// but still needs its patches to be drawn in.
+struct texturecomposite
+{
+	size_t texnum;
+	UINT8 *block;
+	softwarepatch_t **patches; // NULL for patches outside of the texture
+	boolean *dealloc;
+};
+
 //
-// R_GenerateTexture
+// R_MakeTextureFileKey
+//
+// Makes the key for the texture cache files out of
+// the MD5 of every loaded file, in order.
+//
+static boolean R_MakeTextureFileKey(UINT8 *key)
+{
+#ifdef NOMD5
+	// Every file would have the same key.
+	(void)key;
+	return false;
+#else
+	UINT8 *sums;
+	INT32 i;
+
+	sums = malloc(numwadfiles * 16);
+	if (sums == NULL)
+		return false;
+
+	for (i = 0; i < numwadfiles; i++)
+		M_Memcpy(&sums[i * 16], wadfiles[i]->md5sum, 16);
+
+	md5_buffer((const char *)sums, numwadfiles * 16, key);
+	free(sums);
+
+	return true;
+#endif
+}
+
+//
+// R_CheckTextureCacheFile
+//
+// Opens the texture cache file and reads its index,
+// if it was made for the files that are loaded now.
+//
+static void R_CheckTextureCacheFile(void)
+{
+	if (texturefilewads == numwadfiles)
+		return;
+
+	texturefilewads = numwadfiles;
+
+	if (texturecachefile)
+	{
+		fclose(texturecachefile);
+		texturecachefile = NULL;
+	}
+
+	Z_Free(texturefileindex);
+	texturefileindex = NULL;
+
+#ifdef NOMD5
+	// Every file would have the same key.
+	return;
+#else
+	char header[sizeof TEXTURECACHEHEADER - 1];
+	UINT8 filekey[16];
+	UINT8 buf[TEXTUREFILEENTRYSIZE];
+	UINT16 version;
+	UINT32 count;
+	INT32 i;
+
+	if (!R_MakeTextureFileKey(texturefilekey))
+		return;
+
+	texturecachefile = fopen(va(pandf, srb2home, TEXTURECACHEFILE), "rb");
+	if (texturecachefile == NULL)
+		return;
+
+	if (fread(header, 1, sizeof header, texturecachefile) != sizeof header
+		|| memcmp(header, TEXTURECACHEHEADER, sizeof header)
+		|| fread(&version, sizeof version, 1, texturecachefile) != 1
+		|| SHORT(version) != TEXTURECACHEVERSION
+		|| fread(filekey, 1, sizeof filekey, texturecachefile) != sizeof filekey
+		|| memcmp(filekey, texturefilekey, sizeof filekey)
+		|| fread(&count, sizeof count, 1, texturecachefile) != 1
+		|| (UINT32)LONG(count) != (UINT32)numtextures)
+	{
+		// Made for something else, it will be overwritten on quit.
+		fclose(texturecachefile);
+		texturecachefile = NULL;
+		return;
+	}
+
+	texturefileindex = Z_Malloc(numtextures * sizeof(*texturefileindex), PU_STATIC, NULL);
+
+	for (i = 0; i < numtextures; i++)
+	{
+		UINT8 *p = buf;
+
+		if (fread(buf, 1, sizeof buf, texturecachefile) != sizeof buf)
+		{
+			CONS_Alert(CONS_WARNING, "%s is truncated, ignoring it\n", TEXTURECACHEFILE);
+			fclose(texturecachefile);
+			texturecachefile = NULL;
+			Z_Free(texturefileindex);
+			texturefileindex = NULL;
+			return;
+		}
+
+		texturefileindex[i].offset = READUINT32(p);
+		texturefileindex[i].size = READUINT32(p);
+		texturefileindex[i].colofs = READUINT32(p);
+		texturefileindex[i].holes = READUINT8(p);
+		texturefileindex[i].flip = READUINT8(p);
+	}
+#endif
+}
+
+//
+// R_ReadCachedTexture
+//
+// Loads a texture that was generated on a previous run.
+//
+static boolean R_ReadCachedTexture(size_t texnum)
+{
+	const struct texturefileentry *entry;
+	UINT8 *block;
+
+	R_CheckTextureCacheFile();
+
+	if (texturefileindex == NULL)
+		return false;
+
+	entry = &texturefileindex[texnum];
+
+	if (entry->size == 0 || entry->colofs >= entry->size)
+		return false;
+
+	block = R_AllocateTextureBlock(texnum, entry->size, false);
+
+	if (fseek(texturecachefile, entry->offset, SEEK_SET) != 0
+		|| fread(block, 1, entry->size, texturecachefile) != entry->size)
+	{
+		R_FreeTextureBlock(texnum, false);
+		return false;
+	}
+
+	textures[texnum]->holes = entry->holes;
+	textures[texnum]->flip = entry->flip;
+	texturecolumnofs[texnum] = (UINT32 *)(block + entry->colofs);
+
+	return true;
+}
+
+//
+// R_PrepareTextureComposite
+//
+// Allocates a composite texture and reads its patches.
+// This touches the zone, so it must be called from the main thread.
+//
+static void R_PrepareTextureComposite(size_t texnum, struct texturecomposite *composite)
+{
+	texture_t *texture = textures[texnum];
+	texpatch_t *patch;
+	softwarepatch_t *realpatch;
+	UINT8 *pdata;
+	int i, width, height;
+	size_t blocksize;
+
+	UINT16 wadnum;
+	lumpnum_t lumpnum;
+	size_t lumplength;
+
+	texture->holes = false;
+	texture->flip = 0;
+	blocksize = (texture->width * 4) + (texture->width * texture->height);
+
+	composite->texnum = texnum;
+	composite->block = R_AllocateTextureBlock(texnum, blocksize+1, false);
+	composite->patches = NULL;
+	composite->dealloc = NULL;
+
+	memset(composite->block, TRANSPARENTPIXEL, blocksize+1); // Transparency hack
+
+	// columns lookup table
+	texturecolumnofs[texnum] = (UINT32 *)composite->block;
+
+	if (texture->patchcount <= 0)
+		return;
+
+	composite->patches = Z_Calloc(texture->patchcount * sizeof(*composite->patches), PU_STATIC, NULL);
+	composite->dealloc = Z_Calloc(texture->patchcount * sizeof(*composite->dealloc), PU_STATIC, NULL);
+
+	for (i = 0, patch = texture->patches; i < texture->patchcount; i++, patch++)
+	{
+		boolean dealloc = true;
+
+		wadnum = patch->wad;
+		lumpnum = patch->lump;
+		pdata = W_CacheLumpNumPwad(wadnum, lumpnum, PU_LEVEL);
+		lumplength = W_LumpLengthPwad(wadnum, lumpnum);
+		realpatch = (softwarepatch_t *)pdata;
+
+#ifndef NO_PNG_LUMPS
+		if (Picture_IsLumpPNG((UINT8 *)realpatch, lumplength))
+			realpatch = (softwarepatch_t *)Picture_PNGConvert((UINT8 *)realpatch, PICFMT_DOOMPATCH, NULL, NULL, NULL, NULL, lumplength, NULL, 0);
+		else
+#endif
+#ifdef WALLFLATS
+		if (texture->type == TEXTURETYPE_FLAT)
+			realpatch = (softwarepatch_t *)Picture_Convert(PICFMT_FLAT, pdata, PICFMT_DOOMPATCH, 0, NULL, texture->width, texture->height, 0, 0, 0);
+		else
+#endif
+		{
+			(void)lumplength;
+			dealloc = false;
+		}
+
+		width = SHORT(realpatch->width);
+		height = SHORT(realpatch->height);
+
+		if (patch->originx > texture->width || patch->originx + width < 0 // patch not located within texture's x bounds, ignore
+			|| patch->originy > texture->height || (patch->originy + height) < 0) // patch not located within texture's y bounds, ignore
+		{
+			if (dealloc)
+				Z_Free(realpatch);
+			continue;
+		}
+
+		composite->patches[i] = realpatch;
+		composite->dealloc[i] = dealloc;
+	}
+}
+
+//
+// R_DrawTextureComposite
+//
+// Composites the patches read by R_PrepareTextureComposite together.
+// Only the texture's own block is written, so this is safe to run
+// on any thread.
+//
+static void R_DrawTextureComposite(struct texturecomposite *composite)
+{
+	texture_t *texture = textures[composite->texnum];
+	UINT8 *block = composite->block;
+	UINT8 *colofs = block;
+	texpatch_t *patch;
+	softwarepatch_t *realpatch;
+	int x, x1, x2, i, width, height;
+	column_t *patchcol;
+
+	// Composite the columns together.
+	for (i = 0, patch = texture->patches; i < texture->patchcount; i++, patch++)
+	{
+		void (*ColumnDrawerPointer)(column_t *, UINT8 *, texpatch_t *, INT32, INT32); // Column drawing function pointer.
+
+		realpatch = composite->patches[i];
+		if (realpatch == NULL)
+			continue;
+
+		if (patch->style != AST_COPY)
+			ColumnDrawerPointer = (patch->flip & 2) ? R_DrawBlendFlippedColumnInCache : R_DrawBlendColumnInCache;
+		else
+			ColumnDrawerPointer = (patch->flip & 2) ? R_DrawFlippedColumnInCache : R_DrawColumnInCache;
+
+		x1 = patch->originx;
+		width = SHORT(realpatch->width);
+		height = SHORT(realpatch->height);
+		x2 = x1 + width;
+
+		// patch is actually inside the texture!
+		// now check if texture is partly off-screen and adjust accordingly
+
+		// left edge
+		if (x1 < 0)
+			x = 0;
+		else
+			x = x1;
+
+		// right edge
+		if (x2 > texture->width)
+			x2 = texture->width;
+
+		for (; x < x2; x++)
+		{
+			if (patch->flip & 1)
+				patchcol = (column_t *)((UINT8 *)realpatch + LONG(realpatch->columnofs[(x1+width-1)-x]));
+			else
+				patchcol = (column_t *)((UINT8 *)realpatch + LONG(realpatch->columnofs[x-x1]));
+
+			// generate column ofset lookup
+			*(UINT32 *)&colofs[x<<2] = LONG((x * texture->height) + (texture->width*4));
+			ColumnDrawerPointer(patchcol, block + LONG(*(UINT32 *)&colofs[x<<2]), patch, texture->height, height);
+		}
+	}
+}
+
+#ifdef HAVE_THREADS
+static void R_DrawTextureCompositeThunk(void *data)
+{
+	R_DrawTextureComposite(data);
+}
+#endif
+
+//
+// R_FinishTextureComposite
+//
+// Frees the patches that were converted for compositing.
+//
+static void R_FinishTextureComposite(struct texturecomposite *composite)
+{
+	INT32 i;
+
+	if (composite->patches == NULL)
+		return;
+
+	for (i = 0; i < textures[composite->texnum]->patchcount; i++)
+	{
+		if (composite->dealloc[i])
+			Z_Free(composite->patches[i]);
+	}
+
+	Z_Free(composite->patches);
+	Z_Free(composite->dealloc);
+}
+
+//
+// R_GenerateTextureEx
 //
 // Allocate space for full size texture, either single patch or 'composite'
 // Build the full textures from patches.
 // The texture caching system is a little more hungry of memory, but has
 // been simplified for the sake of highcolor (lol), dynamic ligthing, & speed.
 //
-// This is not optimised, but it's supposed to be executed only once
-// per level, when enough memory is available.
+// Textures are kept between levels, see R_TrimTextureCache.
 //
-UINT8 *R_GenerateTexture(size_t texnum)
+// If defer is not NULL and the texture is a composite, its patches are
+// left for the caller to draw with R_DrawTextureComposite, and defer->block
+// is set. Otherwise, defer->block is left alone.
+//
+static UINT8 *R_GenerateTextureEx(size_t texnum, struct texturecomposite *defer)
 {
 	UINT8 *block;
 	UINT8 *blocktex;
@@ -315,19 +730,28 @@ UINT8 *R_GenerateTexture(size_t texnum)
 	texpatch_t *patch;
 	softwarepatch_t *realpatch;
 	UINT8 *pdata;
-	int x, x1, x2, i, width, height;
+	int x;
 	size_t blocksize;
-	column_t *patchcol;
 	UINT8 *colofs;
 
 	UINT16 wadnum;
 	lumpnum_t lumpnum;
 	size_t lumplength;
 
+	struct texturecomposite composite;
+
 	I_Assert(texnum <= (size_t)numtextures);
 	texture = textures[texnum];
 	I_Assert(texture != NULL);
 
+	if (cv_texturecachefile.value && R_ReadCachedTexture(texnum))
+	{
+		block = texturecache[texnum];
+		return texture->holes ? block : block + (texture->width*4);
+	}
+
+	texturefiledirty = true;
+
 	// allocate texture column offset lookup
 
 	// single-patch textures can have holes in them and may be used on
@@ -346,7 +770,7 @@ UINT8 *R_GenerateTexture(size_t texnum)
 		// The header does not exist
 		if (R_CheckTextureLumpLength(texture, 0) == false)
 		{
-			block = R_AllocateDummyTextureBlock(texture->width, &texturecache[texnum]);
+			block = R_AllocateDummyTextureBlock(texnum, texture->width, false);
 			texturecolumnofs[texnum] = (UINT32*)&block[4];
 			textures[texnum]->holes = true;
 			return block;
@@ -393,10 +817,8 @@ UINT8 *R_GenerateTexture(size_t texnum)
 			texture->holes = true;
 			texture->flip = patch->flip;
 			blocksize = lumplength;
-			block = Z_Calloc(blocksize, PU_LEVEL, // will change tag at end of this function
-				&texturecache[texnum]);
+			block = R_AllocateTextureBlock(texnum, blocksize, false);
 			M_Memcpy(block, realpatch, blocksize);
-			texturememory += blocksize;
 
 			// use the patch's column lookup
 			colofs = (block + 8);
@@ -420,105 +842,115 @@ UINT8 *R_GenerateTexture(size_t texnum)
 
 	// multi-patch textures (or 'composite')
 	multipatch:
-	texture->holes = false;
-	texture->flip = 0;
-	blocksize = (texture->width * 4) + (texture->width * texture->height);
-	texturememory += blocksize;
-	block = Z_Malloc(blocksize+1, PU_LEVEL, &texturecache[texnum]);
-
-	memset(block, TRANSPARENTPIXEL, blocksize+1); // Transparency hack
-
-	// columns lookup table
-	colofs = block;
-	texturecolumnofs[texnum] = (UINT32 *)colofs;
+	R_PrepareTextureComposite(texnum, &composite);
 
 	// texture data after the lookup table
-	blocktex = block + (texture->width*4);
+	blocktex = composite.block + (texture->width*4);
 
-	// Composite the columns together.
-	for (i = 0, patch = texture->patches; i < texture->patchcount; i++, patch++)
+	if (defer)
 	{
-		boolean dealloc = true;
-		static void (*ColumnDrawerPointer)(column_t *, UINT8 *, texpatch_t *, INT32, INT32); // Column drawing function pointer.
-		if (patch->style != AST_COPY)
-			ColumnDrawerPointer = (patch->flip & 2) ? R_DrawBlendFlippedColumnInCache : R_DrawBlendColumnInCache;
-		else
-			ColumnDrawerPointer = (patch->flip & 2) ? R_DrawFlippedColumnInCache : R_DrawColumnInCache;
+		*defer = composite;
+		goto done;
+	}
 
-		wadnum = patch->wad;
-		lumpnum = patch->lump;
-		pdata = W_CacheLumpNumPwad(wadnum, lumpnum, PU_LEVEL);
-		lumplength = W_LumpLengthPwad(wadnum, lumpnum);
-		realpatch = (softwarepatch_t *)pdata;
-		dealloc = true;
+	R_DrawTextureComposite(&composite);
+	R_FinishTextureComposite(&composite);
 
-#ifndef NO_PNG_LUMPS
-		if (Picture_IsLumpPNG((UINT8 *)realpatch, lumplength))
-			realpatch = (softwarepatch_t *)Picture_PNGConvert((UINT8 *)realpatch, PICFMT_DOOMPATCH, NULL, NULL, NULL, NULL, lumplength, NULL, 0);
-		else
+done:
+	return blocktex;
+}
+
+//
+// R_GenerateTexture
+//
+// Generates a texture right away. See R_GenerateTextureEx.
+//
+UINT8 *R_GenerateTexture(size_t texnum)
+{
+	return R_GenerateTextureEx(texnum, NULL);
+}
+
+//
+// R_FinishTextureComposites
+//
+// Waits for the composites submitted by R_GenerateTextures.
+// Workers can still be drawing them after I_ThreadPoolWaitIdle,
+// so the batch is counted with a sema instead.
+//
+static void R_FinishTextureComposites(struct texturecomposite *composites, size_t count)
+{
+	size_t i;
+
+#ifdef HAVE_THREADS
+	I_ThreadPoolWaitSema();
 #endif
-#ifdef WALLFLATS
-		if (texture->type == TEXTURETYPE_FLAT)
-			realpatch = (softwarepatch_t *)Picture_Convert(PICFMT_FLAT, pdata, PICFMT_DOOMPATCH, 0, NULL, texture->width, texture->height, 0, 0, 0);
-		else
+
+	for (i = 0; i < count; i++)
+		R_FinishTextureComposite(&composites[i]);
+}
+
+//
+// R_GenerateTextures
+//
+// Generates every texture in present that isn't cached yet.
+// The patches are read on this thread, then the compositing
+// is spread out across the thread pool.
+//
+#define TEXTURECOMPOSITEBATCH 256
+
+void R_GenerateTextures(const char *present)
+{
+	struct texturecomposite *composites;
+	size_t count = 0;
+	INT32 i;
+
+	composites = Z_Malloc(TEXTURECOMPOSITEBATCH * sizeof(*composites), PU_STATIC, NULL);
+
+#ifdef HAVE_THREADS
+	I_ThreadPoolBeginSema();
 #endif
-		{
-			(void)lumplength;
-			dealloc = false;
-		}
 
-		x1 = patch->originx;
-		width = SHORT(realpatch->width);
-		height = SHORT(realpatch->height);
-		x2 = x1 + width;
+	for (i = 0; i < numtextures; i++)
+	{
+		if (!present[i])
+			continue;
 
-		if (x1 > texture->width || x2 < 0)
-		{
-			if (dealloc)
-				Z_Free(realpatch);
-			continue; // patch not located within texture's x bounds, ignore
-		}
+		texturecacheused[i] = texturecacheepoch;
 
-		if (patch->originy > texture->height || (patch->originy + height) < 0)
-		{
-			if (dealloc)
-				Z_Free(realpatch);
-			continue; // patch not located within texture's y bounds, ignore
-		}
+		if (texturecache[i])
+			continue;
 
-		// patch is actually inside the texture!
-		// now check if texture is partly off-screen and adjust accordingly
+		composites[count].block = NULL;
+		R_GenerateTextureEx(i, &composites[count]);
 
-		// left edge
-		if (x1 < 0)
-			x = 0;
-		else
-			x = x1;
+		// Single patch, or read from the cache file
+		if (composites[count].block == NULL)
+			continue;
 
-		// right edge
-		if (x2 > texture->width)
-			x2 = texture->width;
+#ifdef HAVE_THREADS
+		I_ThreadPoolSubmit(R_DrawTextureCompositeThunk, &composites[count]);
+#else
+		R_DrawTextureComposite(&composites[count]);
+#endif
 
-		for (; x < x2; x++)
+		// Don't hold on to too many converted patches at once.
+		if (++count == TEXTURECOMPOSITEBATCH)
 		{
-			if (patch->flip & 1)
-				patchcol = (column_t *)((UINT8 *)realpatch + LONG(realpatch->columnofs[(x1+width-1)-x]));
-			else
-				patchcol = (column_t *)((UINT8 *)realpatch + LONG(realpatch->columnofs[x-x1]));
+			R_FinishTextureComposites(composites, count);
+			count = 0;
 
-			// generate column ofset lookup
-			*(UINT32 *)&colofs[x<<2] = LONG((x * texture->height) + (texture->width*4));
-			ColumnDrawerPointer(patchcol, block + LONG(*(UINT32 *)&colofs[x<<2]), patch, texture->height, height);
+#ifdef HAVE_THREADS
+			I_ThreadPoolBeginSema();
+#endif
 		}
-
-		if (dealloc)
-			Z_Free(realpatch);
 	}
 
-done:
-	return blocktex;
+	R_FinishTextureComposites(composites, count);
+	Z_Free(composites);
 }
 
+#undef TEXTURECOMPOSITEBATCH
+
 //
 // R_GenerateTextureAsFlat
 //
@@ -739,7 +1171,7 @@ UINT8 *R_GenerateTextureBrightmap(size_t texnum)
 
 	if (R_CheckTextureLumpLength(texture, 0) == false)
 	{
-		return R_AllocateDummyTextureBlock(texture->width, &texturebrightmapcache[texnum]);
+		return R_AllocateDummyTextureBlock(texnum, texture->width, true);
 	}
 
 	R_CheckTextureCache(texnum);
@@ -765,8 +1197,9 @@ UINT8 *R_GenerateTextureBrightmap(size_t texnum)
 	if (texture->holes)
 	{
 		block = R_AllocateTextureBlock(
+				texnum,
 				W_LumpLengthPwad(texture->patches[0].wad, texture->patches[0].lump),
-				&texturebrightmapcache[texnum]
+				true
 		);
 
 		INT32 x;
@@ -784,7 +1217,7 @@ UINT8 *R_GenerateTextureBrightmap(size_t texnum)
 		// Allocate the same size as composite textures.
 		size_t blocksize = (texture->width * 4) + (texture->width * texture->height) + 1;
 
-		block = R_AllocateTextureBlock(blocksize, &texturebrightmapcache[texnum]);
+		block = R_AllocateTextureBlock(texnum, blocksize, true);
 		memset(block, TRANSPARENTPIXEL, blocksize); // Transparency hack
 
 		texpatch_t origin = {0};
@@ -1122,12 +1555,210 @@ void R_FlushTextureCache(void)
 
 	if (numtextures)
 		for (i = 0; i < numtextures; i++)
-			Z_Free(texturecache[i]);
+		{
+			R_FreeTextureBlock(i, false);
+			R_FreeTextureBlock(i, true);
+		}
+}
+
+static int R_CompareTextureCacheUsed(const void *a, const void *b)
+{
+	const UINT32 useda = texturecacheused[*(const INT32 *)a];
+	const UINT32 usedb = texturecacheused[*(const INT32 *)b];
+
+	return (useda > usedb) - (useda < usedb);
+}
+
+//
+// R_TrimTextureCache
+//
+// Called at level load, before any textures are used.
+// Frees the least recently used textures until
+// the cache fits in cv_texturecache again.
+//
+void R_TrimTextureCache(void)
+{
+	const size_t budget = (size_t)cv_texturecache.value << 20;
+	INT32 *order;
+	INT32 i, count = 0;
+
+	texturecacheepoch++;
+
+	if (texturecachetotal <= budget)
+		return;
+
+	order = Z_Malloc(numtextures * sizeof(*order), PU_STATIC, NULL);
+
+	for (i = 0; i < numtextures; i++)
+	{
+		if (texturecache[i] || texturebrightmapcache[i])
+			order[count++] = i;
+	}
+
+	qsort(order, count, sizeof(*order), R_CompareTextureCacheUsed);
+
+	for (i = 0; i < count && texturecachetotal > budget; i++)
+	{
+		R_FreeTextureBlock(order[i], false);
+		R_FreeTextureBlock(order[i], true);
+	}
+
+	Z_Free(order);
+}
+
+//
+// R_SaveTextureCacheFile
+//
+// Writes every generated texture to the texture cache file,
+// along with the ones that were already in it.
+//
+void R_SaveTextureCacheFile(void)
+{
+	char path[MAX_WADPATH], temppath[MAX_WADPATH];
+	struct texturefileentry *index;
+	UINT8 buf[TEXTUREFILEENTRYSIZE];
+	UINT8 *copy = NULL;
+	size_t copysize = 0;
+	UINT32 offset;
+	UINT16 version;
+	UINT32 count;
+	boolean ok = true;
+	FILE *f;
+	INT32 i;
+
+	if (!cv_texturecachefile.value || !texturefiledirty || numtextures == 0)
+		return;
+
+#ifdef NOMD5
+	return;
+#endif
+
+	// Get the index of the old file, to copy what isn't loaded
+	R_CheckTextureCacheFile();
+
+	snprintf(path, sizeof path, pandf, srb2home, TEXTURECACHEFILE);
+	snprintf(temppath, sizeof temppath, "%s.tmp", path);
+
+	f = fopen(temppath, "wb");
+	if (f == NULL)
+	{
+		CONS_Alert(CONS_WARNING, "Couldn't write %s: %s\n", TEXTURECACHEFILE, strerror(errno));
+		return;
+	}
+
+	index = Z_Calloc(numtextures * sizeof(*index), PU_STATIC, NULL);
+	offset = (sizeof TEXTURECACHEHEADER - 1) + sizeof version + sizeof texturefilekey + sizeof count
+		+ (numtextures * TEXTUREFILEENTRYSIZE);
+
+	for (i = 0; i < numtextures; i++)
+	{
+		if (texturecache[i])
+		{
+			index[i].size = texturecachesize[i];
+			index[i].colofs = (UINT8 *)texturecolumnofs[i] - texturecache[i];
+			index[i].holes = textures[i]->holes;
+			index[i].flip = textures[i]->flip;
+		}
+		else if (texturefileindex && texturefileindex[i].size)
+		{
+			index[i] = texturefileindex[i];
+		}
+		else
+		{
+			continue;
+		}
+
+		index[i].offset = offset;
+		offset += index[i].size;
+	}
+
+	version = SHORT(TEXTURECACHEVERSION);
+	count = LONG(numtextures);
+
+	ok = (fwrite(TEXTURECACHEHEADER, 1, sizeof TEXTURECACHEHEADER - 1, f) == sizeof TEXTURECACHEHEADER - 1)
+		&& (fwrite(&version, sizeof version, 1, f) == 1)
+		&& (fwrite(texturefilekey, 1, sizeof texturefilekey, f) == sizeof texturefilekey)
+		&& (fwrite(&count, sizeof count, 1, f) == 1);
+
+	for (i = 0; i < numtextures && ok; i++)
+	{
+		UINT8 *p = buf;
+
+		WRITEUINT32(p, index[i].offset);
+		WRITEUINT32(p, index[i].size);
+		WRITEUINT32(p, index[i].colofs);
+		WRITEUINT8(p, index[i].holes);
+		WRITEUINT8(p, index[i].flip);
+
+		ok = (fwrite(buf, 1, sizeof buf, f) == sizeof buf);
+	}
+
+	for (i = 0; i < numtextures && ok; i++)
+	{
+		if (index[i].size == 0)
+			continue;
+
+		if (texturecache[i])
+		{
+			ok = (fwrite(texturecache[i], 1, index[i].size, f) == index[i].size);
+			continue;
+		}
+
+		if (copysize < index[i].size)
+		{
+			UINT8 *newcopy = realloc(copy, index[i].size);
+
+			if (newcopy == NULL)
+			{
+				ok = false;
+				break;
+			}
+
+			copy = newcopy;
+			copysize = index[i].size;
+		}
+
+		ok = (fseek(texturecachefile, texturefileindex[i].offset, SEEK_SET) == 0)
+			&& (fread(copy, 1, index[i].size, texturecachefile) == index[i].size)
+			&& (fwrite(copy, 1, index[i].size, f) == index[i].size);
+	}
+
+	free(copy);
+	Z_Free(index);
+
+	if (fclose(f) != 0)
+		ok = false;
+
+	// Let R_CheckTextureCacheFile read the new file
+	if (texturecachefile)
+	{
+		fclose(texturecachefile);
+		texturecachefile = NULL;
+	}
+
+	Z_Free(texturefileindex);
+	texturefileindex = NULL;
+	texturefilewads = 0;
+
+	if (!ok)
+	{
+		CONS_Alert(CONS_WARNING, "Couldn't write %s\n", TEXTURECACHEFILE);
+		remove(temppath);
+		return;
+	}
+
+	remove(path);
+	if (rename(temppath, path) != 0)
+	{
+		CONS_Alert(CONS_WARNING, "Couldn't write %s: %s\n", TEXTURECACHEFILE, strerror(errno));
+		return;
+	}
+
+	texturefiledirty = false;
 }
 
-// Need these prototypes for later; defining them here instead of r_textures.h so they're "private"
-int R_CountTexturesInTEXTURESLump(UINT16 wadNum, UINT16 lumpNum);
-void R_ParseTEXTURESLump(UINT16 wadNum, UINT16 lumpNum, INT32 *index);
+// Need this prototype for later; defining it here instead of r_textures.h so it's "private"
+static INT32 R_ParseTEXTURESLump(UINT16 wadNum, UINT16 lumpNum);
 
 #ifdef WALLFLATS
 static INT32
@@ -1224,7 +1855,7 @@ static INT32
 Rloadtextures (INT32 i, INT32 w)
 {
 	UINT16 j;
-	UINT16 texstart, texend, texturesLumpPos;
+	UINT16 texstart, texend;
 	texture_t *texture;
 	texpatch_t *patch;
 	softwarepatch_t patchlump;
@@ -1234,20 +1865,20 @@ Rloadtextures (INT32 i, INT32 w)
 	{
 		texstart = W_CheckNumForFolderStartPK3("textures/", (UINT16)w, 0);
 		texend = W_CheckNumForFolderEndPK3("textures/", (UINT16)w, texstart);
-		texturesLumpPos = W_CheckNumForNamePwad("TEXTURES", (UINT16)w, 0);
-		while (texturesLumpPos != INT16_MAX)
-		{
-			R_ParseTEXTURESLump(w, texturesLumpPos, &i);
-			texturesLumpPos = W_CheckNumForNamePwad("TEXTURES", (UINT16)w, texturesLumpPos + 1);
-		}
 	}
 	else
 	{
 		texstart = W_CheckNumForMarkerStartPwad(TX_START, (UINT16)w, 0);
 		texend = W_CheckNumForNamePwad(TX_END, (UINT16)w, 0);
-		texturesLumpPos = W_CheckNumForNamePwad("TEXTURES", (UINT16)w, 0);
-		if (texturesLumpPos != INT16_MAX)
-			R_ParseTEXTURESLump(w, texturesLumpPos, &i);
+	}
+
+	// TEXTURES lumps were already parsed by R_CountTextures.
+	while (nextparsedtexture < numparsedtextures && parsedtextures[nextparsedtexture].wad == w)
+	{
+		texture = textures[i] = parsedtextures[nextparsedtexture++].texture;
+		texturewidth[i] = texture->width;
+		textureheight[i] = texture->height << FRACBITS;
+		i++;
 	}
 
 	if (!( texstart == INT16_MAX || texend == INT16_MAX ))
@@ -1300,6 +1931,7 @@ Rloadtextures (INT32 i, INT32 w)
 #ifdef DEVELOP
 				if ((width > 2048 && width < sizeLimit) || (height > 2048 && height < sizeLimit))
 				{
+					texturedefswarned = true;
 					R_InsertTextureWarning(
 						" \x87(2.x developer warning, will not appear on release)\n"
 						"\x87These textures should ideally not be larger than 2048x2048:\n",
@@ -1317,6 +1949,7 @@ Rloadtextures (INT32 i, INT32 w)
 					"Texture patch size cannot be greater than %dx%d!\n"
 					"List of affected textures:\n",
 					sizeLimit, sizeLimit);
+				texturedefswarned = true;
 				R_InsertTextureWarning(header, va("\x82" "WARNING: %s", wadfiles[wadnum]->lumpinfo[lumpnum].fullname));
 				continue;
 			}
@@ -1414,12 +2047,16 @@ static INT32 R_CountTextures(UINT16 wadnum)
 	count += count_range("F_START", "F_END", "flats/", wadnum);
 #endif
 
-	// Count the textures from TEXTURES lumps
+	// Parse the textures from TEXTURES lumps, only the first one in a WAD
 	texturesLumpPos = W_CheckNumForNamePwad("TEXTURES", wadnum, 0);
 
 	while (texturesLumpPos != INT16_MAX)
 	{
-		count += R_CountTexturesInTEXTURESLump(wadnum, texturesLumpPos);
+		count += R_ParseTEXTURESLump(wadnum, texturesLumpPos);
+
+		if (wadfiles[wadnum]->type != RET_PK3)
+			break;
+
 		texturesLumpPos = W_CheckNumForNamePwad("TEXTURES", wadnum, texturesLumpPos + 1);
 	}
 
@@ -1458,6 +2095,9 @@ static void R_AllocateTextures(INT32 add)
 	// Allocate texture referencing cache.
 	recallocuser(&texturecache, oldsize, newsize);
 	recallocuser(&texturebrightmapcache, oldsize, newsize);
+	recallocuser(&texturecachesize, numtextures * sizeof(*texturecachesize), newtextures * sizeof(*texturecachesize));
+	recallocuser(&texturebrightmapcachesize, numtextures * sizeof(*texturebrightmapcachesize), newtextures * sizeof(*texturebrightmapcachesize));
+	recallocuser(&texturecacheused, numtextures * sizeof(*texturecacheused), newtextures * sizeof(*texturecacheused));
 	// Allocate texture width table.
 	recallocuser(&texturewidth, oldsize, newsize);
 	// Allocate texture height table.
@@ -1489,6 +2129,10 @@ void R_UpdateTextureBrightmap(INT32 tx, INT32 bm)
 	I_Assert(tx > 0 && tx < numtextures);
 	I_Assert(bm >= 0 && bm < numtextures);
 
+	// The old brightmap may have been kept from another level.
+	if (texturebrightmaps[tx] != bm)
+		R_FreeTextureBlock(tx, true);
+
 	texturebrightmaps[tx] = bm;
 }
 
@@ -1504,6 +2148,11 @@ static void R_FinishLoadingTextures(INT32 add)
 {
 	numtextures += add;
 
+	// Everything that was parsed has been defined by now
+	Z_Free(parsedtextures);
+	parsedtextures = NULL;
+	numparsedtextures = maxparsedtextures = nextparsedtexture = 0;
+
 #ifdef HWRENDER
 	if (rendermode == render_opengl)
 		HWR_LoadMapTextures(numtextures);
@@ -1512,6 +2161,234 @@ static void R_FinishLoadingTextures(INT32 add)
 	g_texturenum_dbgline = R_CheckTextureNumForName("DBGLINE");
 }
 
+//
+// R_ReadTextureDefsFile
+//
+// Defines every texture from the texture definitions file,
+// if it was made for the files that are loaded now.
+// Returns the number of textures, or 0 if it couldn't.
+//
+static INT32 R_ReadTextureDefsFile(INT32 *maintextures)
+{
+	char header[sizeof TEXTUREDEFSHEADER - 1];
+	UINT8 key[16];
+	UINT8 *data, *p, *end;
+	long length;
+	INT32 count, i = 0;
+	FILE *f;
+
+	if (!cv_texturecachefile.value || !R_MakeTextureFileKey(key))
+		return 0;
+
+	f = fopen(va(pandf, srb2home, TEXTUREDEFSFILE), "rb");
+	if (f == NULL)
+		return 0;
+
+	if (fseek(f, 0, SEEK_END) != 0 || (length = ftell(f)) <= 0 || fseek(f, 0, SEEK_SET) != 0)
+	{
+		fclose(f);
+		return 0;
+	}
+
+	data = malloc(length);
+
+	if (data == NULL || fread(data, 1, length, f) != (size_t)length)
+	{
+		free(data);
+		fclose(f);
+		return 0;
+	}
+
+	fclose(f);
+
+	p = data;
+	end = data + length;
+
+	if (length < (long)(sizeof header + 2 + sizeof key + 4 + 4))
+		goto invalid;
+
+	READMEM(p, header, sizeof header);
+
+	if (memcmp(header, TEXTUREDEFSHEADER, sizeof header)
+		|| READUINT16(p) != TEXTUREDEFSVERSION
+		|| memcmp(p, key, sizeof key))
+	{
+		// Made for something else, it will be overwritten.
+		goto invalid;
+	}
+
+	p += sizeof key;
+	count = READINT32(p);
+	*maintextures = READINT32(p);
+
+	if (count <= 0 || *maintextures < 0 || *maintextures > count)
+		goto invalid;
+
+	R_AllocateTextures(count);
+
+	for (i = 0; i < count; i++)
+	{
+		texture_t *texture;
+		char name[8];
+		UINT8 type, flip;
+		INT16 width, height, patchcount, j;
+
+		if (end - p < TEXTUREDEFSENTRYSIZE)
+			goto truncated;
+
+		READMEM(p, name, sizeof name);
+		type = READUINT8(p);
+		width = READINT16(p);
+		height = READINT16(p);
+		flip = READUINT8(p);
+		patchcount = READINT16(p);
+
+		if (patchcount <= 0 || end - p < patchcount * TEXTUREDEFSPATCHSIZE)
+			goto truncated;
+
+		texture = textures[i] = Z_Calloc(sizeof(texture_t) + patchcount * sizeof(texpatch_t), PU_STATIC, NULL);
+
+		M_Memcpy(texture->name, name, sizeof(texture->name));
+		texture->hash = quickncasehash(texture->name, 8);
+		texture->type = type;
+		texture->width = width;
+		texture->height = height;
+		texture->flip = flip;
+		texture->terrain = K_GetTerrainForTextureName(texture->name);
+		texture->patchcount = patchcount;
+
+		for (j = 0; j < patchcount; j++)
+		{
+			texpatch_t *patch = &texture->patches[j];
+
+			patch->originx = READINT16(p);
+			patch->originy = READINT16(p);
+			patch->wad = READUINT16(p);
+			patch->lump = READUINT16(p);
+			patch->flip = READUINT8(p);
+			patch->alpha = READUINT8(p);
+			patch->style = READUINT8(p);
+
+			if (patch->wad >= numwadfiles || patch->lump >= wadfiles[patch->wad]->numlumps)
+			{
+				i++; // free this one too
+				goto truncated;
+			}
+		}
+
+		texturewidth[i] = texture->width;
+		textureheight[i] = texture->height << FRACBITS;
+	}
+
+	free(data);
+	return count;
+
+truncated:
+	CONS_Alert(CONS_WARNING, "%s is damaged, ignoring it\n", TEXTUREDEFSFILE);
+
+	// Give back what was allocated, textures are defined from
+	// scratch instead.
+	while (i--)
+	{
+		Z_Free(textures[i]);
+		textures[i] = NULL;
+		texturewidth[i] = 0;
+		textureheight[i] = 0;
+	}
+
+invalid:
+	free(data);
+	return 0;
+}
+
+//
+// R_SaveTextureDefsFile
+//
+// Writes the definitions of every loaded texture
+// to the texture definitions file.
+//
+static void R_SaveTextureDefsFile(INT32 maintextures)
+{
+	char path[MAX_WADPATH], temppath[MAX_WADPATH];
+	UINT8 key[16];
+	UINT8 *data, *p;
+	size_t length;
+	boolean ok;
+	FILE *f;
+	INT32 i, j;
+
+	if (!cv_texturecachefile.value || texturedefswarned || !R_MakeTextureFileKey(key))
+		return;
+
+	length = (sizeof TEXTUREDEFSHEADER - 1) + 2 + sizeof key + 4 + 4;
+
+	for (i = 0; i < numtextures; i++)
+		length += TEXTUREDEFSENTRYSIZE + textures[i]->patchcount * TEXTUREDEFSPATCHSIZE;
+
+	data = p = malloc(length);
+	if (data == NULL)
+		return;
+
+	WRITEMEM(p, TEXTUREDEFSHEADER, sizeof TEXTUREDEFSHEADER - 1);
+	WRITEUINT16(p, TEXTUREDEFSVERSION);
+	WRITEMEM(p, key, sizeof key);
+	WRITEINT32(p, numtextures);
+	WRITEINT32(p, maintextures);
+
+	for (i = 0; i < numtextures; i++)
+	{
+		const texture_t *texture = textures[i];
+
+		WRITEMEM(p, texture->name, sizeof(texture->name));
+		WRITEUINT8(p, texture->type);
+		WRITEINT16(p, texture->width);
+		WRITEINT16(p, texture->height);
+		WRITEUINT8(p, texture->flip);
+		WRITEINT16(p, texture->patchcount);
+
+		for (j = 0; j < texture->patchcount; j++)
+		{
+			const texpatch_t *patch = &texture->patches[j];
+
+			WRITEINT16(p, patch->originx);
+			WRITEINT16(p, patch->originy);
+			WRITEUINT16(p, patch->wad);
+			WRITEUINT16(p, patch->lump);
+			WRITEUINT8(p, patch->flip);
+			WRITEUINT8(p, patch->alpha);
+			WRITEUINT8(p, patch->style);
+		}
+	}
+
+	snprintf(path, sizeof path, pandf, srb2home, TEXTUREDEFSFILE);
+	snprintf(temppath, sizeof temppath, "%s.tmp", path);
+
+	f = fopen(temppath, "wb");
+	if (f == NULL)
+	{
+		CONS_Alert(CONS_WARNING, "Couldn't write %s: %s\n", TEXTUREDEFSFILE, strerror(errno));
+		free(data);
+		return;
+	}
+
+	ok = (fwrite(data, 1, length, f) == length);
+	free(data);
+
+	if (fclose(f) != 0)
+		ok = false;
+
+	if (!ok)
+	{
+		CONS_Alert(CONS_WARNING, "Couldn't write %s\n", TEXTUREDEFSFILE);
+		remove(temppath);
+		return;
+	}
+
+	remove(path);
+	if (rename(temppath, path) != 0)
+		CONS_Alert(CONS_WARNING, "Couldn't write %s: %s\n", TEXTUREDEFSFILE, strerror(errno));
+}
+
 //
 // R_LoadTextures
 // Initializes the texture list with the textures from the world map.
@@ -1520,10 +2397,24 @@ void R_LoadTextures(void)
 {
 	INT32 i, w;
 	INT32 newtextures = 0;
-#ifdef DEVELOP
 	INT32 maintextures = 0;
+
+	// Same files as last time, skip all of the parsing.
+	i = R_ReadTextureDefsFile(&maintextures);
+	if (i)
+	{
+		R_FinishLoadingTextures(i);
+
+#ifdef DEVELOP
+		R_CheckTextureDuplicates(0, maintextures);
 #endif
 
+		R_PrintTextureWarnings();
+		return;
+	}
+
+	texturedefswarned = false;
+
 	for (w = 0; w < numwadfiles; w++)
 	{
 		newtextures += R_CountTextures((UINT16)w);
@@ -1539,15 +2430,14 @@ void R_LoadTextures(void)
 	{
 		i = R_DefineTextures(i, w);
 
-#ifdef DEVELOP
 		if (w == mainwads)
 		{
 			maintextures = i;
 		}
-#endif
 	}
 
 	R_FinishLoadingTextures(i);
+	R_SaveTextureDefsFile(maintextures);
 
 #ifdef DEVELOP
 	R_CheckTextureDuplicates(0, maintextures);
@@ -1934,13 +2824,14 @@ static texture_t *R_ParseTexture(boolean actuallyLoadTexture)
 	else return NULL;
 }
 
-// Parses the TEXTURES lump... but just to count the number of textures.
-int R_CountTexturesInTEXTURESLump(UINT16 wadNum, UINT16 lumpNum)
+// Parses the TEXTURES lump, and keeps the textures for Rloadtextures.
+// Returns the number of textures in it.
+static INT32 R_ParseTEXTURESLump(UINT16 wadNum, UINT16 lumpNum)
 {
 	char *texturesLump;
 	size_t texturesLumpLength;
 	char *texturesText;
-	UINT32 numTexturesInLump = 0;
+	INT32 numTexturesInLump = 0;
 	char *texturesToken;
 
 	// Since lumps AREN'T \0-terminated like I'd assumed they should be, I'll
@@ -1965,64 +2856,19 @@ int R_CountTexturesInTEXTURESLump(UINT16 wadNum, UINT16 lumpNum)
 	{
 		if (stricmp(texturesToken, "WALLTEXTURE") == 0 || stricmp(texturesToken, "TEXTURE") == 0)
 		{
-			numTexturesInLump++;
 			Z_Free(texturesToken);
-			R_ParseTexture(false);
-		}
-		else
-		{
-			I_Error("Error parsing TEXTURES lump: Expected \"WALLTEXTURE\" or \"TEXTURE\", got \"%s\"",texturesToken);
-		}
-		texturesToken = M_GetToken(NULL);
-	}
-	Z_Free(texturesToken);
-	Z_Free((void *)texturesText);
-
-	return numTexturesInLump;
-}
-
-// Parses the TEXTURES lump... for real, this time.
-void R_ParseTEXTURESLump(UINT16 wadNum, UINT16 lumpNum, INT32 *texindex)
-{
-	char *texturesLump;
-	size_t texturesLumpLength;
-	char *texturesText;
-	char *texturesToken;
-	texture_t *newTexture;
-
-	I_Assert(texindex != NULL);
 
-	// Since lumps AREN'T \0-terminated like I'd assumed they should be, I'll
-	// need to make a space of memory where I can ensure that it will terminate
-	// correctly. Start by loading the relevant data from the WAD.
-	texturesLump = (char *)W_CacheLumpNumPwad(wadNum, lumpNum, PU_STATIC);
-	// If that didn't exist, we have nothing to do here.
-	if (texturesLump == NULL) return;
-	// If we're still here, then it DOES exist; figure out how long it is, and allot memory accordingly.
-	texturesLumpLength = W_LumpLengthPwad(wadNum, lumpNum);
-	texturesText = (char *)Z_Malloc((texturesLumpLength+1)*sizeof(char),PU_STATIC,NULL);
-	// Now move the contents of the lump into this new location.
-	memmove(texturesText,texturesLump,texturesLumpLength);
-	// Make damn well sure the last character in our new memory location is \0.
-	texturesText[texturesLumpLength] = '\0';
-	// Finally, free up the memory from the first data load, because we really
-	// don't need it.
-	Z_Free(texturesLump);
+			if (numparsedtextures == maxparsedtextures)
+			{
+				maxparsedtextures = max(maxparsedtextures * 2, 256);
+				parsedtextures = Z_Realloc(parsedtextures, maxparsedtextures * sizeof(*parsedtextures), PU_STATIC, NULL);
+			}
 
-	texturesToken = M_GetToken(texturesText);
-	while (texturesToken != NULL)
-	{
-		if (stricmp(texturesToken, "WALLTEXTURE") == 0 || stricmp(texturesToken, "TEXTURE") == 0)
-		{
-			Z_Free(texturesToken);
-			// Get the new texture
-			newTexture = R_ParseTexture(true);
-			// Store the new texture
-			textures[*texindex] = newTexture;
-			texturewidth[*texindex] = newTexture->width;
-			textureheight[*texindex] = newTexture->height << FRACBITS;
-			// Increment i back in R_LoadTextures()
-			(*texindex)++;
+			// Get the new texture, and keep it until it's defined
+			parsedtextures[numparsedtextures].texture = R_ParseTexture(true);
+			parsedtextures[numparsedtextures].wad = wadNum;
+			numparsedtextures++;
+			numTexturesInLump++;
 		}
 		else
 		{
@@ -2032,6 +2878,8 @@ void R_ParseTEXTURESLump(UINT16 wadNum, UINT16 lumpNum, INT32 *texindex)
 	}
 	Z_Free(texturesToken);
 	Z_Free((void *)texturesText);
+
+	return numTexturesInLump;
 }
 
 // Search for flat name.
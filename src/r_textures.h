@@ -85,8 +85,14 @@ void R_LoadTextures(void);
 void R_LoadTexturesPwad(UINT16 wadnum);
 void R_FlushTextureCache(void);
 
+// Generated textures are kept between levels, up to cv_texturecache megabytes
+extern consvar_t cv_texturecache, cv_texturecachefile;
+void R_TrimTextureCache(void);
+void R_SaveTextureCacheFile(void);
+
 // Texture generation
 UINT8 *R_GenerateTexture(size_t texnum);
+void R_GenerateTextures(const char *present);
 UINT8 *R_GenerateTextureAsFlat(size_t texnum);
 UINT8 *R_GenerateTextureBrightmap(size_t texnum);
 INT32 R_GetTextureNum(INT32 texnum);
@@ -13,6 +13,8 @@
 /// \brief Refresh of things, i.e. objects represented by sprites
 
 #include <algorithm>
+#include <unordered_map>
+#include <vector>
 
 #include "doomdef.h"
 #include "console.h"
@@ -28,6 +30,7 @@
 #include "i_system.h"
 #include "r_fps.h"
 #include "r_things.h"
+#include "r_particle.h"
 #include "r_patch.h"
 #include "r_patchrotation.h"
 #include "r_picformats.h"
@@ -838,10 +841,8 @@ UINT8 *R_GetSpriteTranslation(vissprite_t *vis)
 {
 	if (vis->cut & SC_PRECIP)
 	{
-		// Simplified func, less safe properties to check
-		if (vis->mobj->color)
-			R_GetTranslationColormap(TC_DEFAULT, static_cast<skincolornum_t>(vis->mobj->color), GTC_CACHE);
-		return NULL;
+		// Precipitation and particles resolve their translation when projected
+		return vis->translation;
 	}
 
 	size_t skinnum = TC_DEFAULT;
@@ -1158,15 +1159,32 @@ static void R_DrawPrecipitationVisSprite(vissprite_t *vis)
 	if (overflow_test < 0) overflow_test = -overflow_test;
 	if ((UINT64)overflow_test&0xFFFFFFFF80000000ULL) return; // fixed point mult would overflow
 
-	if (vis->transmap)
+	dc.translation = vis->translation;
+
+	if (vis->transmap && dc.translation)
+	{
+		R_SetColumnFunc(COLDRAWFUNC_TRANSTRANS, false);
+		dc.transmap = vis->transmap;
+	}
+	else if (vis->transmap)
 	{
 		R_SetColumnFunc(COLDRAWFUNC_FUZZY, false);
 		dc.transmap = vis->transmap;    //Fab : 29-04-98: translucency table
 	}
+	else if (dc.translation)
+	{
+		R_SetColumnFunc(COLDRAWFUNC_TRANS, false);
+	}
+
+	dc.colormap = vis->colormap;
+
+	if (vis->extra_colormap && !(vis->cut & SC_FULLBRIGHT))
+	{
+		dc.colormap = &vis->extra_colormap->colormap[dc.colormap - colormaps];
+	}
 
-	dc.colormap = colormaps;
 	dc.fullbright = colormaps;
-	if (encoremap)
+	if (encoremap && !dc.translation)
 	{
 		dc.colormap += COLORMAP_REMAPOFFSET;
 		dc.fullbright += COLORMAP_REMAPOFFSET;
@@ -1960,7 +1978,7 @@ static void R_ProjectSprite(mobj_t *thing)
 		{
 			rollangle = R_GetRollAngle(spriterotangle);
 		}
-		rotsprite = Patch_GetRotatedSprite(sprframe, (thing->frame & FF_FRAMEMASK), rot, flip, false, sprinfo, rollangle);
+		rotsprite = Patch_GetRotatedSpriteAsync(sprframe, (thing->frame & FF_FRAMEMASK), rot, flip, false, sprinfo, rollangle);
 
 		if (rotsprite != NULL)
 		{
@@ -2767,7 +2785,8 @@ static void R_ProjectPrecipitationSprite(precipmobj_t *thing)
 
 	vis->mobj = (mobj_t *)thing;
 	vis->mobjflags = 0;
-	vis->cut = SC_PRECIP;
+	vis->cut = static_cast<spritecut_e>(SC_PRECIP | SC_FULLBRIGHT);
+	vis->translation = NULL;
 	vis->extra_colormap = thing->subsector->sector->extra_colormap;
 	vis->heightsec = thing->subsector->sector->heightsec;
 
@@ -2889,24 +2908,293 @@ void R_AddPrecipitationSprites(void)
 	}
 }
 
+// R_ProjectParticleSprite
+// Same as R_ProjectPrecipitationSprite, but for an entry
+// of the particle pool, which is lit by its sector.
+//
+static void R_ProjectParticleSprite(size_t i, fixed_t frac)
+{
+	fixed_t tr_x, tr_y;
+	fixed_t tx, tz;
+	fixed_t xscale, yscale;
+
+	INT32 x1, x2;
+
+	spritedef_t *sprdef;
+	spriteframe_t *sprframe;
+	size_t lump;
+
+	vissprite_t *vis;
+	sector_t *sector;
+
+	fixed_t iscale;
+	fixed_t gz, gzt;
+	fixed_t x, y, z;
+
+	const fixed_t this_scale = particles.scale[i];
+	const spritenum_t sprite = particles.sprite[i];
+	const UINT32 frame = particles.frame[i];
+
+	UINT32 blendmode;
+	UINT32 trans;
+
+	x = particles.oldx[i] + FixedMul(frac, particles.x[i] - particles.oldx[i]);
+	y = particles.oldy[i] + FixedMul(frac, particles.y[i] - particles.oldy[i]);
+	z = particles.oldz[i] + FixedMul(frac, particles.z[i] - particles.oldz[i]);
+
+	// transform the origin point
+	tr_x = x - viewx;
+	tr_y = y - viewy;
+
+	tz = FixedMul(tr_x, viewcos) + FixedMul(tr_y, viewsin); // near/far distance
+
+	// thing is behind view plane?
+	if (tz < FixedMul(MINZ, this_scale))
+		return;
+
+	tx = FixedMul(tr_x, viewsin) - FixedMul(tr_y, viewcos); // sideways distance
+
+	// too far off the side?
+	if (abs(tx) > FixedMul(tz, fovtan[viewssnum])<<2)
+		return;
+
+	// aspect ratio stuff :
+	xscale = FixedDiv(projection[viewssnum], tz);
+	yscale = FixedDiv(projectiony[viewssnum], tz);
+
+	if ((unsigned)sprite >= numsprites)
+		return;
+
+	sprdef = &sprites[sprite];
+
+	if ((UINT8)(frame&FF_FRAMEMASK) >= sprdef->numframes)
+		return;
+
+	sprframe = &sprdef->spriteframes[frame & FF_FRAMEMASK];
+
+	// use single rotation for all views
+	lump = sprframe->lumpid[0];
+
+	// calculate edges of the shape
+	tx -= FixedMul(spritecachedinfo[lump].offset, this_scale);
+	x1 = (centerxfrac + FixedMul (tx,xscale)) >>FRACBITS;
+
+	// off the right side?
+	if (x1 > viewwidth)
+		return;
+
+	tx += FixedMul(spritecachedinfo[lump].width, this_scale);
+	x2 = ((centerxfrac + FixedMul (tx,xscale)) >>FRACBITS) - 1;
+
+	// off the left side
+	if (x2 < 0)
+		return;
+
+	// PORTAL SPRITE CLIPPING
+	if (portalrender && portalclipline)
+	{
+		if (x2 < portalclipstart || x1 >= portalclipend)
+			return;
+
+		if (P_PointOnLineSide(x, y, portalclipline) != 0)
+			return;
+	}
+
+	if (particles.flip[i])
+	{
+		gzt = z;
+		gz = gzt - FixedMul(spritecachedinfo[lump].height, this_scale);
+	}
+	else
+	{
+		gzt = z + FixedMul(spritecachedinfo[lump].topoffset, this_scale);
+		gz = gzt - FixedMul(spritecachedinfo[lump].height, this_scale);
+	}
+
+	sector = R_PointInSubsector(x, y)->sector;
+
+	if (sector->cullheight)
+	{
+		if (R_DoCulling(sector->cullheight, viewsector->cullheight, viewz, gz, gzt))
+			return;
+	}
+
+	blendmode = (frame & FF_BLENDMASK) >> FF_BLENDSHIFT;
+	if (blendmode)
+		blendmode++; // realign to constants
+
+	trans = (frame & FF_TRANSMASK) >> FF_TRANSSHIFT;
+	if (trans >= NUMTRANSMAPS)
+		return; // cap
+
+	// store information in a vissprite
+	vis = R_NewVisSprite();
+	vis->scale = FixedMul(yscale, this_scale);
+	vis->sortscale = yscale;
+	vis->thingscale = this_scale;
+	vis->dispoffset = 0;
+	vis->gx = x;
+	vis->gy = y;
+	vis->gz = gz;
+	vis->gzt = gzt;
+	vis->thingheight = 4*FRACUNIT;
+	vis->pz = z;
+	vis->pzt = vis->pz + vis->thingheight;
+	vis->floorclip = 0;
+	vis->texturemid = vis->gzt - viewz;
+	vis->scalestep = 0;
+	vis->paperdistance = 0;
+	vis->shear.tan = 0;
+	vis->shear.offset = 0;
+
+	vis->x1 = x1 < portalclipstart ? portalclipstart : x1;
+	vis->x2 = x2 >= portalclipend ? portalclipend-1 : x2;
+
+	vis->x1test = 0;
+	vis->x2test = 0;
+
+	vis->xscale = xscale;
+	vis->sector = sector;
+	vis->szt = (INT16)((centeryfrac - FixedMul(vis->gzt - viewz, yscale))>>FRACBITS);
+	vis->sz = (INT16)((centeryfrac - FixedMul(vis->gz - viewz, yscale))>>FRACBITS);
+
+	iscale = FixedDiv(FRACUNIT, xscale);
+
+	vis->startfrac = 0;
+	vis->xiscale = FixedDiv(iscale, this_scale);
+
+	if (vis->x1 > x1)
+		vis->startfrac += vis->xiscale*(vis->x1-x1);
+
+	vis->patch = static_cast<patch_t*>(W_CachePatchNum(sprframe->lumppat[0], PU_SPRITE));
+	vis->bright = R_CacheSpriteBrightMap(&spriteinfo[sprite], frame & FF_FRAMEMASK);
+
+	vis->transmap = R_GetBlendTable(blendmode, trans);
+
+	vis->mobj = NULL;
+	vis->mobjflags = 0;
+	vis->renderflags = 0;
+	vis->cut = SC_PRECIP;
+	vis->extra_colormap = sector->extra_colormap;
+	vis->heightsec = sector->heightsec;
+
+	if (particles.color[i] != SKINCOLOR_NONE)
+		vis->translation = R_GetTranslationColormap(TC_DEFAULT, static_cast<skincolornum_t>(particles.color[i]), GTC_CACHE);
+	else
+		vis->translation = NULL;
+
+	if (frame & FF_FULLBRIGHT)
+	{
+		vis->cut = static_cast<spritecut_e>(vis->cut | SC_FULLBRIGHT);
+		vis->colormap = colormaps;
+	}
+	else
+	{
+		INT32 lightnum = sector->lightlevel >> LIGHTSEGSHIFT;
+		INT32 lindex = FixedMul(xscale, LIGHTRESOLUTIONFIX)>>(LIGHTSCALESHIFT);
+
+		lightnum = std::clamp<INT32>(lightnum, 0, LIGHTLEVELS - 1);
+		lindex = std::clamp<INT32>(lindex, 0, MAXLIGHTSCALE - 1);
+
+		vis->colormap = scalelight[lightnum][lindex];
+	}
+}
+
+// R_AddParticleSprites
+// Particles are not linked into sectors, so they are culled
+// against draw distance here instead of during BSP traversal.
+//
+void R_AddParticleSprites(void)
+{
+	const fixed_t drawdist = cv_drawdist.value * mapobjectscale;
+	fixed_t frac = FRACUNIT;
+	size_t i;
+
+	if (particles.count == 0)
+	{
+		return;
+	}
+
+	// do not render in skybox
+	if (portalskipprecipmobjs)
+	{
+		return;
+	}
+
+	if (R_UsingFrameInterpolation() && !paused)
+	{
+		frac = rendertimefrac;
+	}
+
+	for (i = 0; i < particles.count; i++)
+	{
+		if (drawdist && R_PointToDist(particles.x[i], particles.y[i]) > drawdist)
+		{
+			continue;
+		}
+
+		R_ProjectParticleSprite(i, frac);
+	}
+}
+
 //
 // R_SortVisSprites
 //
-static void R_SortVisSprites(vissprite_t* vsprsortedhead, UINT32 start, UINT32 end)
+struct vissortkey_t
+{
+	fixed_t sortscale;
+	INT32 dispoffset;
+	vissprite_t *sprite;
+};
+
+static std::vector<vissprite_t *> vsprsortlist;
+static std::vector<INT32> vsprnexttracer;
+static std::vector<UINT8> vsprlinked;
+static std::vector<vissortkey_t> vsprsortkeys;
+static std::unordered_map<mobj_t *, INT32> vsprtracers;
+
+// Finds the sprite a linkdraw sprite should be drawn with.
+// Candidates for each mobj are chained newest first, which
+// is the order a search backwards through the list would see.
+static vissprite_t *R_FindLinkDrawTracer(vissprite_t *ds)
 {
-	UINT32       i, count = 0;
-	vissprite_t *ds, *dsprev, *dsnext, *dsfirst;
-	vissprite_t *best = NULL;
-	vissprite_t  unsorted;
-	fixed_t      bestscale;
-	INT32        bestdispoffset;
+	auto it = vsprtracers.find(ds->mobj);
+	INT32 i;
+
+	if (it == vsprtracers.end())
+		return NULL;
+
+	for (i = it->second; i != -1; i = vsprnexttracer[i])
+	{
+		vissprite_t *dsfirst = vsprsortlist[i];
+
+		// don't connect if the tracer's top is cut off, but lower than the link's top
+		if ((dsfirst->cut & SC_TOP)
+		&& dsfirst->szt > ds->szt)
+			continue;
 
-	dsfirst = &unsorted;
-	dsprev = dsfirst;
-	dsnext = dsfirst;
+		// don't connect if the tracer's bottom is cut off, but higher than the link's bottom
+		if ((dsfirst->cut & SC_BOTTOM)
+		&& dsfirst->sz < ds->sz)
+			continue;
+
+		return dsfirst;
+	}
+
+	return NULL;
+}
+
+static void R_SortVisSprites(vissprite_t* vsprsortedhead, UINT32 start, UINT32 end)
+{
+	UINT32       i;
+	INT32        j, count;
+	vissprite_t *ds, *dsfirst, *dsnext;
+	precise_t    sorttime = I_GetPreciseTime();
 
 	I_Assert(start <= end);
 
+	vsprsortlist.clear();
+
 	for (i = start; i < end; ++i)
 	{
 		ds = R_GetVisSprite(i);
@@ -2917,70 +3205,61 @@ static void R_SortVisSprites(vissprite_t* vsprsortedhead, UINT32 start, UINT32 e
 			continue;
 		}
 
-		dsnext = ds;
-		dsnext->linkdraw = NULL;
-
-		dsprev->next = dsnext;
-		dsnext->prev = dsprev;
-		dsprev = dsnext;
-
-		count++;
+		ds->linkdraw = NULL;
+		vsprsortlist.push_back(ds);
 	}
 
-	dsnext->next = dsfirst;
-	dsfirst->prev = dsnext;
+	count = (INT32)vsprsortlist.size();
 
-	// bundle linkdraw
-	for (ds = unsorted.prev; ds != &unsorted; ds = ds->prev)
+	vsprnexttracer.assign(count, -1);
+	vsprlinked.assign(count, 0);
+	vsprtracers.clear();
+
+	// index possible linkdraw tracers by mobj
+	for (j = 0; j < count; j++)
 	{
-		if (!(ds->cut & SC_LINKDRAW))
+		ds = vsprsortlist[j];
+
+		// don't connect if it's also a link
+		if (ds->cut & SC_LINKDRAW)
 			continue;
 
+		// don't connect to your shadow!
 		if (ds->cut & SC_SHADOW)
 			continue;
 
-		// reuse dsfirst...
-		for (dsfirst = unsorted.prev; dsfirst != &unsorted; dsfirst = dsfirst->prev)
-		{
-			// don't connect if it's also a link
-			if (dsfirst->cut & SC_LINKDRAW)
-				continue;
+		// don't connect to your bounding box!
+		if (ds->cut & SC_BBOX)
+			continue;
 
-			// don't connect to your shadow!
-			if (dsfirst->cut & SC_SHADOW)
-				continue;
+		if (ds->mobj == NULL)
+			continue;
 
-			// don't connect to your bounding box!
-			if (dsfirst->cut & SC_BBOX)
-				continue;
+		auto it = vsprtracers.try_emplace(ds->mobj, -1).first;
+		vsprnexttracer[j] = it->second;
+		it->second = j;
+	}
 
-			// don't connect if it's not the tracer
-			if (dsfirst->mobj != ds->mobj)
-				continue;
+	// bundle linkdraw
+	for (j = count - 1; j >= 0; j--)
+	{
+		ds = vsprsortlist[j];
 
-			// don't connect if the tracer's top is cut off, but lower than the link's top
-			if ((dsfirst->cut & SC_TOP)
-			&& dsfirst->szt > ds->szt)
-				continue;
+		if (!(ds->cut & SC_LINKDRAW))
+			continue;
 
-			// don't connect if the tracer's bottom is cut off, but higher than the link's bottom
-			if ((dsfirst->cut & SC_BOTTOM)
-			&& dsfirst->sz < ds->sz)
-				continue;
+		if (ds->cut & SC_SHADOW)
+			continue;
 
-			break;
-		}
+		dsfirst = R_FindLinkDrawTracer(ds);
 
 		// remove from chain
-		ds->next->prev = ds->prev;
-		ds->prev->next = ds->next;
-		count--;
+		vsprlinked[j] = 1;
 
-		if (dsfirst != &unsorted)
+		if (dsfirst != NULL)
 		{
 			ds->extra_colormap = dsfirst->extra_colormap;
 
-			// reusing dsnext...
 			dsnext = dsfirst->linkdraw;
 
 			if (!dsnext || ds->dispoffset < dsnext->dispoffset)
@@ -2999,38 +3278,46 @@ static void R_SortVisSprites(vissprite_t* vsprsortedhead, UINT32 start, UINT32 e
 		}
 	}
 
-	// pull the vissprites out by scale
-	vsprsortedhead->next = vsprsortedhead->prev = vsprsortedhead;
-	for (i = 0; i < count; i++)
+	// sort the vissprites by scale, then by dispoffset, smallest first;
+	// stable so that ties keep the order the sprites were projected in
+	vsprsortkeys.clear();
+
+	for (j = 0; j < count; j++)
 	{
-		bestscale = bestdispoffset = INT32_MAX;
-		for (ds = unsorted.next; ds != &unsorted; ds = ds->next)
-		{
+		if (vsprlinked[j])
+			continue;
+
+		ds = vsprsortlist[j];
+
 #ifdef PARANOIA
-			if (ds->cut & SC_LINKDRAW)
-				I_Error("R_SortVisSprites: no link or discardal made for linkdraw!");
+		if (ds->cut & SC_LINKDRAW)
+			I_Error("R_SortVisSprites: no link or discardal made for linkdraw!");
 #endif
 
-			if (ds->sortscale < bestscale)
-			{
-				bestscale = ds->sortscale;
-				bestdispoffset = ds->dispoffset;
-				best = ds;
-			}
-			// order visprites of same scale by dispoffset, smallest first
-			else if (ds->sortscale == bestscale && ds->dispoffset < bestdispoffset)
-			{
-				bestdispoffset = ds->dispoffset;
-				best = ds;
-			}
-		}
-		best->next->prev = best->prev;
-		best->prev->next = best->next;
+		vsprsortkeys.push_back({ds->sortscale, ds->dispoffset, ds});
+	}
+
+	std::stable_sort(vsprsortkeys.begin(), vsprsortkeys.end(),
+		[](const vissortkey_t &a, const vissortkey_t &b)
+		{
+			if (a.sortscale != b.sortscale)
+				return a.sortscale < b.sortscale;
+			return a.dispoffset < b.dispoffset;
+		});
+
+	vsprsortedhead->next = vsprsortedhead->prev = vsprsortedhead;
+	for (const vissortkey_t &key : vsprsortkeys)
+	{
+		vissprite_t *best = key.sprite;
+
 		best->next = vsprsortedhead;
 		best->prev = vsprsortedhead->prev;
 		vsprsortedhead->prev->next = best;
 		vsprsortedhead->prev = best;
 	}
+
+	ps_numsprites += (int)vsprsortkeys.size();
+	ps_sw_spritesorttime += I_GetPreciseTime() - sorttime;
 }
 
 //
@@ -70,6 +70,7 @@ fixed_t R_GetSpriteDirectionalLighting(angle_t angle);
 //SoM: 6/5/2000: Light sprites correctly!
 void R_AddSprites(sector_t *sec, INT32 lightlevel);
 void R_AddPrecipitationSprites(void);
+void R_AddParticleSprites(void);
 void R_InitSprites(void);
 void R_ClearSprites(void);
 
@@ -206,6 +207,8 @@ struct vissprite_t
 	lighttable_t *colormap; // for color translation and shadow draw
 	                        // maxbright frames as well
 
+	UINT8 *translation; // skincolor translation for sprites without a mobj
+
 	UINT8 *transmap; // which translucency table to use
 
 	INT32 mobjflags;
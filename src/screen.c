@@ -186,6 +186,8 @@ void SCR_SetDrawFuncs(void)
 	spanfuncs_flat[SPANDRAWFUNC_FOG] = R_DrawSpan_Flat;
 	spanfuncs_flat[SPANDRAWFUNC_TILTEDFOG] = R_DrawTiltedSpan_Flat;
 
+	R_SetSIMDDrawFuncs();
+
 	R_SetColumnFunc(BASEDRAWFUNC, false);
 	R_SetSpanFunc(BASEDRAWFUNC, false, false);
 }
@@ -1666,6 +1666,7 @@ void I_Quit(void)
 		K_PlayerForfeit(consoleplayer, true);
 
 	G_SaveGameData(); // Tails 12-08-2002
+	R_SaveTextureCacheFile();
 	//added:16-02-98: when recording a demo, should exit using 'q' key,
 	//        but sometimes we forget and use 'F10'.. so save here too.
 
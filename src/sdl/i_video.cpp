@@ -134,6 +134,7 @@ static       SDL_bool    mousegrabok = SDL_TRUE;
 static       SDL_bool    wrapmouseok = SDL_FALSE;
 static       SDL_bool    exposevideo = SDL_FALSE;
 static       SDL_bool    borderlesswindow = SDL_FALSE;
+static       SDL_bool    hiddenwindow = SDL_FALSE; // -nowindow, for unattended timedemos
 
 // SDL2 vars
 SDL_Window   *window;
@@ -1553,6 +1554,10 @@ static SDL_bool Impl_CreateWindow(SDL_bool fullscreen)
 	if (borderlesswindow)
 		flags |= SDL_WINDOW_BORDERLESS;
 
+	// Still needs a GL context, so the window exists but is never shown
+	if (hiddenwindow)
+		flags |= SDL_WINDOW_HIDDEN;
+
 	// RHI: always create window as OPENGL
 	flags |= SDL_WINDOW_OPENGL;
 
@@ -1610,7 +1615,8 @@ void I_StartupGraphics(void)
 		CV_RegisterList(cvlist_graphics_driver);
 	}
 	disable_mouse = static_cast<SDL_bool>(M_CheckParm("-nomouse"));
-	disable_fullscreen = M_CheckParm("-win") ? SDL_TRUE : SDL_FALSE;
+	hiddenwindow = M_CheckParm("-nowindow") ? SDL_TRUE : SDL_FALSE;
+	disable_fullscreen = (M_CheckParm("-win") || hiddenwindow) ? SDL_TRUE : SDL_FALSE;
 
 	keyboard_started = true;
 
@@ -1687,7 +1693,7 @@ void I_StartupGraphics(void)
 
 	VID_SetMode(VID_GetModeForSize(BASEVIDWIDTH, BASEVIDHEIGHT));
 
-	if (M_CheckParm("-nomousegrab"))
+	if (M_CheckParm("-nomousegrab") || hiddenwindow)
 		mousegrabok = SDL_FALSE;
 	realwidth = (Uint16)vid.width;
 	realheight = (Uint16)vid.height;
@@ -1695,7 +1701,8 @@ void I_StartupGraphics(void)
 	VID_Command_Info_f();
 	SDLdoUngrabMouse();
 
-	SDL_RaiseWindow(window);
+	if (!hiddenwindow)
+		SDL_RaiseWindow(window);
 
 	if (mousegrabok && !disable_mouse)
 		SDLdoGrabMouse();
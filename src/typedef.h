@@ -255,6 +255,9 @@ TYPEDEF (mapUserProperties_t);
 // lua_hudlib_drawlist.h
 typedef struct huddrawlist_s *huddrawlist_h;
 
+// lua_alloc.h
+TYPEDEF (luaallocstats_t);
+
 // lua_profile.h
 TYPEDEF (lua_timer_t);
 
@@ -301,6 +304,8 @@ TYPEDEF (BasicFF_t);
 TYPEDEF (divline_t);
 TYPEDEF (intercept_t);
 TYPEDEF (opening_t);
+TYPEDEF (blockentry_t);
+TYPEDEF (blockcell_t);
 
 // p_mobj.h
 TYPEDEF (mobj_t);
@@ -372,6 +377,7 @@ TYPEDEF (activator_t);
 
 // r_data.h
 TYPEDEF (lumplist_t);
+TYPEDEF (nearestcolorcube_t);
 
 // r_defs.h
 TYPEDEF (cliprange_t);
@@ -414,6 +420,13 @@ TYPEDEF (spriteinfo_t);
 TYPEDEF (visplane_t);
 TYPEDEF (visffloor_t);
 
+// r_particle.h
+TYPEDEF (particledef_t);
+TYPEDEF (particlepool_t);
+
+// r_patchrotation.h
+TYPEDEF (rotatedraw_t);
+
 // r_portal.h
 TYPEDEF (portal_t);
 
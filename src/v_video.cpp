@@ -334,6 +334,8 @@ static void LoadPalette(const char *lumpname)
 		V_CubeApply(&pGammaCorrectedPalette[i]);
 		pLocalPalette[i].rgba = V_GammaEncode(pGammaCorrectedPalette[i].rgba);
 	}
+
+	R_InitNearestColorCube();
 }
 
 void V_CubeApply(RGBA_t *input)
@@ -40,6 +40,7 @@
 #include "z_zone.h"
 #include "m_misc.h" // M_Memcpy
 #include "lua_script.h"
+#include "lua_alloc.h"
 
 #ifdef HWRENDER
 #include "hardware/hw_main.h" // For hardware memory info
@@ -585,6 +586,23 @@ size_t Z_TagsUsage(INT32 lowtag, INT32 hightag)
 	return cnt;
 }
 
+/** Gets how much of the heap a block takes up.
+  *
+  * \param ptr A pointer to allocated memory, or NULL.
+  * 
+eturn Number of bytes allocated for the block, or 0 for NULL.
+  */
+size_t Z_Size(void *ptr)
+{
+	memblock_t *block;
+
+	if (ptr == NULL)
+		return 0;
+
+	block = MEMBLOCK(ptr);
+	return block->size;
+}
+
 // -----------------------
 // Miscellaneous functions
 // -----------------------
@@ -595,6 +613,7 @@ size_t Z_TagsUsage(INT32 lowtag, INT32 hightag)
 static void Command_Memfree_f(void)
 {
 	UINT32 freebytes, totalbytes;
+	luaallocstats_t luastats;
 
 	Z_CheckHeap(-1);
 	CONS_Printf("\x82%s", M_GetText("Memory Info\n"));
@@ -607,12 +626,18 @@ static void Command_Memfree_f(void)
 	CONS_Printf(M_GetText("Patches (rotated)      : %7s KB\n"), sizeu1(Z_TagUsage(PU_PATCH_ROTATED)>>10));
 	CONS_Printf(M_GetText("Sprites                : %7s KB\n"), sizeu1(Z_TagUsage(PU_SPRITE)>>10));
 	CONS_Printf(M_GetText("HUD graphics           : %7s KB\n"), sizeu1(Z_TagUsage(PU_HUDGFX)>>10));
+	CONS_Printf(M_GetText("Textures               : %7s KB\n"), sizeu1(Z_TagUsage(PU_TEXTURE)>>10));
 	CONS_Printf(M_GetText("Locked cache           : %7s KB\n"), sizeu1(Z_TagUsage(PU_CACHE)>>10));
 	CONS_Printf(M_GetText("Level                  : %7s KB\n"), sizeu1(Z_TagUsage(PU_LEVEL)>>10));
 	CONS_Printf(M_GetText("Special thinker        : %7s KB\n"), sizeu1(Z_TagUsage(PU_LEVSPEC)>>10));
 	CONS_Printf(M_GetText("All purgable           : %7s KB\n"),
 		sizeu1(Z_TagsUsage(PU_PURGELEVEL, INT32_MAX)>>10));
 
+	// Lua has its own pools, outside of the heap
+	LUA_GetAllocStats(&luastats);
+	CONS_Printf(M_GetText("Lua (outside heap)     : %7s KB\n"), sizeu1(luastats.live>>10));
+	CONS_Printf(M_GetText("Lua pools              : %7s KB\n"), sizeu1((luastats.pooled + luastats.large)>>10));
+
 #ifdef HWRENDER
 	if (rendermode == render_opengl)
 	{
@@ -55,6 +55,7 @@ enum
 	PU_PATCH_DATA            = 17, // patch data, lifetime depends on the patch that owns it
 	PU_SPRITE                = 18, // sprite patch, static until WAD added
 	PU_HUDGFX                = 19, // HUD patch, static until WAD added
+	PU_TEXTURE               = 20, // composite texture, static until trimmed by R_TrimTextureCache
 
 	PU_HWRPATCHINFO          = 21, // Hardware GLPatch_t struct for OpenGL texture cache
 	PU_HWRPATCHCOLMIPMAP     = 22, // Hardware GLMipmap_t struct colormap variation of patch
@@ -141,6 +142,7 @@ void Z_SetUser(void *ptr, void **newuser);
 #define Z_TagUsage(tagnum) Z_TagsUsage(tagnum, tagnum)
 size_t Z_TagsUsage(INT32 lowtag, INT32 hightag);
 #define Z_TotalUsage() Z_TagsUsage(0, INT32_MAX)
+size_t Z_Size(void *ptr);
 
 //
 // Miscellaneous functions